@@ -4,6 +4,14 @@
 
 include_guard(GLOBAL)
 
+if (TODDS_HUGE_PAGES)
+	if (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+		add_compile_definitions(TODDS_HUGE_PAGES)
+	else ()
+		message(WARNING "TODDS_HUGE_PAGES is only available on Linux.")
+	endif ()
+endif ()
+
 if (TODDS_ISPC)
 	add_compile_definitions(TODDS_ISPC)
 endif ()
@@ -5,6 +5,8 @@
 
 #include "todds/arguments.hpp"
 
+#include "todds/cache.hpp"
+#include "todds/cpu.hpp"
 #include "todds/format.hpp"
 #include "todds/project.hpp"
 #include "todds/string.hpp"
@@ -45,6 +47,10 @@ constexpr auto format_arg = optional_argument("--format", "DDS encoding format."
 constexpr auto alpha_format_arg = optional_arg{"--alpha-format", "-af",
 	"Use a different DDS encoding format for files with alpha. Defaults to using the value in --format unconditionally."};
 
+constexpr auto grayscale_format_arg = optional_arg{"--grayscale-format", "-gf",
+	"Use a different DDS encoding format for opaque files in which every pixel is gray. Files with alpha use "
+	"--alpha-format instead when it is provided."};
+
 constexpr auto default_quality = todds::format::quality::really_slow;
 constexpr auto quality_arg =
 	optional_argument("--quality", "Encoder quality level, must be in [{:d}, {:d}]. Defaults to {:d}.");
@@ -87,8 +93,13 @@ constexpr auto vflip_arg = optional_arg{"--vflip", "-vf", "Flip source images ve
 
 constexpr auto time_arg = optional_argument("--time", "Show total execution time.");
 
-constexpr auto regex_arg =
-	optional_argument("--regex", "Process only absolute paths matching this regular expression.");
+constexpr auto regex_arg = optional_argument("--regex",
+	"Process only absolute paths matching this regular expression. Files inside of matching directories are processed "
+	"as well. Can be provided several times, processing paths matching any of them.");
+
+constexpr auto exclude_arg = optional_arg{"--exclude", "-ex",
+	"Skip absolute paths matching this regular expression, even if they match --regex or --substring. Matching "
+	"directories are not searched. Can be provided several times."};
 
 constexpr auto substring_arg =
 	optional_arg{"--substring", "-ss", "Process only absolute paths containing this substring."};
@@ -96,6 +107,10 @@ constexpr auto substring_arg =
 constexpr auto dry_run_arg =
 	optional_arg{"--dry-run", "-dr", "Retrieve all files that would be affected but do not make any changes."};
 
+constexpr auto watch_arg = optional_arg{"--watch", "-w",
+	"After encoding, keep watching the input for PNG files being written and encode them as soon as they change. Only "
+	"available on Linux."};
+
 constexpr auto progress_arg = optional_argument("--progress", "Display progress messages.");
 
 constexpr auto verbose_arg = optional_argument("--verbose", "Display all input files of the current operation.");
@@ -107,8 +122,75 @@ constexpr auto alpha_black_arg = optional_arg{"--bc1-alpha-black", "-bc1-ab",
 	"The BC1 encoder will use 3 color blocks for blocks containing black or very dark pixels. Increases texture quality "
 	"substantially, but programs using these textures must ignore the alpha channel."};
 
-constexpr auto report_arg =
-	optional_arg{"--report", "-rp", "Prints information about the encoding process of each file."};
+constexpr auto report_arg = optional_arg{"--report", "-rp",
+	"Prints information about each file as soon as it has been processed, separated by semicolons: its size, format "
+	"and transparency, the size of its input and output files, the time spent by each stage on it and the error which "
+	"prevented its encoding, if any."};
+
+constexpr auto default_block_cache = todds::cache::scope::none;
+constexpr auto block_cache_arg =
+	optional_arg{"--block-cache", "-bc", "Reuse the encoded data of identical 4x4 pixel blocks."};
+
+constexpr std::size_t default_block_cache_size = 256UL;
+constexpr auto block_cache_size_arg = optional_arg{
+	"--block-cache-size", "-bcs", "Maximum memory used by each block cache in MiB. Defaults to {:d}."};
+
+constexpr auto transparent_blocks_arg = optional_arg{"--transparent-blocks", "-tb",
+	"BC3 and BC7 encoders skip the color search of blocks in which every pixel is fully transparent, discarding their "
+	"RGB values. Programs using these textures must ignore the color of fully transparent pixels."};
+
+constexpr auto adaptive_quality_arg = optional_arg{"--adaptive-quality", "-aq",
+	"Encode low complexity blocks with this quality level, reserving the quality level of the image for complex blocks. "
+	"Must be lower than the encoder quality level."};
+
+constexpr double default_adaptive_threshold = 16.0;
+constexpr auto adaptive_threshold_arg = optional_arg{"--adaptive-threshold", "-at",
+	"Blocks with an average channel variance below this value are considered low complexity. Defaults to {:.2f}."};
+
+constexpr auto rdo_lambda_arg = optional_arg{"--rdo-lambda", "-rl",
+	"Rate-distortion optimization for BC1 and BC7. Replaces blocks with copies of similar previous blocks, making DDS "
+	"files smaller after zip compression at the cost of quality. Higher values trade more quality for smaller files. "
+	"Values between 0.5 and 4.0 are recommended. Disabled by default."};
+
+constexpr auto fast_pass_arg = optional_arg{"--fast-pass", "-fp",
+	"Two-tier encoding for BC1, BC3 and BC7. Images are encoded with this quality level first, and only regions with a "
+	"PSNR below the fast pass PSNR are encoded again with the encoder quality level. Must be lower than the encoder "
+	"quality level."};
+
+constexpr double default_fast_pass_psnr = 45.0;
+constexpr auto fast_pass_psnr_arg = optional_arg{"--fast-pass-psnr", "-fpp",
+	"Regions encoded by the fast pass with a PSNR below this value are encoded again. Defaults to {:.2f}."};
+
+constexpr auto default_cpu_target = todds::cpu::target::automatic;
+constexpr auto cpu_target_arg = optional_arg{"--cpu-target", "-ct",
+	"Instruction set used by the BC7 encoder. Only available in builds including several ISPC targets. If the CPU does "
+	"not support the requested instruction set, the fastest supported one is used instead."};
+
+constexpr auto quality_metrics_arg = optional_arg{"--quality-metrics", "-qm",
+	"Decode each DDS file after encoding it and measure its PSNR and SSIM. Displays a summary of the results, and adds "
+	"them to the output of --report."};
+
+constexpr auto stats_arg = optional_arg{"--stats", "-st",
+	"Measure the latency, throughput and waiting time of each stage of the pipeline, as well as its memory usage, and "
+	"display them when it finishes. On Linux, sending SIGUSR1 to todds displays them while the pipeline is running."};
+
+constexpr auto pack_arg = optional_arg{"--pack", "-pk",
+	"Write every DDS file into this pack file instead of creating them separately. DDS files inside of the directory of "
+	"the pack file are stored using relative paths. Use tools/unpack.py to list, verify or extract its contents."};
+
+constexpr auto shard_arg = optional_arg{"--shard", "-sh",
+	"Split the input files between several processes, and only encode the files of one of them. Takes the shard of "
+	"this process and the number of shards, such as 2/4. Files are balanced using the size of each image. Every "
+	"process must receive the same files and options."};
+
+constexpr auto merge_reports_arg = optional_arg{"--merge-reports", "-mr",
+	"Instead of encoding files, merge the output of --report from each shard and print it sorted by file, followed "
+	"by a summary. The input must be a report or a directory containing reports with the .csv extension."};
+
+constexpr auto skip_unchanged_arg = optional_arg{"--skip-unchanged", "-su",
+	"Compare each encoded file with the existing output file, and leave it untouched if their contents are identical, "
+	"keeping its modification time. Only useful together with --overwrite or --overwrite-new. Displays how many files "
+	"were not written again."};
 
 // Positional arguments.
 constexpr std::string_view input_name = "input";
@@ -127,6 +209,7 @@ consteval std::size_t argument_name_total_space() {
 	max_space = std::max(max_space, clean_arg.name.size() + clean_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, format_arg.name.size() + format_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, alpha_format_arg.name.size() + alpha_format_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, grayscale_format_arg.name.size() + grayscale_format_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, quality_arg.name.size() + quality_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, no_mipmaps_arg.name.size() + no_mipmaps_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, fix_size_arg.name.size() + fix_size_arg.shorter.size() + 2UL);
@@ -142,13 +225,30 @@ consteval std::size_t argument_name_total_space() {
 	max_space = std::max(max_space, vflip_arg.name.size() + vflip_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, time_arg.name.size() + time_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, dry_run_arg.name.size() + dry_run_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, watch_arg.name.size() + watch_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, progress_arg.name.size() + progress_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, verbose_arg.name.size() + verbose_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, regex_arg.name.size() + regex_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, exclude_arg.name.size() + exclude_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, substring_arg.name.size() + substring_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, help_arg.name.size() + help_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, alpha_black_arg.name.size() + alpha_black_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, report_arg.name.size() + report_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, block_cache_arg.name.size() + block_cache_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, block_cache_size_arg.name.size() + block_cache_size_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, transparent_blocks_arg.name.size() + transparent_blocks_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, adaptive_quality_arg.name.size() + adaptive_quality_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, adaptive_threshold_arg.name.size() + adaptive_threshold_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, rdo_lambda_arg.name.size() + rdo_lambda_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, fast_pass_arg.name.size() + fast_pass_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, fast_pass_psnr_arg.name.size() + fast_pass_psnr_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, cpu_target_arg.name.size() + cpu_target_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, quality_metrics_arg.name.size() + quality_metrics_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, stats_arg.name.size() + stats_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, pack_arg.name.size() + pack_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, shard_arg.name.size() + shard_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, merge_reports_arg.name.size() + merge_reports_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, skip_unchanged_arg.name.size() + skip_unchanged_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, input_name.size());
 	max_space = std::max(max_space, output_name.size());
 
@@ -196,6 +296,39 @@ void print_filter_options(std::ostringstream& ostream, todds::filter::type defau
 	}
 }
 
+void print_cache_options(std::ostringstream& ostream, todds::cache::scope default_value) {
+	const todds::string default_str = fmt::format("{:s} [Default]", todds::cache::description(default_value));
+	print_string_argument(ostream, todds::cache::name(default_value), default_str);
+
+	constexpr std::array<todds::cache::scope, 3U> cache_scopes{
+		todds::cache::scope::none,
+		todds::cache::scope::image,
+		todds::cache::scope::batch,
+	};
+	for (auto cache_scope : cache_scopes) {
+		if (cache_scope == default_value) { continue; }
+		print_string_argument(ostream, todds::cache::name(cache_scope), todds::cache::description(cache_scope));
+	}
+}
+
+void print_cpu_target_options(std::ostringstream& ostream, todds::cpu::target default_value) {
+	const todds::string default_str = fmt::format("{:s} [Default]", todds::cpu::description(default_value));
+	print_string_argument(ostream, todds::cpu::name(default_value), default_str);
+
+	constexpr std::array<todds::cpu::target, 6U> cpu_targets{
+		todds::cpu::target::automatic,
+		todds::cpu::target::sse2,
+		todds::cpu::target::sse4,
+		todds::cpu::target::avx,
+		todds::cpu::target::avx2,
+		todds::cpu::target::avx512,
+	};
+	for (auto cpu_target : cpu_targets) {
+		if (cpu_target == default_value) { continue; }
+		print_string_argument(ostream, todds::cpu::name(cpu_target), todds::cpu::description(cpu_target));
+	}
+}
+
 todds::string get_help(std::size_t max_threads) {
 	std::ostringstream ostream;
 	ostream << todds::project::name() << ' ' << todds::project::version() << "\n\n"
@@ -218,6 +351,10 @@ todds::string get_help(std::size_t max_threads) {
 	print_string_argument(ostream, todds::format::name(todds::format::type::bc1), "Highly compressed RGB data.");
 	print_string_argument(
 		ostream, todds::format::name(todds::format::type::bc3), "Highly compressed data supporting alpha.");
+	print_string_argument(ostream, todds::format::name(todds::format::type::bc4),
+		"Single channel data stored in red, such as masks and grayscale textures.");
+	print_string_argument(ostream, todds::format::name(todds::format::type::bc5),
+		"Two channel data stored in red and green, such as normal maps.");
 	print_string_argument(ostream, todds::format::name(todds::format::type::png),
 		"PNG format, intended for downscaling or metric calculation.");
 	print_optional_argument(ostream, alpha_format_arg);
@@ -226,6 +363,10 @@ todds::string get_help(std::size_t max_threads) {
 	print_string_argument(
 		ostream, todds::format::name(todds::format::type::bc3), "Highly compressed data supporting alpha.");
 
+	print_optional_argument(ostream, grayscale_format_arg);
+	print_string_argument(ostream, todds::format::name(todds::format::type::bc4),
+		"Single channel data. Programs using these textures must only read the red channel.");
+
 	const todds::string quality_help =
 		fmt::format(quality_arg.help, static_cast<unsigned int>(todds::format::quality::minimum),
 			static_cast<unsigned int>(todds::format::quality::maximum), static_cast<unsigned int>(default_quality));
@@ -255,9 +396,11 @@ todds::string get_help(std::size_t max_threads) {
 	print_optional_argument(ostream, time_arg);
 #if defined(TODDS_REGULAR_EXPRESSIONS)
 	print_optional_argument(ostream, regex_arg);
+	print_optional_argument(ostream, exclude_arg);
 #endif // defined(TODDS_REGULAR_EXPRESSIONS)
 	print_optional_argument(ostream, substring_arg);
 	print_optional_argument(ostream, dry_run_arg);
+	print_optional_argument(ostream, watch_arg);
 	print_optional_argument(ostream, progress_arg);
 	print_optional_argument(ostream, verbose_arg);
 	print_optional_argument(ostream, help_arg);
@@ -266,6 +409,26 @@ todds::string get_help(std::size_t max_threads) {
 
 	print_optional_argument(ostream, alpha_black_arg);
 	print_optional_argument(ostream, report_arg);
+	print_optional_argument(ostream, block_cache_arg);
+	print_cache_options(ostream, default_block_cache);
+	const todds::string block_cache_size_help = fmt::format(block_cache_size_arg.help, default_block_cache_size);
+	print_argument_impl(ostream, block_cache_size_arg.shorter, block_cache_size_arg.name, block_cache_size_help);
+	print_optional_argument(ostream, transparent_blocks_arg);
+	print_optional_argument(ostream, adaptive_quality_arg);
+	const todds::string adaptive_threshold_help = fmt::format(adaptive_threshold_arg.help, default_adaptive_threshold);
+	print_argument_impl(ostream, adaptive_threshold_arg.shorter, adaptive_threshold_arg.name, adaptive_threshold_help);
+	print_optional_argument(ostream, rdo_lambda_arg);
+	print_optional_argument(ostream, fast_pass_arg);
+	const todds::string fast_pass_psnr_help = fmt::format(fast_pass_psnr_arg.help, default_fast_pass_psnr);
+	print_argument_impl(ostream, fast_pass_psnr_arg.shorter, fast_pass_psnr_arg.name, fast_pass_psnr_help);
+	print_optional_argument(ostream, cpu_target_arg);
+	print_cpu_target_options(ostream, default_cpu_target);
+	print_optional_argument(ostream, quality_metrics_arg);
+	print_optional_argument(ostream, stats_arg);
+	print_optional_argument(ostream, pack_arg);
+	print_optional_argument(ostream, shard_arg);
+	print_optional_argument(ostream, merge_reports_arg);
+	print_optional_argument(ostream, skip_unchanged_arg);
 
 	return std::move(ostream).str();
 }
@@ -281,6 +444,10 @@ todds::format::type parse_format(std::string_view argument) {
 		format = todds::format::type::bc1;
 	} else if (argument == todds::format::name(todds::format::type::bc3)) {
 		format = todds::format::type::bc3;
+	} else if (argument == todds::format::name(todds::format::type::bc4)) {
+		format = todds::format::type::bc4;
+	} else if (argument == todds::format::name(todds::format::type::bc5)) {
+		format = todds::format::type::bc5;
 	} else if (argument == todds::format::name(todds::format::type::bc7)) {
 		format = todds::format::type::bc7;
 	} else if (argument == todds::format::name(todds::format::type::png)) {
@@ -324,6 +491,16 @@ void alpha_format_from_str(std::string_view argument, todds::args::data& parsed_
 	}
 }
 
+void grayscale_format_from_str(std::string_view argument, todds::args::data& parsed_arguments) {
+	const todds::string argument_upper = todds::to_upper_copy(std::string{argument});
+	const auto format = parse_format(argument_upper);
+	if (format == todds::format::type::invalid || format == todds::format::type::png) {
+		parsed_arguments.stop_message = fmt::format("Argument error: invalid encoding grayscale format: {:s}", argument);
+	} else {
+		parsed_arguments.grayscale_format = format;
+	}
+}
+
 todds::filter::type filter_from_str(std::string_view argument, todds::args::data& parsed_arguments) {
 	const todds::string argument_upper = todds::to_upper_copy(std::string{argument});
 	todds::filter::type value = todds::filter::type::lanczos;
@@ -341,6 +518,42 @@ todds::filter::type filter_from_str(std::string_view argument, todds::args::data
 	return value;
 }
 
+todds::cpu::target cpu_target_from_str(std::string_view argument, todds::args::data& parsed_arguments) {
+	const todds::string argument_upper = todds::to_upper_copy(std::string{argument});
+	todds::cpu::target value = default_cpu_target;
+	if (argument_upper == todds::cpu::name(todds::cpu::target::automatic)) {
+		value = todds::cpu::target::automatic;
+	} else if (argument_upper == todds::cpu::name(todds::cpu::target::sse2)) {
+		value = todds::cpu::target::sse2;
+	} else if (argument_upper == todds::cpu::name(todds::cpu::target::sse4)) {
+		value = todds::cpu::target::sse4;
+	} else if (argument_upper == todds::cpu::name(todds::cpu::target::avx)) {
+		value = todds::cpu::target::avx;
+	} else if (argument_upper == todds::cpu::name(todds::cpu::target::avx2)) {
+		value = todds::cpu::target::avx2;
+	} else if (argument_upper == todds::cpu::name(todds::cpu::target::avx512)) {
+		value = todds::cpu::target::avx512;
+	} else {
+		parsed_arguments.stop_message = fmt::format("Argument error: unsupported CPU target: {:s}", argument);
+	}
+	return value;
+}
+
+todds::cache::scope cache_from_str(std::string_view argument, todds::args::data& parsed_arguments) {
+	const todds::string argument_upper = todds::to_upper_copy(std::string{argument});
+	todds::cache::scope value = default_block_cache;
+	if (argument_upper == todds::cache::name(todds::cache::scope::none)) {
+		value = todds::cache::scope::none;
+	} else if (argument_upper == todds::cache::name(todds::cache::scope::image)) {
+		value = todds::cache::scope::image;
+	} else if (argument_upper == todds::cache::name(todds::cache::scope::batch)) {
+		value = todds::cache::scope::batch;
+	} else {
+		parsed_arguments.stop_message = fmt::format("Argument error: unsupported block cache: {:s}", argument);
+	}
+	return value;
+}
+
 template<typename Type>
 void argument_from_str(
 	std::string_view argument_name, std::string_view argument, Type& value, todds::args::data& parsed_arguments) {
@@ -350,6 +563,25 @@ void argument_from_str(
 	}
 }
 
+void shard_from_str(std::string_view argument, todds::args::data& parsed_arguments) {
+	const std::size_t separator = argument.find('/');
+	if (separator != std::string_view::npos) {
+		const std::string_view shard = argument.substr(0U, separator);
+		const std::string_view count = argument.substr(separator + 1U);
+		const auto [shard_end, shard_error] =
+			std::from_chars(shard.data(), shard.data() + shard.size(), parsed_arguments.shard);
+		const auto [count_end, count_error] =
+			std::from_chars(count.data(), count.data() + count.size(), parsed_arguments.shard_count);
+		if (shard_error == std::errc{} && count_error == std::errc{} && shard_end == shard.data() + shard.size() &&
+				count_end == count.data() + count.size() && parsed_arguments.shard >= 1U &&
+				parsed_arguments.shard <= parsed_arguments.shard_count) {
+			return;
+		}
+	}
+	parsed_arguments.stop_message = fmt::format(
+		"Argument error: {:s} must be a shard followed by the number of shards, such as 1/4.", shard_arg.name);
+}
+
 // libc++ (used on MacOS by default) lacks support for the floating-point part of P0067R5.
 // Until that is addressed, it is not possible to use from_chars with variables of type double.
 template<>
@@ -382,6 +614,7 @@ data get(const todds::vector<std::string_view>& arguments) {
 	// Set default values.
 	parsed_arguments.format = format::type::bc7;
 	parsed_arguments.alpha_format = format::type::invalid;
+	parsed_arguments.grayscale_format = format::type::invalid;
 	parsed_arguments.mipmaps = true;
 	parsed_arguments.mipmap_filter = filter::type::lanczos;
 	parsed_arguments.mipmap_blur = default_mipmap_blur;
@@ -391,8 +624,16 @@ data get(const todds::vector<std::string_view>& arguments) {
 	parsed_arguments.threads = max_threads;
 	parsed_arguments.depth = max_depth;
 	parsed_arguments.quality = default_quality;
+	parsed_arguments.block_cache = default_block_cache;
+	parsed_arguments.block_cache_size = default_block_cache_size;
+	parsed_arguments.adaptive_threshold = default_adaptive_threshold;
+	parsed_arguments.fast_pass_psnr = default_fast_pass_psnr;
+	parsed_arguments.cpu_target = default_cpu_target;
 
 	std::size_t index = 1UL;
+	// Every regular expression is compiled into a single database after parsing.
+	todds::vector<std::string_view> include_patterns;
+	todds::vector<std::string_view> exclude_patterns;
 
 	// Parse all positional arguments.
 	while (parsed_arguments.stop_message.empty() && index < arguments.size()) {
@@ -420,6 +661,9 @@ data get(const todds::vector<std::string_view>& arguments) {
 		} else if (matches(argument, alpha_format_arg)) {
 			++index;
 			alpha_format_from_str(next_argument, parsed_arguments);
+		} else if (matches(argument, grayscale_format_arg)) {
+			++index;
+			grayscale_format_from_str(next_argument, parsed_arguments);
 		} else if (matches(argument, mipmap_filter_arg)) {
 			++index;
 			parsed_arguments.mipmap_filter = filter_from_str(next_argument, parsed_arguments);
@@ -464,12 +708,10 @@ data get(const todds::vector<std::string_view>& arguments) {
 #if defined(TODDS_REGULAR_EXPRESSIONS)
 		} else if (matches(argument, regex_arg)) {
 			++index;
-			parsed_arguments.regex = todds::regex{next_argument};
-			const auto regex_err = parsed_arguments.regex.error();
-			if (!regex_err.empty()) {
-				parsed_arguments.stop_message =
-					fmt::format("Could not compile regular expression {:s}: {:s}", next_argument, regex_err);
-			}
+			include_patterns.push_back(next_argument);
+		} else if (matches(argument, exclude_arg)) {
+			++index;
+			exclude_patterns.push_back(next_argument);
 #endif // defined(TODDS_REGULAR_EXPRESSIONS)
 		} else if (matches(argument, substring_arg)) {
 			++index;
@@ -484,6 +726,8 @@ data get(const todds::vector<std::string_view>& arguments) {
 			parsed_arguments.time = true;
 		} else if (matches(argument, dry_run_arg)) {
 			parsed_arguments.dry_run = true;
+		} else if (matches(argument, watch_arg)) {
+			parsed_arguments.watch = true;
 		} else if (matches(argument, progress_arg)) {
 			parsed_arguments.progress = true;
 		} else if (matches(argument, verbose_arg)) {
@@ -492,6 +736,71 @@ data get(const todds::vector<std::string_view>& arguments) {
 			parsed_arguments.alpha_black = true;
 		} else if (matches(argument, report_arg)) {
 			parsed_arguments.report = true;
+		} else if (matches(argument, block_cache_arg)) {
+			++index;
+			parsed_arguments.block_cache = cache_from_str(next_argument, parsed_arguments);
+		} else if (matches(argument, block_cache_size_arg)) {
+			++index;
+			argument_from_str(block_cache_size_arg.name, next_argument, parsed_arguments.block_cache_size, parsed_arguments);
+			if (parsed_arguments.block_cache_size == 0UL) {
+				parsed_arguments.stop_message =
+					fmt::format("Argument error: {:s} must be larger than zero.", block_cache_size_arg.name);
+			}
+		} else if (matches(argument, transparent_blocks_arg)) {
+			parsed_arguments.transparent_blocks = true;
+		} else if (matches(argument, adaptive_quality_arg)) {
+			++index;
+			unsigned int value{};
+			argument_from_str(adaptive_quality_arg.name, next_argument, value, parsed_arguments);
+			parsed_arguments.adaptive_quality = static_cast<format::quality>(value);
+		} else if (matches(argument, adaptive_threshold_arg)) {
+			++index;
+			argument_from_str(
+				adaptive_threshold_arg.name, next_argument, parsed_arguments.adaptive_threshold, parsed_arguments);
+			if (parsed_arguments.adaptive_threshold <= 0.0) {
+				parsed_arguments.stop_message =
+					fmt::format("Argument error: {:s} must be larger than zero.", adaptive_threshold_arg.name);
+			}
+		} else if (matches(argument, rdo_lambda_arg)) {
+			++index;
+			argument_from_str(rdo_lambda_arg.name, next_argument, parsed_arguments.rdo_lambda, parsed_arguments);
+			if (parsed_arguments.rdo_lambda <= 0.0) {
+				parsed_arguments.stop_message =
+					fmt::format("Argument error: {:s} must be larger than zero.", rdo_lambda_arg.name);
+			}
+		} else if (matches(argument, fast_pass_arg)) {
+			++index;
+			unsigned int value{};
+			argument_from_str(fast_pass_arg.name, next_argument, value, parsed_arguments);
+			parsed_arguments.fast_pass = static_cast<format::quality>(value);
+		} else if (matches(argument, fast_pass_psnr_arg)) {
+			++index;
+			argument_from_str(fast_pass_psnr_arg.name, next_argument, parsed_arguments.fast_pass_psnr, parsed_arguments);
+			if (parsed_arguments.fast_pass_psnr <= 0.0) {
+				parsed_arguments.stop_message =
+					fmt::format("Argument error: {:s} must be larger than zero.", fast_pass_psnr_arg.name);
+			}
+		} else if (matches(argument, cpu_target_arg)) {
+			++index;
+			parsed_arguments.cpu_target = cpu_target_from_str(next_argument, parsed_arguments);
+		} else if (matches(argument, quality_metrics_arg)) {
+			parsed_arguments.quality_metrics = true;
+		} else if (matches(argument, stats_arg)) {
+			parsed_arguments.stats = true;
+		} else if (matches(argument, pack_arg)) {
+			++index;
+			if (next_argument.empty()) {
+				parsed_arguments.stop_message = fmt::format("Argument error: {:s} requires a path.", pack_arg.name);
+			} else {
+				parsed_arguments.pack = fs::absolute(fs::path{next_argument.data()});
+			}
+		} else if (matches(argument, shard_arg)) {
+			++index;
+			shard_from_str(next_argument, parsed_arguments);
+		} else if (matches(argument, merge_reports_arg)) {
+			parsed_arguments.merge_reports = true;
+		} else if (matches(argument, skip_unchanged_arg)) {
+			parsed_arguments.skip_unchanged = true;
 		} else {
 			parsed_arguments.stop_message = fmt::format("Invalid positional argument {:s}", argument);
 		}
@@ -504,6 +813,14 @@ data get(const todds::vector<std::string_view>& arguments) {
 		++index;
 	}
 
+	if (parsed_arguments.stop_message.empty() && (!include_patterns.empty() || !exclude_patterns.empty())) {
+		parsed_arguments.regex = todds::regex{include_patterns, exclude_patterns};
+		const auto regex_err = parsed_arguments.regex.error();
+		if (!regex_err.empty()) {
+			parsed_arguments.stop_message = fmt::format("Could not compile regular expression {:s}", regex_err);
+		}
+	}
+
 	if (parsed_arguments.stop_message.empty()) {
 		if (index < arguments.size()) {
 			boost::system::error_code error_code;
@@ -523,6 +840,49 @@ data get(const todds::vector<std::string_view>& arguments) {
 		}
 	}
 
+	if (parsed_arguments.stop_message.empty() && parsed_arguments.watch &&
+			(parsed_arguments.clean || parsed_arguments.dry_run)) {
+		parsed_arguments.stop_message = fmt::format("Argument error: {:s} cannot be used together with {:s} or {:s}.",
+			watch_arg.name, clean_arg.name, dry_run_arg.name);
+	}
+
+	if (parsed_arguments.stop_message.empty() && parsed_arguments.pack.has_value()) {
+		if (parsed_arguments.format == format::type::png) {
+			parsed_arguments.stop_message = fmt::format(
+				"Argument error: {:s} does not support format {:s}.", pack_arg.name, format::name(format::type::png));
+		} else if (parsed_arguments.clean || parsed_arguments.watch) {
+			parsed_arguments.stop_message = fmt::format("Argument error: {:s} cannot be used together with {:s} or {:s}.",
+				pack_arg.name, clean_arg.name, watch_arg.name);
+		} else if (parsed_arguments.skip_unchanged) {
+			parsed_arguments.stop_message =
+				fmt::format("Argument error: {:s} cannot be used together with {:s}.", pack_arg.name, skip_unchanged_arg.name);
+		}
+	}
+
+	if (parsed_arguments.stop_message.empty() && parsed_arguments.shard_count > 1U &&
+			(parsed_arguments.watch || parsed_arguments.merge_reports)) {
+		parsed_arguments.stop_message = fmt::format("Argument error: {:s} cannot be used together with {:s} or {:s}.",
+			shard_arg.name, watch_arg.name, merge_reports_arg.name);
+	}
+
+	if (parsed_arguments.stop_message.empty() && parsed_arguments.merge_reports &&
+			(parsed_arguments.watch || parsed_arguments.clean)) {
+		parsed_arguments.stop_message = fmt::format("Argument error: {:s} cannot be used together with {:s} or {:s}.",
+			merge_reports_arg.name, watch_arg.name, clean_arg.name);
+	}
+
+	if (parsed_arguments.stop_message.empty() && parsed_arguments.adaptive_quality.has_value() &&
+			parsed_arguments.adaptive_quality >= parsed_arguments.quality) {
+		parsed_arguments.stop_message = fmt::format("Argument error: {:s} must be lower than {:s}.",
+			adaptive_quality_arg.name, quality_arg.name);
+	}
+
+	if (parsed_arguments.stop_message.empty() && parsed_arguments.fast_pass.has_value() &&
+			parsed_arguments.fast_pass >= parsed_arguments.quality) {
+		parsed_arguments.stop_message =
+			fmt::format("Argument error: {:s} must be lower than {:s}.", fast_pass_arg.name, quality_arg.name);
+	}
+
 	if (parsed_arguments.stop_message.empty() && parsed_arguments.format == format::type::png) {
 		parsed_arguments.mipmaps = false;
 		const std::string_view format_name = format::name(format::type::png);
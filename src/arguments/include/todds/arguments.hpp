@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "todds/cache.hpp"
+#include "todds/cpu.hpp"
 #include "todds/filter.hpp"
 #include "todds/format.hpp"
 #include "todds/regex.hpp"
@@ -32,6 +34,7 @@ struct data {
 	bool clean;
 	todds::format::type format;
 	todds::format::type alpha_format;
+	todds::format::type grayscale_format;
 	todds::format::quality quality;
 	bool fix_size;
 	bool mipmaps;
@@ -48,11 +51,41 @@ struct data {
 	bool time;
 	bool verbose;
 	bool report;
+	/** Include and exclude patterns applied to input paths. */
 	todds::regex regex;
 	string substring;
 	bool dry_run;
+	/** Keep encoding input files as they change after the first run. */
+	bool watch;
 	bool progress;
 	bool alpha_black;
+	todds::cache::scope block_cache;
+	/** Maximum memory used by each block cache, in MiB. */
+	std::size_t block_cache_size;
+	bool transparent_blocks;
+	/** Quality level used for low complexity blocks. Adaptive quality is disabled if it is not set. */
+	std::optional<todds::format::quality> adaptive_quality;
+	double adaptive_threshold;
+	/** Rate-distortion optimization lambda. Rate-distortion optimization is disabled if it is zero. */
+	double rdo_lambda;
+	/** Quality level of the first pass of two-tier encoding. Two-tier encoding is disabled if it is not set. */
+	std::optional<todds::format::quality> fast_pass;
+	double fast_pass_psnr;
+	/** Instruction set used by the BC7 encoder. */
+	todds::cpu::target cpu_target;
+	bool quality_metrics;
+	/** Measure the performance of each stage of the pipeline. */
+	bool stats;
+	/** Write every DDS file into this pack file instead of creating them separately. */
+	std::optional<boost::filesystem::path> pack;
+	/** Shard of the input files processed by this process, starting from 1. */
+	std::size_t shard;
+	/** Number of processes splitting the input files between them. Sharding is disabled if it is lower than 2. */
+	std::size_t shard_count;
+	/** Merge the reports of every shard instead of encoding files. */
+	bool merge_reports;
+	/** Leave output files untouched if they already contain the encoded data. */
+	bool skip_unchanged;
 };
 
 /**
@@ -0,0 +1,104 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/block_cache.hpp"
+
+#include "todds/image_types.hpp"
+
+#include <oneapi/tbb/concurrent_unordered_map.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::size_t pixel_block_size = todds::pixel_block_side * todds::pixel_block_side;
+
+struct block_key {
+	std::array<std::uint32_t, pixel_block_size> pixels;
+	std::uint64_t encoder;
+
+	bool operator==(const block_key& other) const noexcept = default;
+};
+
+struct block_key_hash {
+	std::size_t operator()(const block_key& key) const noexcept {
+		// Mixing function from MurmurHash3, applied to every pair of pixels.
+		std::uint64_t hash = key.encoder ^ 0x9E3779B97F4A7C15ULL;
+		for (std::size_t index = 0U; index < pixel_block_size; index += 2U) {
+			hash ^= (static_cast<std::uint64_t>(key.pixels[index]) << 32U) | key.pixels[index + 1U];
+			hash *= 0xFF51AFD7ED558CCDULL;
+			hash ^= hash >> 33U;
+		}
+		return hash;
+	}
+};
+
+block_key make_key(std::uint64_t encoder, const std::uint32_t* pixel_block) {
+	block_key key{};
+	std::copy(pixel_block, pixel_block + pixel_block_size, key.pixels.begin());
+	key.encoder = encoder;
+	return key;
+}
+
+using block_map =
+	oneapi::tbb::concurrent_unordered_map<block_key, todds::dds::block_cache::encoded_block, block_key_hash>;
+
+// Approximate memory used by each entry, including the list node and bucket overhead of the map.
+constexpr std::size_t entry_memory = sizeof(block_map::value_type) + 4U * sizeof(void*);
+
+} // anonymous namespace
+
+namespace todds::dds {
+
+class block_cache_pimpl final {
+public:
+	block_cache_pimpl(std::size_t max_memory, block_cache_statistics& statistics)
+		: _max_entries{max_memory / entry_memory}
+		, _statistics{statistics}
+		, _blocks{} {}
+
+	[[nodiscard]] bool find(std::uint64_t encoder, const std::uint32_t* pixel_block, block_cache::encoded_block& result) {
+		const auto itr = _blocks.find(make_key(encoder, pixel_block));
+		if (itr == _blocks.end()) { return false; }
+		result = itr->second;
+		return true;
+	}
+
+	void insert(std::uint64_t encoder, const std::uint32_t* pixel_block, const block_cache::encoded_block& block) {
+		// Concurrent insertions may exceed the limit by a few entries, which is acceptable.
+		if (_blocks.size() >= _max_entries) [[unlikely]] {
+			++_statistics.rejected;
+			return;
+		}
+		_blocks.emplace(make_key(encoder, pixel_block), block);
+	}
+
+	void record(std::size_t hits, std::size_t misses) noexcept {
+		_statistics.hits += hits;
+		_statistics.misses += misses;
+	}
+
+private:
+	std::size_t _max_entries;
+	block_cache_statistics& _statistics;
+	block_map _blocks;
+};
+
+block_cache::block_cache(std::size_t max_memory, block_cache_statistics& statistics)
+	: _pimpl{std::make_unique<block_cache_pimpl>(max_memory, statistics)} {}
+
+block_cache::~block_cache() = default;
+
+bool block_cache::find(std::uint64_t encoder, const std::uint32_t* pixel_block, encoded_block& result) const {
+	return _pimpl->find(encoder, pixel_block, result);
+}
+
+void block_cache::insert(std::uint64_t encoder, const std::uint32_t* pixel_block, const encoded_block& block) {
+	_pimpl->insert(encoder, pixel_block, block);
+}
+
+void block_cache::record(std::size_t hits, std::size_t misses) noexcept { _pimpl->record(hits, misses); }
+
+} // namespace todds::dds
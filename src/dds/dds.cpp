@@ -10,6 +10,7 @@
 #include <dds_defs.h>
 
 #include <cassert>
+#include <mutex>
 
 #include "dds_impl.hpp"
 
@@ -20,6 +21,8 @@ constexpr std::uint32_t format_fourcc(todds::format::type format_type) {
 	switch (format_type) {
 	case todds::format::type::bc1: fourcc = PIXEL_FMT_FOURCC('D', 'X', 'T', '1'); break;
 	case todds::format::type::bc3: fourcc = PIXEL_FMT_FOURCC('D', 'X', 'T', '5'); break;
+	case todds::format::type::bc4:
+	case todds::format::type::bc5:
 	case todds::format::type::bc7: fourcc = PIXEL_FMT_FOURCC('D', 'X', '1', '0'); break;
 	case todds::format::type::png:
 	case todds::format::type::invalid: assert(false); break;
@@ -27,6 +30,20 @@ constexpr std::uint32_t format_fourcc(todds::format::type format_type) {
 	return fourcc;
 }
 
+constexpr DXGI_FORMAT format_dxgi(todds::format::type format_type) {
+	DXGI_FORMAT dxgi_format{DXGI_FORMAT_UNKNOWN};
+	switch (format_type) {
+	case todds::format::type::bc4: dxgi_format = DXGI_FORMAT_BC4_UNORM; break;
+	case todds::format::type::bc5: dxgi_format = DXGI_FORMAT_BC5_UNORM; break;
+	case todds::format::type::bc7: dxgi_format = DXGI_FORMAT_BC7_UNORM; break;
+	case todds::format::type::bc1:
+	case todds::format::type::bc3:
+	case todds::format::type::png:
+	case todds::format::type::invalid: assert(false); break;
+	}
+	return dxgi_format;
+}
+
 // dwWidth, dwHeight, dwLinearSize and ddpfPixelFormat.dwFourCC must be filled in later by the caller.
 // dwFlags and dwCaps may need to be modified.
 constexpr DDSURFACEDESC2 get_surface_description() noexcept {
@@ -48,11 +65,23 @@ constexpr DDSURFACEDESC2 get_surface_description() noexcept {
 
 namespace todds::dds {
 
-void initialize_encoding(format::type format, format::type alpha_format) {
-	if (format == format::type::bc1 || format == format::type::bc3 || alpha_format == format::type::bc3) {
-		impl::initialize_bcx_encoding();
+cpu::target initialize_encoding(
+	format::type format, format::type alpha_format, format::type grayscale_format, cpu::target cpu_target) {
+	const auto uses = [format, alpha_format, grayscale_format](format::type value) {
+		return format == value || alpha_format == value || grayscale_format == value;
+	};
+	if (uses(format::type::bc1) || uses(format::type::bc3) || uses(format::type::bc4) || uses(format::type::bc5)) {
+		// The tables of the BC1 to BC5 encoders do not depend on any setting.
+		static std::once_flag bcx_initialized;
+		std::call_once(bcx_initialized, impl::initialize_bcx_encoding);
 	}
-	if (format == format::type::bc7 || alpha_format == format::type::bc7) { impl::initialize_bc7_encoding(); }
+	if (!uses(format::type::bc7)) { return cpu::target::automatic; }
+
+	// Encoders running in other threads use the selected BC7 kernel, so it cannot be changed after choosing it.
+	static std::once_flag bc7_initialized;
+	static cpu::target bc7_target{};
+	std::call_once(bc7_initialized, [cpu_target] { bc7_target = impl::initialize_bc7_encoding(cpu_target); });
+	return bc7_target;
 }
 
 std::array<char, 124> dds_header(
@@ -74,4 +103,16 @@ std::array<char, 124> dds_header(
 	return header;
 }
 
+bool has_header_extension(todds::format::type format_type) noexcept {
+	return format_fourcc(format_type) == PIXEL_FMT_FOURCC('D', 'X', '1', '0');
+}
+
+std::array<char, 20> dds_header_extension(todds::format::type format_type) {
+	static_assert(sizeof(DDS_HEADER_DXT10) == std::tuple_size_v<std::array<char, 20>>);
+	std::array<char, 20> extension{};
+	new (extension.data())
+		DDS_HEADER_DXT10{format_dxgi(format_type), D3D10_RESOURCE_DIMENSION_TEXTURE2D, 0U, 1U, 0U};
+	return extension;
+}
+
 } // namespace todds::dds
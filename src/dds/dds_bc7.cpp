@@ -6,29 +6,85 @@
 #include "todds/dds.hpp"
 #include "todds/profiler.hpp"
 
-#include <oneapi/tbb/parallel_for.h>
-
 #include "dds_impl.hpp"
 
 namespace {
 
 constexpr std::size_t bc7_block_size = 2UL;
 
-using blocked_range = oneapi::tbb::blocked_range<size_t>;
+// Mode 6 block with every endpoint, p-bit and index set to zero.
+constexpr todds::dds::block_cache::encoded_block bc7_transparent_block{0x40ULL, 0ULL};
+
+using todds::dds::impl::pixel_block_size;
 
-constexpr std::size_t pixel_block_size = todds::pixel_block_side * todds::pixel_block_side;
+constexpr todds::dds::impl::decode_format bc7_format{bc7_block_size, 4U, todds::dds::impl::bc7_decode_block};
 
 } // namespace
 
 namespace todds::dds::impl {
-void initialize_bc7_encoding() {
+cpu::target initialize_bc7_encoding([[maybe_unused]] cpu::target target) {
 #ifdef TODDS_ISPC
-	ispc::bc7e_compress_block_init();
+	return initialize_bc7_kernel(target);
 #else
 	bc7enc_compress_block_init();
+	return cpu::target::automatic;
 #endif // TODDS_ISPC
 }
 
+const decode_format& bc7_decode_format() noexcept { return bc7_format; }
+
+std::uint64_t encoder_id(format::type format, const bc7_params& params) noexcept {
+	fnv1a_hash hash;
+	hash.add(format);
+#ifdef TODDS_ISPC
+	hash.add(params.m_max_partitions_mode);
+	hash.add(params.m_weights);
+	hash.add(params.m_uber_level);
+	hash.add(params.m_refinement_passes);
+	hash.add(params.m_mode4_rotation_mask);
+	hash.add(params.m_mode4_index_mask);
+	hash.add(params.m_mode5_rotation_mask);
+	hash.add(params.m_uber1_mask);
+	hash.add(params.m_perceptual);
+	hash.add(params.m_pbit_search);
+	hash.add(params.m_mode6_only);
+	const auto& opaque = params.m_opaque_settings;
+	hash.add(opaque.m_max_mode13_partitions_to_try);
+	hash.add(opaque.m_max_mode0_partitions_to_try);
+	hash.add(opaque.m_max_mode2_partitions_to_try);
+	hash.add(opaque.m_use_mode);
+	const auto& alpha = params.m_alpha_settings;
+	hash.add(alpha.m_max_mode7_partitions_to_try);
+	hash.add(alpha.m_mode67_error_weight_mul);
+	hash.add(alpha.m_use_mode4);
+	hash.add(alpha.m_use_mode5);
+	hash.add(alpha.m_use_mode6);
+	hash.add(alpha.m_use_mode7);
+	hash.add(alpha.m_use_mode4_rotation);
+	hash.add(alpha.m_use_mode5_rotation);
+#else
+	hash.add(params.m_mode_mask);
+	hash.add(params.m_max_partitions);
+	hash.add(params.m_weights);
+	hash.add(params.m_uber_level);
+	hash.add(params.m_perceptual);
+	hash.add(params.m_try_least_squares);
+	hash.add(params.m_mode17_partition_estimation_filterbank);
+	hash.add(params.m_force_alpha);
+	hash.add(params.m_force_selectors);
+	hash.add(params.m_selectors);
+	hash.add(params.m_quant_mode6_endpoints);
+	hash.add(params.m_bias_mode1_pbits);
+	hash.add(params.m_pbit1_weight);
+	hash.add(params.m_mode1_error_weight);
+	hash.add(params.m_mode5_error_weight);
+	hash.add(params.m_mode6_error_weight);
+	hash.add(params.m_mode7_error_weight);
+	hash.add(params.m_low_frequency_partition_weight);
+#endif // TODDS_ISPC
+	return hash.value();
+}
+
 } // namespace todds::dds::impl
 
 namespace todds::dds {
@@ -68,30 +124,44 @@ bc7_params bc7_encode_params(todds::format::quality quality) noexcept {
 	return params;
 }
 
-vector<std::uint64_t> bc7_encode(const bc7_params& params, const vector<std::uint32_t>& image) {
-	constexpr std::size_t grain_size = 64ULL;
-	static oneapi::tbb::affinity_partitioner partitioner;
+dds_image bc7_encode(const bc7_params& params, const pixel_block_image& image, const encode_options& options) {
 	const std::size_t num_blocks = image.size() / pixel_block_size;
 
-	vector<std::uint64_t> result(num_blocks * bc7_block_size);
-
-	oneapi::tbb::parallel_for(
-		blocked_range(0UL, num_blocks, grain_size),
-		[&params, &image, &result](const blocked_range& range) {
+	dds_image result(num_blocks * bc7_block_size);
+
+	// Creates a callable encoding ranges of blocks with a set of parameters.
+	const auto encoder = [&options, &image, &result](const bc7_params& encoder_params) {
+		const std::array<bc7_params, impl::total_tiers> tier_params{
+			encoder_params,
+			options.complexity_threshold > 0.0F ? bc7_encode_params(options.low_complexity_quality) : encoder_params,
+		};
+		const impl::format_encoders encoders{
+			{impl::encoder_id(format::type::bc7, tier_params[impl::regular_tier]),
+				impl::encoder_id(format::type::bc7, tier_params[impl::low_complexity_tier])},
+			&bc7_transparent_block};
+		return [tier_params, encoders, &options, &image, &result](std::size_t begin, std::size_t end) {
 			TracyZoneScopedN("bc7");
-			const std::size_t block_index = range.begin();
-			const auto blocks_to_process = static_cast<std::uint32_t>(range.end() - block_index);
-			std::uint64_t* dds_block = &result[block_index * bc7_block_size];
-			const auto* pixel_block = &image[block_index * pixel_block_size];
+			impl::encode_range<bc7_block_size>(options, encoders, begin, end, image, result,
+				[&tier_params](impl::block_tier tier, std::uint64_t* dds_blocks, const std::uint32_t* pixel_blocks,
+					std::size_t blocks_to_process) {
+					const bc7_params& block_params = tier_params[tier];
 #ifdef TODDS_ISPC
-			ispc::bc7e_compress_blocks(static_cast<std::uint32_t>(blocks_to_process), dds_block, pixel_block, &params);
+					impl::bc7_compress_blocks(
+						static_cast<std::uint32_t>(blocks_to_process), dds_blocks, pixel_blocks, &block_params);
 #else
-			for (std::uint32_t index = 0U; index < blocks_to_process; ++index) {
-				bc7enc_compress_block(dds_block + bc7_block_size * index, pixel_block + pixel_block_size * index, &params);
-			}
+					for (std::size_t index = 0U; index < blocks_to_process; ++index) {
+						bc7enc_compress_block(
+							dds_blocks + bc7_block_size * index, pixel_blocks + pixel_block_size * index, &block_params);
+					}
 #endif // TODDS_ISPC
-		},
-		partitioner);
+				});
+		};
+	};
+
+	impl::encode_image(
+		options, bc7_format, image, result, encoder(params), encoder(bc7_encode_params(options.fast_pass_quality)));
+
+	if (options.rdo_lambda > 0.0F) { impl::optimize_rate(options, bc7_format, image, result); }
 
 	return result;
 }
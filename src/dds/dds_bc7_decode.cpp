@@ -0,0 +1,358 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "dds_impl.hpp"
+
+namespace {
+
+using todds::dds::impl::pixel_block_size;
+
+constexpr std::size_t partitions = 64U;
+
+// Partition and anchor tables of the BC7 specification, as used by bc7enc.
+constexpr std::array<std::array<std::uint8_t, pixel_block_size>, partitions> partition_two_subsets{{
+	{0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1},
+	{0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1},
+	{0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1},
+	{0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1},
+	{0, 0, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1},
+	{0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1},
+	{0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1},
+	{0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1, 1},
+	{0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0},
+	{0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0},
+	{0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0},
+	{0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1},
+	{0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0},
+	{0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0},
+	{0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0},
+	{0, 0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0, 0},
+	{0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0},
+	{0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0},
+	{0, 1, 1, 1, 0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0},
+	{0, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0},
+	{0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1},
+	{0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1},
+	{0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0},
+	{0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0},
+	{0, 1, 0, 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0},
+	{0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1},
+	{0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1},
+	{0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 0},
+	{0, 0, 0, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0, 0, 0},
+	{0, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 1, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1, 1, 0, 0},
+	{0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0},
+	{0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1},
+	{0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1},
+	{0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0},
+	{0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0},
+	{0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0},
+	{0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0},
+	{0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1},
+	{0, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1},
+	{0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0},
+	{0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 0},
+	{0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 1},
+	{0, 1, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0, 1},
+	{0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 1},
+	{0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1},
+	{0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1},
+	{0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0},
+	{0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0},
+	{0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1},
+}};
+
+constexpr std::array<std::array<std::uint8_t, pixel_block_size>, partitions> partition_three_subsets{{
+	{0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2},
+	{0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1},
+	{0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+	{0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2},
+	{0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2},
+	{0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2},
+	{0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2},
+	{0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+	{0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2},
+	{0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2},
+	{0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2},
+	{0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+	{0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0},
+	{0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2},
+	{0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0},
+	{0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2},
+	{0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1},
+	{0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2},
+	{0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1},
+	{0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2},
+	{0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0},
+	{0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0},
+	{0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2},
+	{0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0},
+	{0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1},
+	{0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2},
+	{0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2},
+	{0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1},
+	{0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1},
+	{0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+	{0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1},
+	{0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2},
+	{0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0},
+	{0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0},
+	{0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0},
+	{0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0},
+	{0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1},
+	{0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1},
+	{0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+	{0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1},
+	{0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2},
+	{0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1},
+	{0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1},
+	{0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1},
+	{0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1},
+	{0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2},
+	{0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1},
+	{0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2},
+	{0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2},
+	{0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2},
+	{0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2},
+	{0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2},
+	{0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2},
+	{0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2},
+	{0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2},
+	{0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2},
+	{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2},
+	{0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1},
+	{0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2},
+	{0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2},
+	{0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0},
+}};
+
+constexpr std::array<std::uint8_t, partitions> anchor_second_subset{
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+	15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+	6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+};
+
+constexpr std::array<std::uint8_t, partitions> anchor_third_subset_1{
+	3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+	3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+	8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+	3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3,
+};
+
+constexpr std::array<std::uint8_t, partitions> anchor_third_subset_2{
+	15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+	15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+	15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+	15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8,
+};
+
+struct mode_info {
+	std::uint32_t subsets;
+	std::uint32_t partition_bits;
+	std::uint32_t rotation_bits;
+	std::uint32_t index_selection_bits;
+	std::uint32_t color_bits;
+	std::uint32_t alpha_bits;
+	std::uint32_t endpoint_pbits;
+	std::uint32_t shared_pbits;
+	std::uint32_t index_bits;
+	std::uint32_t second_index_bits;
+};
+
+constexpr std::size_t total_modes = 8U;
+
+constexpr std::array<mode_info, total_modes> modes{{
+	{3U, 4U, 0U, 0U, 4U, 0U, 1U, 0U, 3U, 0U},
+	{2U, 6U, 0U, 0U, 6U, 0U, 0U, 1U, 3U, 0U},
+	{3U, 6U, 0U, 0U, 5U, 0U, 0U, 0U, 2U, 0U},
+	{2U, 6U, 0U, 0U, 7U, 0U, 1U, 0U, 2U, 0U},
+	{1U, 0U, 2U, 1U, 5U, 6U, 0U, 0U, 2U, 3U},
+	{1U, 0U, 2U, 0U, 7U, 8U, 0U, 0U, 2U, 2U},
+	{1U, 0U, 0U, 0U, 7U, 7U, 1U, 0U, 4U, 0U},
+	{2U, 6U, 0U, 0U, 5U, 5U, 1U, 0U, 2U, 0U},
+}};
+
+constexpr std::array<std::uint32_t, 4U> weights2{0U, 21U, 43U, 64U};
+constexpr std::array<std::uint32_t, 8U> weights3{0U, 9U, 18U, 27U, 37U, 46U, 55U, 64U};
+constexpr std::array<std::uint32_t, 16U> weights4{
+	0U, 4U, 9U, 13U, 17U, 21U, 26U, 30U, 34U, 38U, 43U, 47U, 51U, 55U, 60U, 64U};
+
+std::uint32_t weight(std::uint32_t index_bits, std::uint32_t index) noexcept {
+	switch (index_bits) {
+	case 2U: return weights2[index];
+	case 3U: return weights3[index];
+	default: return weights4[index];
+	}
+}
+
+constexpr std::size_t channels = 4U;
+constexpr std::size_t alpha_channel = 3U;
+constexpr std::size_t max_endpoints = 6U;
+
+// Reads the bits of a block from the least significant bit of its first byte onwards.
+class bit_reader final {
+public:
+	explicit bit_reader(const std::uint64_t* dds_block) noexcept
+		: _low{dds_block[0U]}
+		, _high{dds_block[1U]}
+		, _position{} {}
+
+	std::uint32_t read(std::uint32_t bits) noexcept {
+		if (bits == 0U) { return 0U; }
+		std::uint64_t value{};
+		if (_position >= 64U) {
+			value = _high >> (_position - 64U);
+		} else {
+			value = _low >> _position;
+			if (_position > 0U) { value |= _high << (64U - _position); }
+		}
+		_position += bits;
+		return static_cast<std::uint32_t>(value & ((1ULL << bits) - 1ULL));
+	}
+
+private:
+	std::uint64_t _low;
+	std::uint64_t _high;
+	std::uint32_t _position;
+};
+
+std::uint32_t subset_of(const mode_info& mode, std::uint32_t partition, std::size_t pixel) noexcept {
+	switch (mode.subsets) {
+	case 2U: return partition_two_subsets[partition][pixel];
+	case 3U: return partition_three_subsets[partition][pixel];
+	default: return 0U;
+	}
+}
+
+bool is_anchor(const mode_info& mode, std::uint32_t partition, std::size_t pixel) noexcept {
+	switch (mode.subsets) {
+	case 2U: return pixel == 0U || pixel == anchor_second_subset[partition];
+	case 3U:
+		return pixel == 0U || pixel == anchor_third_subset_1[partition] || pixel == anchor_third_subset_2[partition];
+	default: return pixel == 0U;
+	}
+}
+
+std::uint32_t interpolate(std::uint32_t endpoint0, std::uint32_t endpoint1, std::uint32_t weight_value) noexcept {
+	return ((64U - weight_value) * endpoint0 + weight_value * endpoint1 + 32U) >> 6U;
+}
+
+} // namespace
+
+namespace todds::dds::impl {
+
+void bc7_decode_block(const std::uint64_t* dds_block, std::uint32_t* pixel_block) noexcept {
+	bit_reader reader{dds_block};
+	std::size_t mode_index = 0U;
+	while (mode_index < total_modes && reader.read(1U) == 0U) { ++mode_index; }
+	if (mode_index == total_modes) [[unlikely]] {
+		// Reserved mode, decoded as transparent black.
+		std::fill_n(pixel_block, pixel_block_size, 0U);
+		return;
+	}
+
+	const mode_info& mode = modes[mode_index];
+	const std::uint32_t partition = reader.read(mode.partition_bits);
+	const std::uint32_t rotation = reader.read(mode.rotation_bits);
+	const std::uint32_t index_selection = reader.read(mode.index_selection_bits);
+
+	const std::size_t num_endpoints = mode.subsets * 2U;
+	std::array<std::array<std::uint32_t, channels>, max_endpoints> endpoints{};
+	for (std::size_t channel = 0U; channel < alpha_channel; ++channel) {
+		for (std::size_t endpoint = 0U; endpoint < num_endpoints; ++endpoint) {
+			endpoints[endpoint][channel] = reader.read(mode.color_bits);
+		}
+	}
+	for (std::size_t endpoint = 0U; endpoint < num_endpoints; ++endpoint) {
+		endpoints[endpoint][alpha_channel] = reader.read(mode.alpha_bits);
+	}
+
+	std::array<std::uint32_t, max_endpoints> pbits{};
+	if (mode.endpoint_pbits != 0U) {
+		for (std::size_t endpoint = 0U; endpoint < num_endpoints; ++endpoint) { pbits[endpoint] = reader.read(1U); }
+	} else if (mode.shared_pbits != 0U) {
+		for (std::size_t subset = 0U; subset < mode.subsets; ++subset) {
+			pbits[subset * 2U] = pbits[subset * 2U + 1U] = reader.read(1U);
+		}
+	}
+	const std::uint32_t pbit_count = mode.endpoint_pbits + mode.shared_pbits;
+
+	// Expand endpoints to 8 bits by replicating their most significant bits.
+	for (std::size_t endpoint = 0U; endpoint < num_endpoints; ++endpoint) {
+		for (std::size_t channel = 0U; channel < channels; ++channel) {
+			std::uint32_t bits = channel == alpha_channel ? mode.alpha_bits : mode.color_bits;
+			if (bits == 0U) {
+				endpoints[endpoint][channel] = 255U;
+				continue;
+			}
+			std::uint32_t value = endpoints[endpoint][channel];
+			if (pbit_count != 0U) {
+				value = (value << 1U) | pbits[endpoint];
+				++bits;
+			}
+			value <<= 8U - bits;
+			endpoints[endpoint][channel] = value | (value >> bits);
+		}
+	}
+
+	std::array<std::uint32_t, pixel_block_size> color_indices{};
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		color_indices[pixel] = reader.read(mode.index_bits - (is_anchor(mode, partition, pixel) ? 1U : 0U));
+	}
+	std::array<std::uint32_t, pixel_block_size> alpha_indices = color_indices;
+	std::uint32_t color_index_bits = mode.index_bits;
+	std::uint32_t alpha_index_bits = mode.index_bits;
+	if (mode.second_index_bits != 0U) {
+		for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+			alpha_indices[pixel] = reader.read(mode.second_index_bits - (pixel == 0U ? 1U : 0U));
+		}
+		alpha_index_bits = mode.second_index_bits;
+		if (index_selection != 0U) {
+			std::swap(color_indices, alpha_indices);
+			std::swap(color_index_bits, alpha_index_bits);
+		}
+	}
+
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		const std::uint32_t subset = subset_of(mode, partition, pixel);
+		const auto& endpoint0 = endpoints[subset * 2U];
+		const auto& endpoint1 = endpoints[subset * 2U + 1U];
+		const std::uint32_t color_weight = weight(color_index_bits, color_indices[pixel]);
+		const std::uint32_t alpha_weight = weight(alpha_index_bits, alpha_indices[pixel]);
+		std::array<std::uint32_t, channels> color{};
+		for (std::size_t channel = 0U; channel < alpha_channel; ++channel) {
+			color[channel] = interpolate(endpoint0[channel], endpoint1[channel], color_weight);
+		}
+		color[alpha_channel] = interpolate(endpoint0[alpha_channel], endpoint1[alpha_channel], alpha_weight);
+		if (rotation != 0U) { std::swap(color[rotation - 1U], color[alpha_channel]); }
+		pixel_block[pixel] = color[0U] | (color[1U] << 8U) | (color[2U] << 16U) | (color[3U] << 24U);
+	}
+}
+
+} // namespace todds::dds::impl
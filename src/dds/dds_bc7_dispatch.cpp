@@ -0,0 +1,150 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/dds.hpp"
+
+#include "dds_impl.hpp"
+
+#ifdef TODDS_ISPC
+
+#ifdef TODDS_ISPC_MULTI_TARGET
+
+#include <algorithm>
+#include <array>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif // defined(_MSC_VER)
+
+// When compiling for several targets, ISPC appends the name of each target to its exported functions. The dispatch
+// functions of bc7e_ispc.h always choose the fastest target, so todds calls the functions of each target directly.
+extern "C" {
+void bc7e_compress_block_init_sse2();
+void bc7e_compress_block_init_sse4();
+void bc7e_compress_block_init_avx();
+void bc7e_compress_block_init_avx2();
+void bc7e_compress_block_init_avx512skx();
+void bc7e_compress_blocks_sse2(std::uint32_t num_blocks, std::uint64_t* pBlocks, const std::uint32_t* pPixelsRGBA,
+	const ispc::bc7e_compress_block_params* pComp_params);
+void bc7e_compress_blocks_sse4(std::uint32_t num_blocks, std::uint64_t* pBlocks, const std::uint32_t* pPixelsRGBA,
+	const ispc::bc7e_compress_block_params* pComp_params);
+void bc7e_compress_blocks_avx(std::uint32_t num_blocks, std::uint64_t* pBlocks, const std::uint32_t* pPixelsRGBA,
+	const ispc::bc7e_compress_block_params* pComp_params);
+void bc7e_compress_blocks_avx2(std::uint32_t num_blocks, std::uint64_t* pBlocks, const std::uint32_t* pPixelsRGBA,
+	const ispc::bc7e_compress_block_params* pComp_params);
+void bc7e_compress_blocks_avx512skx(std::uint32_t num_blocks, std::uint64_t* pBlocks,
+	const std::uint32_t* pPixelsRGBA, const ispc::bc7e_compress_block_params* pComp_params);
+}
+
+namespace {
+
+struct bc7_kernel {
+	todds::cpu::target target;
+	void (*init)();
+	void (*compress)(std::uint32_t, std::uint64_t*, const std::uint32_t*, const ispc::bc7e_compress_block_params*);
+};
+
+// Sorted from fastest to slowest.
+constexpr std::array<bc7_kernel, 5U> bc7_kernels{{
+	{todds::cpu::target::avx512, bc7e_compress_block_init_avx512skx, bc7e_compress_blocks_avx512skx},
+	{todds::cpu::target::avx2, bc7e_compress_block_init_avx2, bc7e_compress_blocks_avx2},
+	{todds::cpu::target::avx, bc7e_compress_block_init_avx, bc7e_compress_blocks_avx},
+	{todds::cpu::target::sse4, bc7e_compress_block_init_sse4, bc7e_compress_blocks_sse4},
+	{todds::cpu::target::sse2, bc7e_compress_block_init_sse2, bc7e_compress_blocks_sse2},
+}};
+
+// Kernel chosen by initialize_bc7_kernel.
+const bc7_kernel* selected_kernel = &bc7_kernels.back();
+
+#if defined(_MSC_VER)
+bool is_supported(todds::cpu::target target) noexcept {
+	constexpr unsigned int os_avx_state = 0x6U;
+	constexpr unsigned int os_avx512_state = 0xE6U;
+	std::array<int, 4U> registers{};
+	__cpuid(registers.data(), 1);
+	const auto ecx1 = static_cast<unsigned int>(registers[2]);
+	const bool osxsave = (ecx1 & (1U << 27U)) != 0U;
+	const auto xcr0 = osxsave ? static_cast<unsigned int>(_xgetbv(0)) : 0U;
+	const bool avx = osxsave && (ecx1 & (1U << 28U)) != 0U && (xcr0 & os_avx_state) == os_avx_state;
+	__cpuidex(registers.data(), 7, 0);
+	const auto ebx7 = static_cast<unsigned int>(registers[1]);
+	const auto has = [ebx7](unsigned int bit) { return (ebx7 & (1U << bit)) != 0U; };
+
+	switch (target) {
+	case todds::cpu::target::automatic:
+	case todds::cpu::target::sse2: return true;
+	case todds::cpu::target::sse4: return (ecx1 & (1U << 20U)) != 0U;
+	case todds::cpu::target::avx: return avx;
+	case todds::cpu::target::avx2: return avx && has(5U) && (ecx1 & (1U << 12U)) != 0U;
+	case todds::cpu::target::avx512:
+		// F, DQ, CD, BW and VL.
+		return avx && (xcr0 & os_avx512_state) == os_avx512_state && has(16U) && has(17U) && has(28U) && has(30U) &&
+					 has(31U);
+	}
+	return false;
+}
+#else
+bool is_supported(todds::cpu::target target) noexcept {
+	__builtin_cpu_init();
+	switch (target) {
+	case todds::cpu::target::automatic:
+	case todds::cpu::target::sse2: return true;
+	case todds::cpu::target::sse4: return __builtin_cpu_supports("sse4.2") != 0;
+	case todds::cpu::target::avx: return __builtin_cpu_supports("avx") != 0;
+	case todds::cpu::target::avx2: return __builtin_cpu_supports("avx2") != 0 && __builtin_cpu_supports("fma") != 0;
+	case todds::cpu::target::avx512:
+		return __builtin_cpu_supports("avx512f") != 0 && __builtin_cpu_supports("avx512dq") != 0 &&
+					 __builtin_cpu_supports("avx512cd") != 0 && __builtin_cpu_supports("avx512bw") != 0 &&
+					 __builtin_cpu_supports("avx512vl") != 0;
+	}
+	return false;
+}
+#endif // defined(_MSC_VER)
+
+} // Anonymous namespace
+
+namespace todds::dds::impl {
+
+cpu::target initialize_bc7_kernel(cpu::target target) {
+	const auto fastest_kernel = [](cpu::target requested) {
+		return std::find_if(bc7_kernels.cbegin(), bc7_kernels.cend(), [requested](const bc7_kernel& kernel) {
+			return (requested == cpu::target::automatic || kernel.target == requested) && is_supported(kernel.target);
+		});
+	};
+
+	auto kernel = fastest_kernel(target);
+	// Requested targets not supported by the CPU fall back to the fastest supported one.
+	if (kernel == bc7_kernels.cend()) { kernel = fastest_kernel(cpu::target::automatic); }
+	selected_kernel = &*kernel;
+	selected_kernel->init();
+	return selected_kernel->target;
+}
+
+void bc7_compress_blocks(std::uint32_t num_blocks, std::uint64_t* dds_blocks, const std::uint32_t* pixel_blocks,
+	const bc7_params* params) noexcept {
+	selected_kernel->compress(num_blocks, dds_blocks, pixel_blocks, params);
+}
+
+} // namespace todds::dds::impl
+
+#else
+
+namespace todds::dds::impl {
+
+cpu::target initialize_bc7_kernel(cpu::target /*target*/) {
+	ispc::bc7e_compress_block_init();
+	return cpu::target::automatic;
+}
+
+void bc7_compress_blocks(std::uint32_t num_blocks, std::uint64_t* dds_blocks, const std::uint32_t* pixel_blocks,
+	const bc7_params* params) noexcept {
+	ispc::bc7e_compress_blocks(num_blocks, dds_blocks, pixel_blocks, params);
+}
+
+} // namespace todds::dds::impl
+
+#endif // TODDS_ISPC_MULTI_TARGET
+
+#endif // TODDS_ISPC
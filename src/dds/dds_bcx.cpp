@@ -6,7 +6,12 @@
 #include "todds/dds.hpp"
 #include "todds/profiler.hpp"
 
-#include <oneapi/tbb/parallel_for.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 
 #include "dds_impl.hpp"
 #include "rgbcx_todds.hpp"
@@ -17,62 +22,625 @@ constexpr std::size_t bc1_block_size = 1UL;
 
 constexpr std::size_t bc3_block_size = 2UL;
 
-using blocked_range = oneapi::tbb::blocked_range<size_t>;
+constexpr std::size_t bc4_block_size = 1UL;
 
-constexpr std::size_t pixel_block_size = todds::pixel_block_side * todds::pixel_block_side;
+constexpr std::size_t bc5_block_size = 2UL;
+
+// Zero alpha endpoints and indices for the alpha block, black color for the color block.
+constexpr todds::dds::block_cache::encoded_block bc3_transparent_block{0ULL, 0ULL};
+
+using todds::dds::impl::pixel_block_size;
+
+void decode_bc1(const std::uint64_t* dds_block, std::uint32_t* pixel_block) {
+	rgbcx::unpack_bc1(dds_block, pixel_block);
+}
+
+void decode_bc3(const std::uint64_t* dds_block, std::uint32_t* pixel_block) {
+	rgbcx::unpack_bc3(dds_block, pixel_block);
+}
+
+void decode_bc4(const std::uint64_t* dds_block, std::uint32_t* pixel_block) {
+	std::fill_n(pixel_block, pixel_block_size, 0U);
+	rgbcx::unpack_bc4(dds_block, reinterpret_cast<std::uint8_t*>(pixel_block));
+}
+
+void decode_bc5(const std::uint64_t* dds_block, std::uint32_t* pixel_block) {
+	std::fill_n(pixel_block, pixel_block_size, 0U);
+	rgbcx::unpack_bc5(dds_block, pixel_block);
+}
+
+// The alpha channel is ignored when measuring errors, as BC1 is used for images without alpha.
+constexpr todds::dds::impl::decode_format bc1_format{bc1_block_size, 3U, decode_bc1};
+
+constexpr todds::dds::impl::decode_format bc3_format{bc3_block_size, 4U, decode_bc3};
+
+constexpr todds::dds::impl::decode_format bc4_format{bc4_block_size, 1U, decode_bc4};
+
+constexpr todds::dds::impl::decode_format bc5_format{bc5_block_size, 2U, decode_bc5};
+
+// Linux x86-64 builds compile the batched BC1 kernel for several instruction sets, and the fastest one supported by the
+// CPU is chosen at runtime. Helper functions must be inlined into each version of the kernel.
+#if defined(__linux__) && defined(__x86_64__) && defined(__GNUC__)
+#define TODDS_BC1_KERNEL_TARGETS [[gnu::target_clones("avx2", "sse4.1", "default")]]
+#define TODDS_BC1_KERNEL_INLINE [[gnu::always_inline]] inline
+#else
+#define TODDS_BC1_KERNEL_TARGETS
+#define TODDS_BC1_KERNEL_INLINE inline
+#endif // defined(__linux__) && defined(__x86_64__) && defined(__GNUC__)
+
+// Number of blocks encoded together by the batched BC1 kernel.
+constexpr std::size_t kernel_blocks = 16U;
+
+// rgbcx flags supported by the batched BC1 kernel. They select the rgbcx path which never measures block errors.
+constexpr std::uint32_t kernel_flags = rgbcx::cEncodeBC1TwoLeastSquaresPasses | rgbcx::cEncodeBC1Use6PowerIters;
+
+bool use_kernel(std::uint32_t flags) noexcept { return (flags & ~kernel_flags) == 0U; }
+
+// One value for each block of a kernel batch. Every step of the kernel is a loop over these values without branches
+// depending on the block, which compilers turn into SIMD instructions.
+template<typename Type> using lanes = std::array<Type, kernel_blocks>;
+
+template<typename Type> using pixel_lanes = std::array<lanes<Type>, pixel_block_size>;
+
+// RGB channels of the blocks of a batch.
+struct batch_pixels {
+	pixel_lanes<int> r{};
+	pixel_lanes<int> g{};
+	pixel_lanes<int> b{};
+};
+
+// Unscaled RGB565 endpoints of the blocks of a batch.
+struct batch_endpoints {
+	lanes<int> lr{};
+	lanes<int> lg{};
+	lanes<int> lb{};
+	lanes<int> hr{};
+	lanes<int> hg{};
+	lanes<int> hb{};
+};
+
+// Same results as rgbcx::to_5 and rgbcx::to_6, without narrowing conversions which prevent vectorization.
+TODDS_BC1_KERNEL_INLINE int to_5(int value) noexcept {
+	const int scaled = value * 31 + 128;
+	return (scaled + (scaled >> 8)) >> 8;
+}
+
+TODDS_BC1_KERNEL_INLINE int to_6(int value) noexcept {
+	const int scaled = value * 63 + 128;
+	return (scaled + (scaled >> 8)) >> 8;
+}
+
+TODDS_BC1_KERNEL_INLINE int expand_5(int value) noexcept { return (value << 3) | (value >> 2); }
+
+TODDS_BC1_KERNEL_INLINE int expand_6(int value) noexcept { return (value << 2) | (value >> 4); }
+
+// Quantizes a channel in [0, 1] of every block like rgbcx::precise_round_565.
+template<int max_value>
+TODDS_BC1_KERNEL_INLINE void precise_round(
+	const lanes<float>& values, const float* midpoints, lanes<int>& rounded) noexcept {
+	for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+		rounded[lane] = std::clamp(static_cast<int>(values[lane] * static_cast<float>(max_value)), 0, max_value);
+	}
+	// Midpoints between quantized values are not evenly spaced.
+	for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+		rounded[lane] = (rounded[lane] + (values[lane] > midpoints[rounded[lane]] ? 1 : 0)) & max_value;
+	}
+}
+
+// Four color mode selectors of every pixel, chosen like rgbcx::bc1_find_sels4_noerr.
+TODDS_BC1_KERNEL_INLINE void find_selectors(
+	const batch_pixels& pixels, const batch_endpoints& endpoints, pixel_lanes<int>& selectors) noexcept {
+	lanes<int> axis_r{};
+	lanes<int> axis_g{};
+	lanes<int> axis_b{};
+	std::array<lanes<int>, 3U> thresholds{};
+	for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+		const int r0 = expand_5(endpoints.lr[lane]);
+		const int g0 = expand_6(endpoints.lg[lane]);
+		const int b0 = expand_5(endpoints.lb[lane]);
+		const int r3 = expand_5(endpoints.hr[lane]);
+		const int g3 = expand_6(endpoints.hg[lane]);
+		const int b3 = expand_5(endpoints.hb[lane]);
+		const int ar = r3 - r0;
+		const int ag = g3 - g0;
+		const int ab = b3 - b0;
+		const int dot0 = r0 * ar + g0 * ag + b0 * ab;
+		const int dot1 = (r0 * 2 + r3) / 3 * ar + (g0 * 2 + g3) / 3 * ag + (b0 * 2 + b3) / 3 * ab;
+		const int dot2 = (r3 * 2 + r0) / 3 * ar + (g3 * 2 + g0) / 3 * ag + (b3 * 2 + b0) / 3 * ab;
+		const int dot3 = r3 * ar + g3 * ag + b3 * ab;
+		axis_r[lane] = ar * 2;
+		axis_g[lane] = ag * 2;
+		axis_b[lane] = ab * 2;
+		thresholds[0U][lane] = dot0 + dot1;
+		thresholds[1U][lane] = dot1 + dot2;
+		thresholds[2U][lane] = dot2 + dot3;
+	}
+
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+			const int dot = pixels.r[pixel][lane] * axis_r[lane] + pixels.g[pixel][lane] * axis_g[lane] +
+											pixels.b[pixel][lane] * axis_b[lane];
+			selectors[pixel][lane] = 3 - (dot <= thresholds[0U][lane] ? 1 : 0) - (dot < thresholds[1U][lane] ? 1 : 0) -
+															 (dot < thresholds[2U][lane] ? 1 : 0);
+		}
+	}
+}
+
+// Encodes up to kernel_blocks BC1 blocks. The results are identical to calling rgbcx::encode_bc1 on each block with
+// flags accepted by use_kernel.
+TODDS_BC1_KERNEL_TARGETS void encode_bc1_batch(std::uint64_t* dds_blocks, std::size_t dds_stride,
+	const std::uint32_t* pixel_blocks, std::size_t num_blocks, std::uint32_t flags) {
+	constexpr std::uint32_t channel_mask = 0xFFU;
+
+	// Unused lanes repeat the last block.
+	pixel_lanes<std::uint32_t> colors{};
+	for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+		const std::uint32_t* block = pixel_blocks + std::min(lane, num_blocks - 1U) * pixel_block_size;
+		for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) { colors[pixel][lane] = block[pixel]; }
+	}
+	batch_pixels pixels{};
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+			pixels.r[pixel][lane] = static_cast<int>(colors[pixel][lane] & channel_mask);
+			pixels.g[pixel][lane] = static_cast<int>((colors[pixel][lane] >> 8U) & channel_mask);
+			pixels.b[pixel][lane] = static_cast<int>((colors[pixel][lane] >> 16U) & channel_mask);
+		}
+	}
+
+	lanes<int> total_r{};
+	lanes<int> total_g{};
+	lanes<int> total_b{};
+	lanes<int> min_r{};
+	lanes<int> min_g{};
+	lanes<int> min_b{};
+	lanes<int> max_r{};
+	lanes<int> max_g{};
+	lanes<int> max_b{};
+	lanes<int> grayscale{};
+	min_r.fill(255);
+	min_g.fill(255);
+	min_b.fill(255);
+	grayscale.fill(1);
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+			const int r = pixels.r[pixel][lane];
+			const int g = pixels.g[pixel][lane];
+			const int b = pixels.b[pixel][lane];
+			total_r[lane] += r;
+			total_g[lane] += g;
+			total_b[lane] += b;
+			min_r[lane] = std::min(min_r[lane], r);
+			min_g[lane] = std::min(min_g[lane], g);
+			min_b[lane] = std::min(min_b[lane], b);
+			max_r[lane] = std::max(max_r[lane], r);
+			max_g[lane] = std::max(max_g[lane], g);
+			max_b[lane] = std::max(max_b[lane], b);
+			grayscale[lane] &= r == g && r == b ? 1 : 0;
+		}
+	}
+
+	lanes<int> avg_r{};
+	lanes<int> avg_g{};
+	lanes<int> avg_b{};
+	for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+		avg_r[lane] = (total_r[lane] + 8) >> 4;
+		avg_g[lane] = (total_g[lane] + 8) >> 4;
+		avg_b[lane] = (total_b[lane] + 8) >> 4;
+	}
+
+	// Covariance of the pixels of each block.
+	std::array<lanes<int>, 6U> icov{};
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+			const int r = pixels.r[pixel][lane] - avg_r[lane];
+			const int g = pixels.g[pixel][lane] - avg_g[lane];
+			const int b = pixels.b[pixel][lane] - avg_b[lane];
+			icov[0U][lane] += r * r;
+			icov[1U][lane] += r * g;
+			icov[2U][lane] += r * b;
+			icov[3U][lane] += g * g;
+			icov[4U][lane] += g * b;
+			icov[5U][lane] += b * b;
+		}
+	}
+
+	// Principal axis of each block, found with power iterations.
+	const std::size_t power_iterations = (flags & rgbcx::cEncodeBC1Use6PowerIters) != 0U ? 6U : 4U;
+	std::array<lanes<float>, 6U> cov{};
+	for (std::size_t index = 0U; index < cov.size(); ++index) {
+		for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+			cov[index][lane] = static_cast<float>(icov[index][lane]) * (1.0F / 255.0F);
+		}
+	}
+	lanes<float> xr{};
+	lanes<float> xg{};
+	lanes<float> xb{};
+	for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+		const auto r_range = static_cast<float>(max_r[lane] - min_r[lane]);
+		const auto g_range = static_cast<float>(max_g[lane] - min_g[lane]);
+		xr[lane] = icov[2U][lane] < 0 ? -r_range : r_range;
+		xg[lane] = icov[4U][lane] < 0 ? -g_range : g_range;
+		xb[lane] = static_cast<float>(max_b[lane] - min_b[lane]);
+	}
+	for (std::size_t iteration = 0U; iteration < power_iterations; ++iteration) {
+		for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+			const float r = xr[lane] * cov[0U][lane] + xg[lane] * cov[1U][lane] + xb[lane] * cov[2U][lane];
+			const float g = xr[lane] * cov[1U][lane] + xg[lane] * cov[3U][lane] + xb[lane] * cov[4U][lane];
+			const float b = xr[lane] * cov[2U][lane] + xg[lane] * cov[4U][lane] + xb[lane] * cov[5U][lane];
+			xr[lane] = r;
+			xg[lane] = g;
+			xb[lane] = b;
+		}
+	}
+	lanes<int> axis_r{};
+	lanes<int> axis_g{};
+	lanes<int> axis_b{};
+	for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+		const float k = std::max(std::max(std::fabs(xr[lane]), std::fabs(xg[lane])), std::fabs(xb[lane]));
+		const bool scaled = k >= 2.0F;
+		const float m = 2048.0F / (scaled ? k : 2048.0F);
+		axis_r[lane] = (scaled ? static_cast<int>(xr[lane] * m) : 306) * 16;
+		axis_g[lane] = (scaled ? static_cast<int>(xg[lane] * m) : 601) * 16;
+		axis_b[lane] = (scaled ? static_cast<int>(xb[lane] * m) : 117) * 16;
+	}
+
+	// Initial endpoints are the pixels with the lowest and highest projections onto the principal axis. The pixel index
+	// in the lowest bits of each projection breaks ties in the same way as rgbcx.
+	batch_endpoints endpoints{};
+	lanes<int> low_dot{};
+	lanes<int> high_dot{};
+	low_dot.fill(std::numeric_limits<int>::max());
+	high_dot.fill(std::numeric_limits<int>::min());
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+			const int r = pixels.r[pixel][lane];
+			const int g = pixels.g[pixel][lane];
+			const int b = pixels.b[pixel][lane];
+			const int dot = ((r * axis_r[lane] + g * axis_g[lane] + b * axis_b[lane]) & ~0xF) + static_cast<int>(pixel);
+			const bool low = dot < low_dot[lane];
+			const bool high = dot > high_dot[lane];
+			low_dot[lane] = low ? dot : low_dot[lane];
+			endpoints.lr[lane] = low ? r : endpoints.lr[lane];
+			endpoints.lg[lane] = low ? g : endpoints.lg[lane];
+			endpoints.lb[lane] = low ? b : endpoints.lb[lane];
+			high_dot[lane] = high ? dot : high_dot[lane];
+			endpoints.hr[lane] = high ? r : endpoints.hr[lane];
+			endpoints.hg[lane] = high ? g : endpoints.hg[lane];
+			endpoints.hb[lane] = high ? b : endpoints.hb[lane];
+		}
+	}
+
+	// Grayscale blocks use the range of their values instead.
+	for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+		const bool flat = max_r[lane] - min_r[lane] < 2;
+		const int low = flat ? pixels.r[0U][lane] : min_r[lane];
+		const int high = flat ? pixels.r[0U][lane] : max_r[lane];
+		const bool gray = grayscale[lane] != 0;
+		endpoints.lr[lane] = to_5(gray ? low : endpoints.lr[lane]);
+		endpoints.lg[lane] = to_6(gray ? low : endpoints.lg[lane]);
+		endpoints.lb[lane] = to_5(gray ? low : endpoints.lb[lane]);
+		endpoints.hr[lane] = to_5(gray ? high : endpoints.hr[lane]);
+		endpoints.hg[lane] = to_6(gray ? high : endpoints.hg[lane]);
+		endpoints.hb[lane] = to_5(gray ? high : endpoints.hb[lane]);
+	}
+
+	pixel_lanes<int> selectors{};
+	find_selectors(pixels, endpoints, selectors);
+
+	// Endpoints of a solid block with the average color of each block.
+	batch_endpoints solid_endpoints{};
+	for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+		solid_endpoints.lr[lane] = rgbcx::g_bc1_match5_equals_1[avg_r[lane]].m_hi;
+		solid_endpoints.lg[lane] = rgbcx::g_bc1_match6_equals_1[avg_g[lane]].m_hi;
+		solid_endpoints.lb[lane] = rgbcx::g_bc1_match5_equals_1[avg_b[lane]].m_hi;
+		solid_endpoints.hr[lane] = rgbcx::g_bc1_match5_equals_1[avg_r[lane]].m_lo;
+		solid_endpoints.hg[lane] = rgbcx::g_bc1_match6_equals_1[avg_g[lane]].m_lo;
+		solid_endpoints.hb[lane] = rgbcx::g_bc1_match5_equals_1[avg_b[lane]].m_lo;
+	}
+
+	// Least squares refinement. A block stops being refined once its endpoints no longer change.
+	const std::size_t passes = (flags & rgbcx::cEncodeBC1TwoLeastSquaresPasses) != 0U ? 2U : 1U;
+	lanes<int> active{};
+	active.fill(1);
+	for (std::size_t pass = 0U; pass < passes; ++pass) {
+		lanes<int> uq_r{};
+		lanes<int> uq_g{};
+		lanes<int> uq_b{};
+		lanes<int> z00{};
+		lanes<int> z10{};
+		lanes<int> z11{};
+		for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+			for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+				const int selector = selectors[pixel][lane];
+				uq_r[lane] += selector * pixels.r[pixel][lane];
+				uq_g[lane] += selector * pixels.g[pixel][lane];
+				uq_b[lane] += selector * pixels.b[pixel][lane];
+				z00[lane] += selector * selector;
+				z10[lane] += selector * (3 - selector);
+				z11[lane] += (3 - selector) * (3 - selector);
+			}
+		}
+
+		lanes<int> solvable{};
+		lanes<float> xl_r{};
+		lanes<float> xl_g{};
+		lanes<float> xl_b{};
+		lanes<float> xh_r{};
+		lanes<float> xh_g{};
+		lanes<float> xh_b{};
+		for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+			const auto fz00 = static_cast<float>(z00[lane]);
+			const auto fz10 = static_cast<float>(z10[lane]);
+			const auto fz11 = static_cast<float>(z11[lane]);
+			const float det = fz00 * fz11 - fz10 * fz10;
+			solvable[lane] = std::fabs(det) >= 1e-8F ? 1 : 0;
+			const float scale = (3.0F / 255.0F) / (solvable[lane] != 0 ? det : 1.0F);
+			const float iz00 = fz11 * scale;
+			const float iz01 = -fz10 * scale;
+			const float iz10 = -fz10 * scale;
+			const float iz11 = fz00 * scale;
+			const auto uq00_r = static_cast<float>(uq_r[lane]);
+			const auto uq00_g = static_cast<float>(uq_g[lane]);
+			const auto uq00_b = static_cast<float>(uq_b[lane]);
+			const auto q10_r = static_cast<float>(total_r[lane] * 3 - uq_r[lane]);
+			const auto q10_g = static_cast<float>(total_g[lane] * 3 - uq_g[lane]);
+			const auto q10_b = static_cast<float>(total_b[lane] * 3 - uq_b[lane]);
+			xl_r[lane] = iz00 * uq00_r + iz01 * q10_r;
+			xl_g[lane] = iz00 * uq00_g + iz01 * q10_g;
+			xl_b[lane] = iz00 * uq00_b + iz01 * q10_b;
+			xh_r[lane] = iz10 * uq00_r + iz11 * q10_r;
+			xh_g[lane] = iz10 * uq00_g + iz11 * q10_g;
+			xh_b[lane] = iz10 * uq00_b + iz11 * q10_b;
+		}
+
+		// Like rgbcx, the low endpoint is taken from the high least squares solution and vice versa.
+		batch_endpoints trial{};
+		precise_round<31>(xh_r, rgbcx::g_midpoint5, trial.lr);
+		precise_round<63>(xh_g, rgbcx::g_midpoint6, trial.lg);
+		precise_round<31>(xh_b, rgbcx::g_midpoint5, trial.lb);
+		precise_round<31>(xl_r, rgbcx::g_midpoint5, trial.hr);
+		precise_round<63>(xl_g, rgbcx::g_midpoint6, trial.hg);
+		precise_round<31>(xl_b, rgbcx::g_midpoint5, trial.hb);
+
+		int changed_blocks = 0;
+		for (std::size_t lane = 0U; lane < kernel_blocks; ++lane) {
+			// When every selector is equal, the block is encoded as a solid block of its average color.
+			const bool average = solvable[lane] == 0;
+			const int trial_lr = average ? solid_endpoints.lr[lane] : trial.lr[lane];
+			const int trial_lg = average ? solid_endpoints.lg[lane] : trial.lg[lane];
+			const int trial_lb = average ? solid_endpoints.lb[lane] : trial.lb[lane];
+			const int trial_hr = average ? solid_endpoints.hr[lane] : trial.hr[lane];
+			const int trial_hg = average ? solid_endpoints.hg[lane] : trial.hg[lane];
+			const int trial_hb = average ? solid_endpoints.hb[lane] : trial.hb[lane];
+
+			const bool changed = active[lane] != 0 &&
+													 (trial_lr != endpoints.lr[lane] || trial_lg != endpoints.lg[lane] ||
+														 trial_lb != endpoints.lb[lane] || trial_hr != endpoints.hr[lane] ||
+														 trial_hg != endpoints.hg[lane] || trial_hb != endpoints.hb[lane]);
+			endpoints.lr[lane] = changed ? trial_lr : endpoints.lr[lane];
+			endpoints.lg[lane] = changed ? trial_lg : endpoints.lg[lane];
+			endpoints.lb[lane] = changed ? trial_lb : endpoints.lb[lane];
+			endpoints.hr[lane] = changed ? trial_hr : endpoints.hr[lane];
+			endpoints.hg[lane] = changed ? trial_hg : endpoints.hg[lane];
+			endpoints.hb[lane] = changed ? trial_hb : endpoints.hb[lane];
+			active[lane] = changed ? 1 : 0;
+			changed_blocks += active[lane];
+		}
+		if (changed_blocks == 0) { break; }
+
+		// Blocks with the same endpoints keep the same selectors.
+		find_selectors(pixels, endpoints, selectors);
+	}
+
+	// Packs each block like rgbcx::bc1_encode4, which never produces 3-color blocks.
+	constexpr std::uint32_t invert_selectors = 0x55555555U;
+	constexpr std::array<std::uint32_t, 4U> selector_values{0U, 2U, 3U, 1U};
+	for (std::size_t lane = 0U; lane < num_blocks; ++lane) {
+		std::uint64_t* dds_block = dds_blocks + lane * dds_stride;
+		if (min_r[lane] == max_r[lane] && min_g[lane] == max_g[lane] && min_b[lane] == max_b[lane]) {
+			rgbcx::encode_bc1_solid_block(dds_block, static_cast<std::uint32_t>(min_r[lane]),
+				static_cast<std::uint32_t>(min_g[lane]), static_cast<std::uint32_t>(min_b[lane]), false);
+			continue;
+		}
+
+		auto low_color =
+			static_cast<std::uint32_t>((endpoints.lr[lane] << 11) | (endpoints.lg[lane] << 5) | endpoints.lb[lane]);
+		auto high_color =
+			static_cast<std::uint32_t>((endpoints.hr[lane] << 11) | (endpoints.hg[lane] << 5) | endpoints.hb[lane]);
+		std::uint32_t packed_selectors = 0U;
+		for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+			packed_selectors |= selector_values[static_cast<std::size_t>(selectors[pixel][lane])] << (pixel * 2U);
+		}
+		if (low_color == high_color) {
+			// Every pixel uses the low color, or the high color when both are black.
+			packed_selectors = high_color > 0U ? 0U : invert_selectors;
+			low_color = high_color > 0U ? low_color : 1U;
+			high_color = high_color > 0U ? high_color - 1U : 0U;
+		} else if (low_color < high_color) {
+			std::swap(low_color, high_color);
+			packed_selectors ^= invert_selectors;
+		}
+		*dds_block = low_color | (static_cast<std::uint64_t>(high_color) << 16U) |
+								 (static_cast<std::uint64_t>(packed_selectors) << 32U);
+	}
+}
+
+// Encodes BC1 blocks in batches of kernel_blocks. dds_stride is the distance between consecutive BC1 blocks.
+void encode_bc1_blocks(std::uint64_t* dds_blocks, std::size_t dds_stride, const std::uint32_t* pixel_blocks,
+	std::size_t num_blocks, std::uint32_t flags) {
+	// Interpolated colors are computed like rgbcx does after initialize_bcx_encoding.
+	assert(rgbcx::g_bc1_approx_mode == rgbcx::bc1_approx_mode::cBC1Ideal);
+	for (std::size_t batch = 0U; batch < num_blocks; batch += kernel_blocks) {
+		encode_bc1_batch(dds_blocks + batch * dds_stride, dds_stride, pixel_blocks + batch * pixel_block_size,
+			std::min(kernel_blocks, num_blocks - batch), flags);
+	}
+}
 
 } // namespace
 
 namespace todds::dds::impl {
 void initialize_bcx_encoding() { rgbcx::init(rgbcx::bc1_approx_mode::cBC1Ideal); }
+
+std::uint64_t encoder_id(format::type format, const factor_values& params) noexcept {
+	fnv1a_hash hash;
+	hash.add(format);
+	hash.add(params.flags);
+	hash.add(params.total_orderings4);
+	hash.add(params.total_orderings3);
+	return hash.value();
+}
+
+const decode_format& bcx_decode_format(format::type format_type) noexcept {
+	switch (format_type) {
+	case format::type::bc1: return bc1_format;
+	case format::type::bc3: return bc3_format;
+	case format::type::bc4: return bc4_format;
+	case format::type::bc5: return bc5_format;
+	case format::type::bc7:
+	case format::type::png:
+	case format::type::invalid: break;
+	}
+	assert(false);
+	return bc1_format;
+}
 } // namespace todds::dds::impl
 
 namespace todds::dds {
 
-dds_image bc1_encode(const todds::format::quality quality, const bool alpha_black, const pixel_block_image& image) {
-	constexpr std::size_t grain_size = 64ULL;
-	static oneapi::tbb::affinity_partitioner partitioner;
+dds_image bc1_encode(const todds::format::quality quality, const bool alpha_black, const pixel_block_image& image,
+	const encode_options& options) {
 	const std::size_t num_blocks = image.size() / pixel_block_size;
 
 	dds_image result(num_blocks * bc1_block_size);
 
-	const auto factors = impl::from_quality_level(static_cast<unsigned int>(quality), alpha_black);
-
-	oneapi::tbb::parallel_for(
-		blocked_range(0UL, num_blocks, grain_size),
-		[factors, &image, &result](const blocked_range& range) {
+	// Creates a callable encoding ranges of blocks with a quality level.
+	const auto encoder = [alpha_black, &options, &image, &result](const todds::format::quality encoder_quality) {
+		const std::array<impl::factor_values, impl::total_tiers> factors{
+			impl::from_quality_level(static_cast<unsigned int>(encoder_quality), alpha_black),
+			impl::from_quality_level(static_cast<unsigned int>(options.low_complexity_quality), alpha_black),
+		};
+		const impl::format_encoders encoders{
+			{impl::encoder_id(format::type::bc1, factors[impl::regular_tier]),
+				impl::encoder_id(format::type::bc1, factors[impl::low_complexity_tier])},
+			nullptr};
+		return [factors, encoders, &options, &image, &result](std::size_t begin, std::size_t end) {
 			TracyZoneScopedN("bc1");
-			for (std::size_t block_index = range.begin(); block_index < range.end(); ++block_index) {
-				auto* dds_block = &result[block_index * bc1_block_size];
-				const auto* pixel_block = reinterpret_cast<const std::uint8_t*>(&image[block_index * pixel_block_size]);
-				rgbcx::encode_bc1(dds_block, pixel_block, factors.flags, factors.total_orderings4, factors.total_orderings3);
-			}
-		},
-		partitioner);
+			impl::encode_range<bc1_block_size>(options, encoders, begin, end, image, result,
+				[&factors](impl::block_tier tier, std::uint64_t* dds_blocks, const std::uint32_t* pixel_blocks,
+					std::size_t blocks_to_process) {
+					const impl::factor_values& tier_factors = factors[tier];
+					if (use_kernel(tier_factors.flags)) {
+						encode_bc1_blocks(dds_blocks, bc1_block_size, pixel_blocks, blocks_to_process, tier_factors.flags);
+						return;
+					}
+					for (std::size_t index = 0U; index < blocks_to_process; ++index) {
+						const auto* pixel_block = reinterpret_cast<const std::uint8_t*>(pixel_blocks + index * pixel_block_size);
+						rgbcx::encode_bc1(dds_blocks + index * bc1_block_size, pixel_block, tier_factors.flags,
+							tier_factors.total_orderings4, tier_factors.total_orderings3);
+					}
+				});
+		};
+	};
+
+	impl::encode_image(options, bc1_format, image, result, encoder(quality), encoder(options.fast_pass_quality));
+
+	if (options.rdo_lambda > 0.0F) { impl::optimize_rate(options, bc1_format, image, result); }
 
 	return result;
 }
 
-dds_image bc3_encode(const todds::format::quality quality, const pixel_block_image& image) {
-	constexpr std::size_t grain_size = 64ULL;
-	static oneapi::tbb::affinity_partitioner partitioner;
+dds_image bc3_encode(
+	const todds::format::quality quality, const pixel_block_image& image, const encode_options& options) {
 	const std::size_t num_blocks = image.size() / pixel_block_size;
 
 	dds_image result(num_blocks * bc3_block_size);
 
-	const auto factors = impl::from_quality_level(static_cast<unsigned int>(quality), false);
-
-	oneapi::tbb::parallel_for(
-		blocked_range(0UL, num_blocks, grain_size),
-		[factors, &image, &result](const blocked_range& range) {
+	// Creates a callable encoding ranges of blocks with a quality level.
+	const auto encoder = [&options, &image, &result](const todds::format::quality encoder_quality) {
+		const std::array<impl::factor_values, impl::total_tiers> factors{
+			impl::from_quality_level(static_cast<unsigned int>(encoder_quality), false),
+			impl::from_quality_level(static_cast<unsigned int>(options.low_complexity_quality), false),
+		};
+		const impl::format_encoders encoders{
+			{impl::encoder_id(format::type::bc3, factors[impl::regular_tier]),
+				impl::encoder_id(format::type::bc3, factors[impl::low_complexity_tier])},
+			&bc3_transparent_block};
+		return [factors, encoders, &options, &image, &result](std::size_t begin, std::size_t end) {
 			TracyZoneScopedN("bc3");
-			for (std::size_t block_index = range.begin(); block_index < range.end(); ++block_index) {
-				auto* dds_block = &result[block_index * bc3_block_size];
-				const auto* pixel_block = reinterpret_cast<const std::uint8_t*>(&image[block_index * pixel_block_size]);
-				rgbcx::encode_bc3(dds_block, pixel_block, factors.flags);
-			}
-		},
-		partitioner);
+			impl::encode_range<bc3_block_size>(options, encoders, begin, end, image, result,
+				[&factors](impl::block_tier tier, std::uint64_t* dds_blocks, const std::uint32_t* pixel_blocks,
+					std::size_t blocks_to_process) {
+					const std::uint32_t flags = factors[tier].flags;
+					if (use_kernel(flags)) {
+						// The alpha block is encoded like rgbcx::encode_bc3, and the color blocks by the batched kernel.
+						constexpr std::size_t alpha_offset = 3U;
+						constexpr std::uint32_t stride = 4U;
+						for (std::size_t index = 0U; index < blocks_to_process; ++index) {
+							const auto* pixel_block = reinterpret_cast<const std::uint8_t*>(pixel_blocks + index * pixel_block_size);
+							rgbcx::encode_bc4(dds_blocks + index * bc3_block_size, pixel_block + alpha_offset, stride);
+						}
+						encode_bc1_blocks(dds_blocks + 1U, bc3_block_size, pixel_blocks, blocks_to_process, flags);
+						return;
+					}
+					for (std::size_t index = 0U; index < blocks_to_process; ++index) {
+						const auto* pixel_block = reinterpret_cast<const std::uint8_t*>(pixel_blocks + index * pixel_block_size);
+						rgbcx::encode_bc3(dds_blocks + index * bc3_block_size, pixel_block, flags);
+					}
+				});
+		};
+	};
+
+	impl::encode_image(options, bc3_format, image, result, encoder(quality), encoder(options.fast_pass_quality));
+
+	return result;
+}
+
+dds_image bc4_encode(const pixel_block_image& image, const encode_options& options) {
+	const std::size_t num_blocks = image.size() / pixel_block_size;
+
+	dds_image result(num_blocks * bc4_block_size);
+
+	// The BC4 encoder has no quality settings.
+	const std::uint64_t encoder = impl::encoder_id(format::type::bc4);
+	const impl::format_encoders encoders{{encoder, encoder}, nullptr};
+
+	impl::schedule_blocks(
+		options, num_blocks, [&encoders, &options, &image, &result](std::size_t begin, std::size_t end) {
+			TracyZoneScopedN("bc4");
+			impl::encode_range<bc4_block_size>(options, encoders, begin, end, image, result,
+				[](impl::block_tier /*tier*/, std::uint64_t* dds_blocks, const std::uint32_t* pixel_blocks,
+					std::size_t blocks_to_process) {
+					for (std::size_t index = 0U; index < blocks_to_process; ++index) {
+						const auto* pixel_block = reinterpret_cast<const std::uint8_t*>(pixel_blocks + index * pixel_block_size);
+						rgbcx::encode_bc4(dds_blocks + index * bc4_block_size, pixel_block);
+					}
+				});
+		});
+
+	return result;
+}
+
+dds_image bc5_encode(const pixel_block_image& image, const encode_options& options) {
+	const std::size_t num_blocks = image.size() / pixel_block_size;
+
+	dds_image result(num_blocks * bc5_block_size);
+
+	// The BC5 encoder has no quality settings.
+	const std::uint64_t encoder = impl::encoder_id(format::type::bc5);
+	const impl::format_encoders encoders{{encoder, encoder}, nullptr};
+
+	impl::schedule_blocks(
+		options, num_blocks, [&encoders, &options, &image, &result](std::size_t begin, std::size_t end) {
+			TracyZoneScopedN("bc5");
+			impl::encode_range<bc5_block_size>(options, encoders, begin, end, image, result,
+				[](impl::block_tier /*tier*/, std::uint64_t* dds_blocks, const std::uint32_t* pixel_blocks,
+					std::size_t blocks_to_process) {
+					for (std::size_t index = 0U; index < blocks_to_process; ++index) {
+						const auto* pixel_block = reinterpret_cast<const std::uint8_t*>(pixel_blocks + index * pixel_block_size);
+						rgbcx::encode_bc5(dds_blocks + index * bc5_block_size, pixel_block);
+					}
+				});
+		});
 
 	return result;
 }
@@ -0,0 +1,32 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "dds_impl.hpp"
+
+namespace todds::dds::impl {
+
+std::uint64_t squared_error(const decode_format& format, const std::uint32_t* pixel_blocks,
+	const std::uint64_t* dds_blocks, std::size_t num_blocks) {
+	std::array<std::uint32_t, pixel_block_size> decoded{};
+	std::uint64_t error = 0U;
+	for (std::size_t index = 0U; index < num_blocks; ++index) {
+		format.decode(dds_blocks + index * format.block_size, decoded.data());
+		error += block_squared_error(pixel_blocks + index * pixel_block_size, decoded.data(), format.channels);
+	}
+	return error;
+}
+
+double psnr(std::uint64_t error, std::size_t samples) noexcept {
+	if (error == 0U || samples == 0U) { return std::numeric_limits<double>::infinity(); }
+	constexpr double max_value = 255.0;
+	const double mean_squared_error = static_cast<double>(error) / static_cast<double>(samples);
+	return 10.0 * std::log10(max_value * max_value / mean_squared_error);
+}
+
+} // namespace todds::dds::impl
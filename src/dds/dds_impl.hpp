@@ -5,9 +5,494 @@
 
 #pragma once
 
+#include "todds/dds.hpp"
+#include "todds/encode_scheduler.hpp"
+#include "todds/vector.hpp"
+
+#include <oneapi/tbb/parallel_for.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
 namespace todds::dds::impl {
 
 void initialize_bcx_encoding();
-void initialize_bc7_encoding();
+cpu::target initialize_bc7_encoding(cpu::target target);
+
+#ifdef TODDS_ISPC
+/**
+ * Chooses the ISPC target used by bc7_compress_blocks and initializes it.
+ * @param target Requested instruction set. Unsupported instruction sets fall back to the fastest supported one.
+ * @return Selected instruction set, or cpu::target::automatic if bc7e_ispc has been compiled for a single target.
+ */
+cpu::target initialize_bc7_kernel(cpu::target target);
+
+/**
+ * Encodes BC7 blocks using the ISPC target chosen by initialize_bc7_kernel.
+ * @param num_blocks Number of blocks to encode.
+ * @param dds_blocks Destination of the BC7 blocks.
+ * @param pixel_blocks Source pixel blocks.
+ * @param params BC7 encoding parameters.
+ */
+void bc7_compress_blocks(std::uint32_t num_blocks, std::uint64_t* dds_blocks, const std::uint32_t* pixel_blocks,
+	const bc7_params* params) noexcept;
+#endif // TODDS_ISPC
+
+/**
+ * Decodes a BC7 block.
+ * @param dds_block BC7 block.
+ * @param pixel_block 16 RGBA pixels of the decoded block.
+ */
+void bc7_decode_block(const std::uint64_t* dds_block, std::uint32_t* pixel_block) noexcept;
+
+constexpr std::size_t pixel_block_size = pixel_block_side * pixel_block_side;
+
+/**
+ * FNV-1a hash of a sequence of values. Values are hashed one by one, so the padding between the fields of a structure
+ * never affects the result.
+ */
+class fnv1a_hash final {
+public:
+	/**
+	 * Adds a scalar value to the hash.
+	 * @param value Integer, enumeration, boolean or floating-point value.
+	 */
+	template<typename Value> void add(Value value) noexcept {
+		static_assert(std::is_scalar_v<Value>);
+		std::array<unsigned char, sizeof(Value)> bytes{};
+		std::memcpy(bytes.data(), &value, sizeof(Value));
+		for (const unsigned char byte : bytes) { _hash = (_hash ^ byte) * fnv_prime; }
+	}
+
+	/**
+	 * Adds every element of an array to the hash.
+	 * @param values Array of scalar values.
+	 */
+	template<typename Value, std::size_t size> void add(const Value (&values)[size]) noexcept {
+		for (const Value value : values) { add(value); }
+	}
+
+	[[nodiscard]] std::uint64_t value() const noexcept { return _hash; }
+
+private:
+	static constexpr std::uint64_t fnv_prime = 0x100000001B3ULL;
+	std::uint64_t _hash{0xCBF29CE484222325ULL};
+};
+
+struct factor_values;
+
+/**
+ * Identifies an encoder without parameters, to avoid reusing cached blocks encoded by other encoders.
+ * @param format Format produced by the encoder.
+ * @return Hash of the format.
+ */
+[[nodiscard]] inline std::uint64_t encoder_id(format::type format) noexcept {
+	fnv1a_hash hash;
+	hash.add(format);
+	return hash.value();
+}
+
+/**
+ * Identifies an encoder and its parameters, to avoid reusing cached blocks encoded with different settings.
+ * @param format Format produced by the encoder.
+ * @param params Parameters of the rgbcx encoder.
+ * @return Hash of the format and each parameter.
+ */
+[[nodiscard]] std::uint64_t encoder_id(format::type format, const factor_values& params) noexcept;
+
+/**
+ * Identifies an encoder and its parameters, to avoid reusing cached blocks encoded with different settings.
+ * @param format Format produced by the encoder.
+ * @param params Parameters of the BC7 encoder.
+ * @return Hash of the format and each parameter.
+ */
+[[nodiscard]] std::uint64_t encoder_id(format::type format, const bc7_params& params) noexcept;
+
+/** Encoders used for blocks of regular complexity and for low complexity blocks in adaptive quality mode. */
+enum block_tier : std::uint8_t {
+	regular_tier,
+	low_complexity_tier,
+	total_tiers,
+};
+
+/** Encoder data required to encode ranges of blocks of a specific format. */
+struct format_encoders {
+	/** Identifiers of the encoder and parameters of each tier, calculated with encoder_id. */
+	std::array<std::uint64_t, total_tiers> ids;
+	/** Canonical block used for fully transparent blocks. Formats without alpha support must use nullptr. */
+	const block_cache::encoded_block* transparent_block;
+};
+
+/** Scratch buffers used to gather the blocks of a tier which must be encoded. */
+struct gather_buffers {
+	buffer<std::uint32_t> pixels{};
+	buffer<std::uint64_t> blocks{};
+	vector<std::size_t> indices{};
+};
+
+/** Scratch buffers of every tier. Reused by each thread. */
+inline std::array<gather_buffers, total_tiers>& thread_gather_buffers() {
+	thread_local std::array<gather_buffers, total_tiers> buffers;
+	return buffers;
+}
+
+/**
+ * Checks if every pixel of a block is fully transparent.
+ * @param pixel_block 16 RGBA pixels of the block.
+ * @return True if the alpha of every pixel is zero.
+ */
+[[nodiscard]] inline bool is_transparent_block(const std::uint32_t* pixel_block) noexcept {
+	constexpr std::uint32_t alpha_mask = 0xFF000000U;
+	std::uint32_t alpha = 0U;
+	for (std::size_t index = 0U; index < pixel_block_size; ++index) { alpha |= pixel_block[index] & alpha_mask; }
+	return alpha == 0U;
+}
+
+/**
+ * Measures the complexity of a block.
+ * @param pixel_block 16 RGBA pixels of the block.
+ * @return Average variance of the four channels of the block.
+ */
+[[nodiscard]] inline float block_complexity(const std::uint32_t* pixel_block) noexcept {
+	constexpr std::size_t channels = 4U;
+	constexpr std::uint32_t channel_bits = 8U;
+	constexpr std::uint32_t channel_mask = 0xFFU;
+	std::array<std::uint32_t, channels> sum{};
+	std::array<std::uint32_t, channels> sum_squares{};
+	for (std::size_t index = 0U; index < pixel_block_size; ++index) {
+		const std::uint32_t pixel = pixel_block[index];
+		for (std::size_t channel = 0U; channel < channels; ++channel) {
+			const std::uint32_t value = (pixel >> (channel * channel_bits)) & channel_mask;
+			sum[channel] += value;
+			sum_squares[channel] += value * value;
+		}
+	}
+
+	// Variance multiplied by pixel_block_size squared, to keep integer precision.
+	std::uint32_t scaled_variance = 0U;
+	for (std::size_t channel = 0U; channel < channels; ++channel) {
+		scaled_variance +=
+			static_cast<std::uint32_t>(pixel_block_size) * sum_squares[channel] - sum[channel] * sum[channel];
+	}
+	constexpr auto scale = static_cast<float>(pixel_block_size * pixel_block_size * channels);
+	return static_cast<float>(scaled_variance) / scale;
+}
+
+/**
+ * Encodes a range of blocks of a pixel block image.
+ * When no optional encoding features are enabled, the whole range is sent to the encoder at once. Otherwise, blocks
+ * which can be resolved without encoding are written directly and the rest are gathered contiguously by tier, encoded
+ * together and stored in the cache.
+ * @param block_size Number of std::uint64_t values used by each encoded block.
+ * @param options Encoding options.
+ * @param encoders Encoder data of the format.
+ * @param begin First block of the range.
+ * @param end One past the last block of the range.
+ * @param image Source pixel block image.
+ * @param result Encoded image.
+ * @param encode_blocks Callable with the signature void(block_tier tier, std::uint64_t* dds_blocks,
+ * const std::uint32_t* pixel_blocks, std::size_t num_blocks), encoding contiguous blocks with the encoder of a tier.
+ */
+template<std::size_t block_size, typename Encoder>
+void encode_range(const encode_options& options, const format_encoders& encoders, std::size_t begin, std::size_t end,
+	const pixel_block_image& image, dds_image& result, Encoder&& encode_blocks) {
+	block_cache* cache = options.cache;
+	const block_cache::encoded_block* transparent_block =
+		options.transparent_blocks ? encoders.transparent_block : nullptr;
+	const bool adaptive = options.complexity_threshold > 0.0F;
+	if (cache == nullptr && transparent_block == nullptr && !adaptive) {
+		encode_blocks(regular_tier, &result[begin * block_size], &image[begin * pixel_block_size], end - begin);
+		return;
+	}
+
+	auto& tiers = thread_gather_buffers();
+	for (auto& buffers : tiers) {
+		buffers.indices.clear();
+		buffers.pixels.clear();
+	}
+
+	std::size_t hits = 0U;
+	block_cache::encoded_block cached{};
+	for (std::size_t block_index = begin; block_index < end; ++block_index) {
+		const std::uint32_t* pixel_block = &image[block_index * pixel_block_size];
+		if (transparent_block != nullptr && is_transparent_block(pixel_block)) {
+			std::copy_n(transparent_block->begin(), block_size, &result[block_index * block_size]);
+			continue;
+		}
+
+		const block_tier tier =
+			adaptive && block_complexity(pixel_block) < options.complexity_threshold ? low_complexity_tier : regular_tier;
+		if (cache != nullptr && cache->find(encoders.ids[tier], pixel_block, cached)) {
+			std::copy_n(cached.begin(), block_size, &result[block_index * block_size]);
+			++hits;
+		} else {
+			tiers[tier].indices.push_back(block_index);
+			tiers[tier].pixels.insert(tiers[tier].pixels.end(), pixel_block, pixel_block + pixel_block_size);
+		}
+	}
+
+	const std::size_t misses = tiers[regular_tier].indices.size() + tiers[low_complexity_tier].indices.size();
+	if (cache != nullptr) { cache->record(hits, misses); }
+	if (adaptive && options.adaptive_stats != nullptr) {
+		options.adaptive_stats->regular_blocks += tiers[regular_tier].indices.size();
+		options.adaptive_stats->low_complexity_blocks += tiers[low_complexity_tier].indices.size();
+	}
+
+	for (std::size_t tier = 0U; tier < total_tiers; ++tier) {
+		auto& buffers = tiers[tier];
+		const std::size_t tier_blocks = buffers.indices.size();
+		if (tier_blocks == 0U) { continue; }
+
+		buffers.blocks.resize(tier_blocks * block_size);
+		encode_blocks(static_cast<block_tier>(tier), buffers.blocks.data(), buffers.pixels.data(), tier_blocks);
+
+		for (std::size_t index = 0U; index < tier_blocks; ++index) {
+			const std::uint64_t* dds_block = &buffers.blocks[index * block_size];
+			std::copy_n(dds_block, block_size, &result[buffers.indices[index] * block_size]);
+			if (cache != nullptr) {
+				std::copy_n(dds_block, block_size, cached.begin());
+				cache->insert(encoders.ids[tier], &buffers.pixels[index * pixel_block_size], cached);
+			}
+		}
+	}
+}
+
+/** Format data required to measure the error of encoded blocks. */
+struct decode_format {
+	/** Number of std::uint64_t values used by each encoded block. */
+	std::size_t block_size;
+	/** Number of channels starting from red which are taken into account when measuring the error of a block. */
+	std::size_t channels;
+	/** Decodes a block into 16 RGBA pixels. */
+	void (*decode)(const std::uint64_t* dds_block, std::uint32_t* pixel_block);
+};
+
+/**
+ * Format data of the BC1, BC3, BC4 and BC5 encoders.
+ * @param format_type One of the formats implemented with rgbcx.
+ * @return Format data used to decode blocks of this format.
+ */
+[[nodiscard]] const decode_format& bcx_decode_format(format::type format_type) noexcept;
+
+/**
+ * Format data of the BC7 encoder.
+ * @return Format data used to decode BC7 blocks.
+ */
+[[nodiscard]] const decode_format& bc7_decode_format() noexcept;
+
+/**
+ * Applies rate-distortion optimization to an encoded image.
+ * Each block is replaced by the copy of a previous block, or by a block which copies the second half of a previous
+ * block, when this reduces the sum of its error and its estimated size after LZ compression weighted by rdo_lambda.
+ * @param options Encoding options.
+ * @param format Format data of the encoded image.
+ * @param image Source pixel block image.
+ * @param result Encoded image.
+ */
+void optimize_rate(
+	const encode_options& options, const decode_format& format, const pixel_block_image& image, dds_image& result);
+
+/**
+ * Measures the error of a decoded block.
+ * @param original 16 RGBA source pixels.
+ * @param decoded 16 RGBA decoded pixels.
+ * @param channels Number of channels starting from red which are taken into account.
+ * @return Sum of the squared errors of every channel.
+ */
+[[nodiscard]] inline std::uint32_t block_squared_error(
+	const std::uint32_t* original, const std::uint32_t* decoded, std::size_t channels) noexcept {
+	constexpr std::uint32_t channel_bits = 8U;
+	constexpr std::uint32_t channel_mask = 0xFFU;
+	std::uint32_t error = 0U;
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		for (std::size_t channel = 0U; channel < channels; ++channel) {
+			const auto shift = static_cast<std::uint32_t>(channel) * channel_bits;
+			const auto difference = static_cast<std::int32_t>((original[pixel] >> shift) & channel_mask) -
+															static_cast<std::int32_t>((decoded[pixel] >> shift) & channel_mask);
+			error += static_cast<std::uint32_t>(difference * difference);
+		}
+	}
+	return error;
+}
+
+/**
+ * Measures the error of encoded blocks.
+ * @param format Format data of the encoded blocks.
+ * @param pixel_blocks Source pixels of the blocks.
+ * @param dds_blocks Encoded blocks.
+ * @param num_blocks Number of blocks to measure.
+ * @return Sum of the squared errors of every channel taken into account by the format.
+ */
+[[nodiscard]] std::uint64_t squared_error(const decode_format& format, const std::uint32_t* pixel_blocks,
+	const std::uint64_t* dds_blocks, std::size_t num_blocks);
+
+/**
+ * Calculates the PSNR of a sum of squared errors.
+ * @param error Sum of squared errors.
+ * @param samples Number of channel values included in the sum.
+ * @return PSNR in decibels. Returns infinity for zero errors.
+ */
+[[nodiscard]] double psnr(std::uint64_t error, std::size_t samples) noexcept;
+
+/** Registers an image in the scheduler for as long as it is being encoded. */
+class scheduled_image final {
+public:
+	explicit scheduled_image(encode_scheduler* scheduler) noexcept
+		: _scheduler{scheduler} {
+		if (_scheduler != nullptr) { _scheduler->begin_image(); }
+	}
+	scheduled_image(const scheduled_image&) = delete;
+	scheduled_image(scheduled_image&&) noexcept = delete;
+	scheduled_image& operator=(const scheduled_image&) = delete;
+	scheduled_image& operator=(scheduled_image&&) noexcept = delete;
+	~scheduled_image() {
+		if (_scheduler != nullptr) { _scheduler->end_image(); }
+	}
+
+	[[nodiscard]] encode_plan plan(std::size_t num_blocks) const noexcept {
+		return _scheduler != nullptr ? _scheduler->plan(num_blocks) : encode_plan{true, encode_scheduler::min_grain_size};
+	}
+
+private:
+	encode_scheduler* _scheduler;
+};
+
+/**
+ * Number of blocks encoded between checks of the force_finish flag of the encoding options. Each chunk is passed whole
+ * to the encoders, so it must be large enough to keep their batches full. It is a multiple of the widest ISPC gang and
+ * of the batches of the BC1 kernel. Even with the slowest encoders, a chunk takes a few tens of milliseconds.
+ */
+constexpr std::size_t cancellation_blocks = 256U;
+
+/**
+ * Encodes a range of blocks, in chunks of cancellation_blocks when encoding can be cancelled. Stops before the next
+ * chunk once force_finish has been set. Ranges smaller than a chunk are encoded with a single call.
+ * @param options Encoding options.
+ * @param begin First block of the range.
+ * @param end Block after the last block of the range.
+ * @param encode_blocks Callable with the signature void(std::size_t begin, std::size_t end), encoding a range of
+ * blocks.
+ */
+template<typename Encoder>
+void encode_cancellable(const encode_options& options, std::size_t begin, std::size_t end, Encoder& encode_blocks) {
+	if (options.force_finish == nullptr) {
+		encode_blocks(begin, end);
+		return;
+	}
+
+	for (std::size_t chunk = begin; chunk < end && !options.force_finish->load(std::memory_order_relaxed);
+			 chunk += cancellation_blocks) {
+		encode_blocks(chunk, std::min(chunk + cancellation_blocks, end));
+	}
+}
+
+/**
+ * Encodes every block of an image with the parallelization strategy chosen by the scheduler of the encoding options.
+ * Images are always encoded using nested parallelism when there is no scheduler.
+ * Callables processing the blocks starting inside of their range return the same results when the range is split.
+ * @param options Encoding options.
+ * @param num_blocks Number of blocks of the image.
+ * @param encode_blocks Callable with the signature void(std::size_t begin, std::size_t end), encoding a range of
+ * blocks.
+ */
+template<typename Encoder>
+void schedule_blocks(const encode_options& options, std::size_t num_blocks, Encoder&& encode_blocks) {
+	using blocked_range = oneapi::tbb::blocked_range<std::size_t>;
+	const scheduled_image image{options.scheduler};
+	const encode_plan plan = image.plan(num_blocks);
+	if (!plan.parallel) {
+		if (num_blocks > 0U) { encode_cancellable(options, std::size_t{0U}, num_blocks, encode_blocks); }
+		return;
+	}
+
+	// Each thread keeps its own partitioner instead of sharing one between every image being encoded concurrently.
+	// A thread waiting for a nested loop may steal the encoding of another image. In this case its partitioner is still
+	// in use, and an auto_partitioner is used instead.
+	thread_local oneapi::tbb::affinity_partitioner partitioner;
+	thread_local bool partitioner_in_use = false;
+	const auto body = [&options, &encode_blocks](const blocked_range& range) {
+		encode_cancellable(options, range.begin(), range.end(), encode_blocks);
+	};
+	const blocked_range range{0U, num_blocks, plan.grain_size};
+	if (partitioner_in_use) {
+		oneapi::tbb::parallel_for(range, body, oneapi::tbb::auto_partitioner{});
+		return;
+	}
+
+	partitioner_in_use = true;
+	try {
+		oneapi::tbb::parallel_for(range, body, partitioner);
+	} catch (...) {
+		partitioner_in_use = false;
+		throw;
+	}
+	partitioner_in_use = false;
+}
+
+/**
+ * Re-encodes the regions of an image encoded with the fast pass quality whose PSNR is lower than the refine threshold.
+ * Regions contain a fixed number of consecutive blocks. Each range of the scheduler processes the regions starting
+ * inside of it, keeping the results independent of the ranges chosen by the scheduler.
+ * @param options Encoding options.
+ * @param format Format data of the encoded image.
+ * @param image Source pixel block image.
+ * @param result Image encoded with the fast pass quality.
+ * @param encode_blocks Callable with the signature void(std::size_t begin, std::size_t end), encoding a range of
+ * blocks with the final quality.
+ */
+template<typename Encoder>
+void refine_regions(const encode_options& options, const decode_format& format, const pixel_block_image& image,
+	dds_image& result, Encoder&& encode_blocks) {
+	constexpr std::size_t region_blocks = 16U;
+	const std::size_t num_blocks = image.size() / pixel_block_size;
+	refine_statistics* stats = options.refine_stats;
+	schedule_blocks(options, num_blocks, [&](std::size_t begin, std::size_t end) {
+		std::size_t refined = 0U;
+		std::size_t regions = 0U;
+		for (std::size_t region = (begin + region_blocks - 1U) / region_blocks * region_blocks; region < end;
+				 region += region_blocks) {
+			const std::size_t region_end = std::min(region + region_blocks, num_blocks);
+			const std::size_t region_size = region_end - region;
+			const std::uint64_t error = squared_error(
+				format, &image[region * pixel_block_size], &result[region * format.block_size], region_size);
+			if (psnr(error, region_size * pixel_block_size * format.channels) < options.refine_psnr) {
+				encode_blocks(region, region_end);
+				++refined;
+			}
+			++regions;
+		}
+		if (stats != nullptr) {
+			stats->regions += regions;
+			stats->refined_regions += refined;
+		}
+	});
+}
+
+/**
+ * Encodes every block of an image. When the two-tier mode is enabled, the image is encoded with the fast pass quality
+ * first, and regions with a high error are encoded again.
+ * @param options Encoding options.
+ * @param format Format data of the encoded image.
+ * @param image Source pixel block image.
+ * @param result Encoded image.
+ * @param encode_blocks Callable with the signature void(std::size_t begin, std::size_t end), encoding a range of
+ * blocks with the quality of the image.
+ * @param fast_encode_blocks Callable with the same signature, encoding a range of blocks with the fast pass quality.
+ */
+template<typename Encoder, typename FastEncoder>
+void encode_image(const encode_options& options, const decode_format& format, const pixel_block_image& image,
+	dds_image& result, Encoder&& encode_blocks, FastEncoder&& fast_encode_blocks) {
+	const std::size_t num_blocks = image.size() / pixel_block_size;
+	if (options.refine_psnr > 0.0) {
+		schedule_blocks(options, num_blocks, fast_encode_blocks);
+		refine_regions(options, format, image, result, encode_blocks);
+	} else {
+		schedule_blocks(options, num_blocks, encode_blocks);
+	}
+}
 
 } // namespace todds::dds::impl
@@ -0,0 +1,123 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/dds.hpp"
+#include "todds/profiler.hpp"
+#include "todds/util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "dds_impl.hpp"
+
+namespace {
+
+using todds::dds::impl::pixel_block_size;
+
+using channel_values = std::array<std::int32_t, pixel_block_size>;
+
+constexpr double ssim_c1 = (0.01 * 255.0) * (0.01 * 255.0);
+constexpr double ssim_c2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+// Extracts one channel of 16 RGBA pixels.
+void channel(const std::uint32_t* pixels, std::size_t index, channel_values& values) noexcept {
+	constexpr std::uint32_t channel_bits = 8U;
+	constexpr std::uint32_t channel_mask = 0xFFU;
+	const auto shift = static_cast<std::uint32_t>(index) * channel_bits;
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		values[pixel] = static_cast<std::int32_t>((pixels[pixel] >> shift) & channel_mask);
+	}
+}
+
+// Structural similarity of one channel of a block, using the whole block as the window.
+// Sums are accumulated over fixed-size arrays without branches so that compilers can vectorize them.
+double block_ssim(const channel_values& original, const channel_values& decoded) noexcept {
+	std::int32_t sum_x = 0;
+	std::int32_t sum_y = 0;
+	std::int32_t sum_xx = 0;
+	std::int32_t sum_yy = 0;
+	std::int32_t sum_xy = 0;
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		sum_x += original[pixel];
+		sum_y += decoded[pixel];
+		sum_xx += original[pixel] * original[pixel];
+		sum_yy += decoded[pixel] * decoded[pixel];
+		sum_xy += original[pixel] * decoded[pixel];
+	}
+
+	constexpr double samples = static_cast<double>(pixel_block_size);
+	const double mean_x = sum_x / samples;
+	const double mean_y = sum_y / samples;
+	const double variance_x = sum_xx / samples - mean_x * mean_x;
+	const double variance_y = sum_yy / samples - mean_y * mean_y;
+	const double covariance = sum_xy / samples - mean_x * mean_y;
+	return ((2.0 * mean_x * mean_y + ssim_c1) * (2.0 * covariance + ssim_c2)) /
+				 ((mean_x * mean_x + mean_y * mean_y + ssim_c1) * (variance_x + variance_y + ssim_c2));
+}
+
+struct level_sums {
+	std::uint64_t error{};
+	double ssim{};
+};
+
+level_sums measure_blocks(const todds::dds::impl::decode_format& format, const std::uint32_t* pixel_blocks,
+	const std::uint64_t* dds_blocks, std::size_t num_blocks) noexcept {
+	std::array<std::uint32_t, pixel_block_size> decoded{};
+	channel_values original_values{};
+	channel_values decoded_values{};
+	level_sums sums{};
+	for (std::size_t index = 0U; index < num_blocks; ++index) {
+		const std::uint32_t* original = pixel_blocks + index * pixel_block_size;
+		format.decode(dds_blocks + index * format.block_size, decoded.data());
+		sums.error += todds::dds::impl::block_squared_error(original, decoded.data(), format.channels);
+		for (std::size_t index_channel = 0U; index_channel < format.channels; ++index_channel) {
+			channel(original, index_channel, original_values);
+			channel(decoded.data(), index_channel, decoded_values);
+			sums.ssim += block_ssim(original_values, decoded_values);
+		}
+	}
+	return sums;
+}
+
+todds::dds::quality_metrics metrics(const level_sums& sums, std::size_t num_blocks, std::size_t channels) noexcept {
+	const std::size_t windows = num_blocks * channels;
+	return {todds::dds::impl::psnr(sums.error, windows * pixel_block_size),
+		windows > 0U ? sums.ssim / static_cast<double>(windows) : 1.0};
+}
+
+} // Anonymous namespace
+
+namespace todds::dds {
+
+image_quality measure_quality(format::type format_type, std::size_t width, std::size_t height, std::size_t mipmaps,
+	const pixel_block_image& image, const dds_image& encoded) {
+	TracyZoneScopedN("metrics");
+	using util::next_divisible_by_4;
+	const impl::decode_format& format =
+		format_type == format::type::bc7 ? impl::bc7_decode_format() : impl::bcx_decode_format(format_type);
+
+	image_quality quality{};
+	level_sums total{};
+	std::size_t offset = 0U;
+	for (std::size_t level = 0U; level < std::max<std::size_t>(mipmaps, 1U); ++level) {
+		const std::size_t num_blocks =
+			next_divisible_by_4(width) / pixel_block_side * (next_divisible_by_4(height) / pixel_block_side);
+		assert((offset + num_blocks) * pixel_block_size <= image.size());
+		const level_sums sums =
+			measure_blocks(format, &image[offset * pixel_block_size], &encoded[offset * format.block_size], num_blocks);
+		quality.levels.push_back(metrics(sums, num_blocks, format.channels));
+		total.error += sums.error;
+		total.ssim += sums.ssim;
+		offset += num_blocks;
+		width = std::max<std::size_t>(width >> 1U, 1U);
+		height = std::max<std::size_t>(height >> 1U, 1U);
+	}
+	quality.image = metrics(total, offset, format.channels);
+
+	return quality;
+}
+
+} // namespace todds::dds
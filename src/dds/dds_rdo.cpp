@@ -0,0 +1,151 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/dds.hpp"
+#include "todds/profiler.hpp"
+
+#include <miniz.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+
+#include "dds_impl.hpp"
+
+namespace {
+
+using todds::dds::impl::pixel_block_size;
+
+using pixels = std::array<std::uint32_t, pixel_block_size>;
+
+using encoded_block = todds::dds::block_cache::encoded_block;
+
+// Blocks are only compared with previous blocks of the same chunk. This keeps the results independent of the ranges
+// chosen by the scheduler.
+constexpr std::size_t chunk_blocks = 256U;
+
+// Number of previous blocks considered as candidates for each block.
+constexpr std::size_t window_blocks = 16U;
+
+// Approximate size in bytes of an LZ match.
+constexpr float match_bytes = 2.0F;
+
+// Mean squared error of each channel of a decoded block.
+float block_error(const std::uint32_t* original, const pixels& decoded, std::size_t channels) noexcept {
+	const std::uint32_t error = todds::dds::impl::block_squared_error(original, decoded.data(), channels);
+	return static_cast<float>(error) / static_cast<float>(pixel_block_size * channels);
+}
+
+// Optimizes the blocks of a chunk in order, allowing later blocks to reuse the optimized data of previous ones.
+std::size_t optimize_chunk(const todds::dds::impl::decode_format& format, float lambda, std::size_t begin,
+	std::size_t end, const todds::pixel_block_image& image, todds::dds_image& result) {
+	const std::size_t block_bytes = format.block_size * sizeof(std::uint64_t);
+	const std::size_t half_bytes = block_bytes / 2U;
+	// Decoded pixels of the previous blocks of the window.
+	std::array<pixels, window_blocks> window{};
+	std::size_t replaced = 0U;
+
+	for (std::size_t block_index = begin; block_index < end; ++block_index) {
+		const std::uint32_t* original = &image[block_index * pixel_block_size];
+		std::uint64_t* dds_block = &result[block_index * format.block_size];
+		pixels& decoded = window[block_index % window_blocks];
+		const std::size_t window_begin = block_index - std::min(block_index - begin, window_blocks - 1U);
+
+		encoded_block best{};
+		std::copy_n(dds_block, format.block_size, best.begin());
+		format.decode(best.data(), decoded.data());
+
+		// Blocks which are already an exact copy of a previous block cannot be improved.
+		bool is_copy = false;
+		for (std::size_t previous = window_begin; previous < block_index && !is_copy; ++previous) {
+			const std::uint64_t* previous_block = &result[previous * format.block_size];
+			is_copy = std::equal(previous_block, previous_block + format.block_size, dds_block);
+		}
+		if (is_copy) { continue; }
+
+		float best_cost = block_error(original, decoded, format.channels) + lambda * static_cast<float>(block_bytes);
+		bool found = false;
+		for (std::size_t previous = block_index; previous-- > window_begin;) {
+			const std::uint64_t* previous_block = &result[previous * format.block_size];
+			const pixels& previous_decoded = window[previous % window_blocks];
+			const float copy_cost = block_error(original, previous_decoded, format.channels) + lambda * match_bytes;
+			if (copy_cost < best_cost) {
+				best_cost = copy_cost;
+				std::copy_n(previous_block, format.block_size, best.begin());
+				found = true;
+			}
+
+			encoded_block partial{};
+			std::copy_n(dds_block, format.block_size, partial.begin());
+			std::memcpy(reinterpret_cast<std::uint8_t*>(partial.data()) + half_bytes,
+				reinterpret_cast<const std::uint8_t*>(previous_block) + half_bytes, half_bytes);
+			pixels partial_decoded{};
+			format.decode(partial.data(), partial_decoded.data());
+			const float partial_cost = block_error(original, partial_decoded, format.channels) +
+																 lambda * (static_cast<float>(half_bytes) + match_bytes);
+			if (partial_cost < best_cost) {
+				best_cost = partial_cost;
+				best = partial;
+				found = true;
+			}
+		}
+
+		if (found) {
+			std::copy_n(best.begin(), format.block_size, dds_block);
+			format.decode(best.data(), decoded.data());
+			++replaced;
+		}
+	}
+
+	return replaced;
+}
+
+mz_bool count_bytes(const void* /*buffer*/, int length, void* user) {
+	*static_cast<std::size_t*>(user) += static_cast<std::size_t>(length);
+	return MZ_TRUE;
+}
+
+// Size of the encoded image after being compressed with the default deflate settings of zip tools.
+std::size_t deflate_size(const todds::dds_image& image) {
+	constexpr int level = 6;
+	const auto flags =
+		static_cast<int>(tdefl_create_comp_flags_from_zip_params(level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+	const auto compressor = std::make_unique<tdefl_compressor>();
+	std::size_t size = 0U;
+	tdefl_init(compressor.get(), count_bytes, &size, flags);
+	tdefl_compress_buffer(compressor.get(), image.data(), image.size() * sizeof(std::uint64_t), TDEFL_FINISH);
+	return size;
+}
+
+} // namespace
+
+namespace todds::dds::impl {
+
+void optimize_rate(
+	const encode_options& options, const decode_format& format, const pixel_block_image& image, dds_image& result) {
+	const std::size_t num_blocks = image.size() / pixel_block_size;
+	rdo_statistics* stats = options.rdo_stats;
+	const bool measure_size = stats != nullptr && options.rdo_measure_size;
+	if (measure_size) { stats->original_size += deflate_size(result); }
+
+	schedule_blocks(options, num_blocks, [&options, &format, &image, &result, stats, num_blocks](
+																				 std::size_t begin, std::size_t end) {
+		TracyZoneScopedN("rdo");
+		// Each range optimizes the chunks starting inside of it.
+		std::size_t replaced = 0U;
+		for (std::size_t chunk = (begin + chunk_blocks - 1U) / chunk_blocks * chunk_blocks; chunk < end;
+				 chunk += chunk_blocks) {
+			replaced +=
+				optimize_chunk(format, options.rdo_lambda, chunk, std::min(chunk + chunk_blocks, num_blocks), image, result);
+		}
+		if (stats != nullptr) { stats->replaced_blocks += replaced; }
+	});
+
+	if (stats != nullptr) { stats->total_blocks += num_blocks; }
+	if (measure_size) { stats->optimized_size += deflate_size(result); }
+}
+
+} // namespace todds::dds::impl
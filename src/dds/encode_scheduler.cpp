@@ -0,0 +1,30 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/encode_scheduler.hpp"
+
+#include <algorithm>
+
+namespace todds::dds {
+
+encode_scheduler::encode_scheduler(std::size_t threads) noexcept
+	: _threads{std::max<std::size_t>(threads, 1U)}
+	, _active_images{} {}
+
+void encode_scheduler::begin_image() noexcept { _active_images.fetch_add(1U, std::memory_order_relaxed); }
+
+void encode_scheduler::end_image() noexcept { _active_images.fetch_sub(1U, std::memory_order_relaxed); }
+
+encode_plan encode_scheduler::plan(std::size_t num_blocks) const noexcept {
+	const std::size_t active_images = std::max<std::size_t>(_active_images.load(std::memory_order_relaxed), 1U);
+	// Threads which are not encoding other images, including the one encoding this image.
+	const std::size_t available_threads = active_images >= _threads ? 1U : _threads - active_images + 1U;
+	if (available_threads == 1U || num_blocks < 2U * min_grain_size) { return {false, num_blocks}; }
+
+	const std::size_t tasks = available_threads * tasks_per_thread;
+	return {true, std::max(min_grain_size, (num_blocks + tasks - 1U) / tasks)};
+}
+
+} // namespace todds::dds
@@ -0,0 +1,74 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace todds::dds {
+
+/** Hit-rate counters shared by every block cache used during an encoding process. */
+struct block_cache_statistics {
+	/** Blocks which reused previously encoded data. */
+	std::atomic<std::size_t> hits{};
+	/** Blocks which had to be encoded. */
+	std::atomic<std::size_t> misses{};
+	/** Encoded blocks which could not be stored because the cache reached its memory limit. */
+	std::atomic<std::size_t> rejected{};
+};
+
+/**
+ * Thread-safe cache of encoded blocks, indexed by the contents of a 4x4 pixel block and the parameters of its encoder.
+ * Entries are never evicted. Once the memory limit has been reached, new blocks are still encoded but not stored.
+ */
+class block_cache final {
+public:
+	/** Encoded data of a single block. Formats using 8 bytes per block only use the first value. */
+	using encoded_block = std::array<std::uint64_t, 2U>;
+
+	/**
+	 * Creates an empty cache.
+	 * @param max_memory Maximum memory in bytes that the cache may use to store entries.
+	 * @param statistics Hit-rate counters updated by this cache.
+	 */
+	block_cache(std::size_t max_memory, block_cache_statistics& statistics);
+	block_cache(const block_cache&) = delete;
+	block_cache(block_cache&&) noexcept = delete;
+	block_cache& operator=(const block_cache&) = delete;
+	block_cache& operator=(block_cache&&) noexcept = delete;
+	~block_cache();
+
+	/**
+	 * Looks up the encoded data of a pixel block.
+	 * @param encoder Identifier of the encoder and parameters used to encode the block.
+	 * @param pixel_block 16 RGBA pixels of the block.
+	 * @param result Set to the encoded data if the block was found.
+	 * @return True if the block was found.
+	 */
+	[[nodiscard]] bool find(std::uint64_t encoder, const std::uint32_t* pixel_block, encoded_block& result) const;
+
+	/**
+	 * Stores the encoded data of a pixel block, if there is memory available for it.
+	 * @param encoder Identifier of the encoder and parameters used to encode the block.
+	 * @param pixel_block 16 RGBA pixels of the block.
+	 * @param block Encoded data.
+	 */
+	void insert(std::uint64_t encoder, const std::uint32_t* pixel_block, const encoded_block& block);
+
+	/**
+	 * Adds lookup results to the statistics of the cache.
+	 * @param hits Number of blocks found in the cache.
+	 * @param misses Number of blocks missing from the cache.
+	 */
+	void record(std::size_t hits, std::size_t misses) noexcept;
+
+private:
+	std::unique_ptr<class block_cache_pimpl> _pimpl;
+};
+
+} // namespace todds::dds
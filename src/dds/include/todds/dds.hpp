@@ -5,6 +5,9 @@
 
 #pragma once
 
+#include "todds/block_cache.hpp"
+#include "todds/cpu.hpp"
+#include "todds/encode_scheduler.hpp"
 #include "todds/format.hpp"
 #include "todds/image_types.hpp"
 
@@ -15,6 +18,7 @@
 #endif // TODDS_ISPC
 
 #include <array>
+#include <atomic>
 #include <memory>
 
 namespace todds::dds {
@@ -25,31 +29,157 @@ using bc7_params = ispc::bc7e_compress_block_params;
 using bc7_params = bc7enc_compress_block_params;
 #endif // TODDS_ISPC
 
+/** Number of blocks encoded with each quality level in adaptive quality mode. */
+struct adaptive_statistics {
+	/** Blocks encoded with the quality of the image. */
+	std::atomic<std::size_t> regular_blocks{};
+	/** Blocks encoded with the low complexity quality. */
+	std::atomic<std::size_t> low_complexity_blocks{};
+};
+
+/** Results of rate-distortion optimization. */
+struct rdo_statistics {
+	/** Blocks replaced by a full or partial copy of a previous block. */
+	std::atomic<std::size_t> replaced_blocks{};
+	/** Blocks considered for replacement. */
+	std::atomic<std::size_t> total_blocks{};
+	/**
+	 * Size in bytes of the encoded images after deflate compression, without rate-distortion optimization. Only measured
+	 * with encode_options::rdo_measure_size.
+	 */
+	std::atomic<std::size_t> original_size{};
+	/**
+	 * Size in bytes of the encoded images after deflate compression, with rate-distortion optimization. Only measured
+	 * with encode_options::rdo_measure_size.
+	 */
+	std::atomic<std::size_t> optimized_size{};
+};
+
+/** Results of the two-tier encoding mode. */
+struct refine_statistics {
+	/** Regions encoded with the fast pass quality. */
+	std::atomic<std::size_t> regions{};
+	/** Regions re-encoded with the quality of the image because of their error. */
+	std::atomic<std::size_t> refined_regions{};
+};
+
+/** Optional features shared by every block encoder. */
+struct encode_options {
+	/** Reuses the encoded data of identical pixel blocks. Blocks are always encoded if this is nullptr. */
+	block_cache* cache{};
+	/**
+	 * BC3 and BC7 encoders emit a canonical block for blocks in which every pixel has zero alpha, discarding their RGB
+	 * values. Programs reading the color of fully transparent pixels should not use this option.
+	 */
+	bool transparent_blocks{};
+	/**
+	 * Blocks whose average channel variance is below this threshold are encoded with low_complexity_quality instead of
+	 * the quality of the image. Adaptive quality is disabled if this value is zero.
+	 */
+	float complexity_threshold{};
+	/** Quality level used for low complexity blocks. */
+	todds::format::quality low_complexity_quality{};
+	/** Updated with the number of blocks encoded with each quality level. Ignored if it is nullptr. */
+	adaptive_statistics* adaptive_stats{};
+	/**
+	 * Chooses between encoding the image on the calling thread and nested parallelism. Images are always encoded with
+	 * nested parallelism if this is nullptr.
+	 */
+	encode_scheduler* scheduler{};
+	/**
+	 * BC1 and BC7 encoders replace blocks with full or partial copies of previous blocks when the increase in error is
+	 * worth the reduction in size after LZ compression. Higher values favor smaller compressed sizes. Rate-distortion
+	 * optimization is disabled if this value is zero.
+	 */
+	float rdo_lambda{};
+	/** Updated with the results of rate-distortion optimization. Ignored if it is nullptr. */
+	rdo_statistics* rdo_stats{};
+	/**
+	 * Also measures the compressed size of each image before and after rate-distortion optimization in rdo_stats. This
+	 * compresses every image twice with deflate, which is slower than the optimization itself.
+	 */
+	bool rdo_measure_size{};
+	/**
+	 * BC1, BC3 and BC7 encoders encode the image with fast_pass_quality first. Regions of blocks with a PSNR lower than
+	 * this value are encoded again with the quality of the image. The two-tier mode is disabled if this value is zero.
+	 */
+	double refine_psnr{};
+	/** Quality level of the first pass of the two-tier mode. */
+	todds::format::quality fast_pass_quality{};
+	/** Updated with the results of the two-tier mode. Ignored if it is nullptr. */
+	refine_statistics* refine_stats{};
+	/**
+	 * Encoding stops within a few milliseconds after this flag is set, leaving the rest of the image unencoded. Images
+	 * are always encoded completely if this is nullptr.
+	 */
+	const std::atomic<bool>* force_finish{};
+};
+
+/** Quality of an encoded image or mipmap level compared with its source pixels. */
+struct quality_metrics {
+	/** Peak signal-to-noise ratio in decibels. Infinity if every pixel has been preserved. */
+	double psnr{};
+	/** Mean structural similarity of every 4x4 block and channel, between -1 and 1. */
+	double ssim{};
+};
+
+/** Quality of an encoded image and each of its mipmap levels. */
+struct image_quality {
+	/** Quality of every block of the image. */
+	quality_metrics image;
+	/** Quality of each mipmap level, starting with the main image. */
+	vector<quality_metrics> levels;
+};
 
 /**
  * Initialize the DDS encoders.
- * This function is not thread safe and it should be called only once.
+ * This function is thread safe, and encoders are only initialized once. The instruction set of the BC7 encoder is
+ * selected by the first call initializing it, and it is shared by every later call regardless of their cpu_target.
  * @param format DDS file format to use for encoding.
  * @param alpha_format Use a different DDS encoding format for files with alpha.
+ * @param grayscale_format Use a different DDS encoding format for grayscale files.
+ * @param cpu_target Instruction set of the BC7 encoder. Only used if bc7e_ispc has been compiled for several targets.
+ * @return Instruction set selected for the BC7 encoder, or cpu::target::automatic if it does not support choosing one.
  */
-void initialize_encoding(format::type format, format::type alpha_format);
+cpu::target initialize_encoding(format::type format, format::type alpha_format,
+	format::type grayscale_format = format::type::invalid, cpu::target cpu_target = cpu::target::automatic);
 
 /**
  * Encode an image to BC1.
  * @param quality DDS encoding quality level.
  * @param image Source pixel block image.
  * @param alpha_black Will use use 3 color blocks for blocks containing black or very dark pixels.
+ * @param options Optional encoding features.
  * @return BC1 encoded image.
  */
-[[nodiscard]] dds_image bc1_encode(todds::format::quality quality, bool alpha_black, const pixel_block_image& image);
+[[nodiscard]] dds_image bc1_encode(
+	todds::format::quality quality, bool alpha_black, const pixel_block_image& image, const encode_options& options = {});
 
 /**
  * Encode an image to BC3.
  * @param quality DDS encoding quality level.
  * @param image Source pixel block image.
+ * @param options Optional encoding features.
  * @return BC3 encoded image.
  */
-[[nodiscard]] dds_image bc3_encode(todds::format::quality quality, const pixel_block_image& image);
+[[nodiscard]] dds_image bc3_encode(
+	todds::format::quality quality, const pixel_block_image& image, const encode_options& options = {});
+
+/**
+ * Encode the red channel of an image to BC4.
+ * @param image Source pixel block image.
+ * @param options Optional encoding features.
+ * @return BC4 encoded image.
+ */
+[[nodiscard]] dds_image bc4_encode(const pixel_block_image& image, const encode_options& options = {});
+
+/**
+ * Encode the red and green channels of an image to BC5.
+ * @param image Source pixel block image.
+ * @param options Optional encoding features.
+ * @return BC5 encoded image.
+ */
+[[nodiscard]] dds_image bc5_encode(const pixel_block_image& image, const encode_options& options = {});
 
 /**
  * Generate the parameters to use for BC7 DDS encoding.
@@ -62,9 +192,25 @@ void initialize_encoding(format::type format, format::type alpha_format);
  * Encode an image to BC7.
  * @param params BC7 block encoding parameters.
  * @param image Source pixel block image.
+ * @param options Optional encoding features.
  * @return BC7 encoded image.
  */
-[[nodiscard]] dds_image bc7_encode(const bc7_params& params, const pixel_block_image& image);
+[[nodiscard]] dds_image bc7_encode(
+	const bc7_params& params, const pixel_block_image& image, const encode_options& options = {});
+
+/**
+ * Decodes an encoded image and compares it with its source pixels.
+ * Only the channels stored by the format are measured. The padding of levels with sizes not divisible by 4 is included.
+ * @param format_type Format of the encoded image.
+ * @param width Width of the main image.
+ * @param height Height of the main image.
+ * @param mipmaps Number of mipmap levels, including the main image.
+ * @param image Source pixel block image.
+ * @param encoded Encoded image.
+ * @return Quality of the image and of each mipmap level.
+ */
+[[nodiscard]] image_quality measure_quality(format::type format_type, std::size_t width, std::size_t height,
+	std::size_t mipmaps, const pixel_block_image& image, const dds_image& encoded);
 
 /**
  * Construct a DDS header.
@@ -77,4 +223,18 @@ void initialize_encoding(format::type format, format::type alpha_format);
 std::array<char, 124> dds_header(
 	todds::format::type format_type, std::size_t width, std::size_t height, std::size_t mipmaps);
 
+/**
+ * Checks if a format requires a DX10 header extension after the DDS header.
+ * @param format_type Format of the file.
+ * @return True if the format requires a header extension.
+ */
+[[nodiscard]] bool has_header_extension(todds::format::type format_type) noexcept;
+
+/**
+ * Construct a DX10 header extension.
+ * @param format_type Format of the file. It must require a header extension.
+ * @return Array containing the DX10 header extension information.
+ */
+std::array<char, 20> dds_header_extension(todds::format::type format_type);
+
 } // namespace todds::dds
@@ -0,0 +1,63 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace todds::dds {
+
+/** Parallelization strategy chosen for the blocks of a single image. */
+struct encode_plan {
+	/** Encode the blocks of the image using nested parallelism. When false, the calling thread encodes every block. */
+	bool parallel;
+	/** Minimum number of blocks processed by each task when parallel is true. */
+	std::size_t grain_size;
+};
+
+/**
+ * Chooses between inter-file and intra-file parallelism for each image.
+ * While the pipeline has at least one image in the encoding stage per thread, every thread is already busy and nested
+ * parallelism would only add scheduling overhead. When the pipeline is draining or processing few huge images, idle
+ * threads are shared between the images being encoded.
+ */
+class encode_scheduler final {
+public:
+	/** Smallest number of blocks processed by each task of a nested parallel loop. */
+	static constexpr std::size_t min_grain_size = 64U;
+	/** Number of tasks created for each available thread, to balance the load between them. */
+	static constexpr std::size_t tasks_per_thread = 4U;
+
+	/**
+	 * Creates a scheduler.
+	 * @param threads Number of threads used by the pipeline.
+	 */
+	explicit encode_scheduler(std::size_t threads) noexcept;
+	encode_scheduler(const encode_scheduler&) = delete;
+	encode_scheduler(encode_scheduler&&) noexcept = delete;
+	encode_scheduler& operator=(const encode_scheduler&) = delete;
+	encode_scheduler& operator=(encode_scheduler&&) noexcept = delete;
+	~encode_scheduler() = default;
+
+	/** Registers an image entering the encoding stage. */
+	void begin_image() noexcept;
+
+	/** Registers an image leaving the encoding stage. */
+	void end_image() noexcept;
+
+	/**
+	 * Chooses how to encode an image which has already been registered with begin_image.
+	 * @param num_blocks Number of blocks of the image.
+	 * @return Parallelization strategy for the image.
+	 */
+	[[nodiscard]] encode_plan plan(std::size_t num_blocks) const noexcept;
+
+private:
+	std::size_t _threads;
+	std::atomic<std::size_t> _active_images;
+};
+
+} // namespace todds::dds
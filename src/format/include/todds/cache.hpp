@@ -0,0 +1,45 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace todds::cache {
+
+/**
+ * Scope of the cache used to reuse the encoded data of identical 4x4 pixel blocks.
+ */
+enum class scope : std::uint8_t {
+	none,
+	image,
+	batch,
+};
+
+[[nodiscard]] constexpr std::string_view name(scope scp) noexcept {
+	std::string_view name_str{};
+	switch (scp) {
+	case scope::none: name_str = "NONE"; break;
+	case scope::image: name_str = "IMAGE"; break;
+	case scope::batch: name_str = "BATCH"; break;
+	}
+	return name_str;
+}
+
+[[nodiscard]] constexpr std::string_view description(scope scp) noexcept {
+	std::string_view desc_str{};
+	switch (scp) {
+	case scope::none: desc_str = "Every block is encoded, even if it is identical to a previous one."; break;
+	case scope::image: desc_str = "Identical blocks of the same image are only encoded once."; break;
+	case scope::batch:
+		desc_str = "Identical blocks are only encoded once across every image. Recommended for tiled textures and sprite "
+							 "sheets sharing the same assets.";
+		break;
+	}
+	return desc_str;
+}
+
+} // namespace todds::cache
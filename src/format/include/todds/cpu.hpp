@@ -0,0 +1,51 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace todds::cpu {
+
+/**
+ * Instruction set used by the BC7 encoder when todds has been compiled for several ISPC targets.
+ */
+enum class target : std::uint8_t {
+	automatic,
+	sse2,
+	sse4,
+	avx,
+	avx2,
+	avx512,
+};
+
+[[nodiscard]] constexpr std::string_view name(target tgt) noexcept {
+	std::string_view name_str{};
+	switch (tgt) {
+	case target::automatic: name_str = "AUTO"; break;
+	case target::sse2: name_str = "SSE2"; break;
+	case target::sse4: name_str = "SSE4"; break;
+	case target::avx: name_str = "AVX"; break;
+	case target::avx2: name_str = "AVX2"; break;
+	case target::avx512: name_str = "AVX512"; break;
+	}
+	return name_str;
+}
+
+[[nodiscard]] constexpr std::string_view description(target tgt) noexcept {
+	std::string_view desc_str{};
+	switch (tgt) {
+	case target::automatic: desc_str = "Use the fastest instruction set supported by the CPU."; break;
+	case target::sse2: desc_str = "SSE2. Supported by every x86-64 CPU."; break;
+	case target::sse4: desc_str = "SSE4.2."; break;
+	case target::avx: desc_str = "AVX."; break;
+	case target::avx2: desc_str = "AVX2 and FMA."; break;
+	case target::avx512: desc_str = "AVX-512 (F, CD, DQ, BW and VL)."; break;
+	}
+	return desc_str;
+}
+
+} // namespace todds::cpu
@@ -10,7 +10,7 @@
 
 namespace todds::format {
 
-enum class type : std::uint8_t { bc1, bc3, bc7, png, invalid };
+enum class type : std::uint8_t { bc1, bc3, bc4, bc5, bc7, png, invalid };
 
 enum class quality : std::uint8_t {
 	ultra_fast = 0U,
@@ -30,6 +30,8 @@ enum class quality : std::uint8_t {
 	switch (fmt) {
 	case type::bc1: name_str = "BC1"; break;
 	case type::bc3: name_str = "BC3"; break;
+	case type::bc4: name_str = "BC4"; break;
+	case type::bc5: name_str = "BC5"; break;
 	case type::bc7: name_str = "BC7"; break;
 	case type::png: name_str = "PNG"; break;
 	case type::invalid: break;
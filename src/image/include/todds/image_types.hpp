@@ -5,8 +5,8 @@
 
 #pragma once
 
+#include "todds/buffer_pool.hpp"
 #include "todds/mipmap_image.hpp"
-#include "todds/vector.hpp"
 
 #include <cstdint>
 
@@ -17,9 +17,9 @@ constexpr std::size_t pixel_block_side = 4UL;
 /**
  * RGBA pixel block image.
  */
-using pixel_block_image = vector<std::uint32_t>;
+using pixel_block_image = buffer_pool::vector<std::uint32_t>;
 
-using dds_image = vector<std::uint64_t>;
+using dds_image = buffer_pool::vector<std::uint64_t>;
 
 pixel_block_image to_pixel_blocks(const mipmap_image& img);
 
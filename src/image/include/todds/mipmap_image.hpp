@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "todds/buffer_pool.hpp"
 #include "todds/image.hpp"
 #include "todds/vector.hpp"
 
@@ -47,7 +48,7 @@ public:
 
 private:
 	std::size_t _file_index;
-	vector<std::uint8_t> _data;
+	buffer_pool::vector<std::uint8_t> _data;
 	vector<image> _images;
 };
 
@@ -15,6 +15,8 @@
 #include <oneapi/tbb/tick_count.h>
 
 #include <charconv>
+#include <chrono>
+#include <future>
 
 #if BOOST_OS_WINDOWS
 #include <windows.h>
@@ -57,12 +59,22 @@ void handle_ctrl_c_signal() {
 }
 #endif
 
+// Progress is displayed at most once during this interval, no matter how many reports are received.
+constexpr std::chrono::milliseconds refresh_interval{50};
+
 void process_pipeline_reports(
 	const todds::args::data& data, std::future<void>& pipeline, todds::report_queue& updates) {
 	std::size_t current_texture_count{};
 	std::size_t total_texture_count{};
+	bool finished = false;
+
+	while (!finished || !updates.empty()) {
+		// Wait for the first report, and then for the rest of the interval to coalesce the reports following it. Both
+		// waits block without using the CPU, and the second one ends as soon as the pipeline finishes.
+		const auto refresh_end = std::chrono::steady_clock::now() + refresh_interval;
+		updates.wait_for(refresh_interval);
+		finished = pipeline.wait_until(refresh_end) == std::future_status::ready;
 
-	while (!updates.empty() || pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
 		todds::report update{};
 		const std::size_t previous_texture_count = current_texture_count;
 
@@ -77,11 +89,15 @@ void process_pipeline_reports(
 				if (data.verbose) { cout << fmt::format("{:s}\n", update.data()); }
 				break;
 			case todds::report_type::process_started:
+				// Watch mode starts processing files several times.
+				current_texture_count = 0U;
 				total_texture_count = update.value();
 				cout << fmt::format("Processing {:d} textures.\n", total_texture_count);
 				break;
 			case todds::report_type::encoding_progress: ++current_texture_count; break;
 			case todds::report_type::pipeline_error: cerr << update.data() << '\n'; break;
+			case todds::report_type::statistics: cout << update.data() << '\n'; break;
+			case todds::report_type::file_report: cout << update.data() << '\n'; break;
 			}
 		}
 
@@ -92,8 +108,6 @@ void process_pipeline_reports(
 
 		cout.flush();
 		cerr.flush();
-		using namespace std::chrono_literals;
-		std::this_thread::sleep_for(50ms);
 	}
 
 	// Set up the stream for the next string.
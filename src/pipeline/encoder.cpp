@@ -0,0 +1,301 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/encoder.hpp"
+
+#include "todds/dds.hpp"
+#include "todds/encode_scheduler.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/png.hpp"
+#include "todds/string.hpp"
+#include "todds/vector.hpp"
+
+#include <fmt/format.h>
+#include <oneapi/tbb/parallel_pipeline.h>
+#include <oneapi/tbb/task_arena.h>
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "filter_common.hpp"
+#include "filter_encode_dds.hpp"
+#include "filter_generate_mipmaps.hpp"
+#include "filter_pixel_blocks.hpp"
+#include "filter_save_dds.hpp"
+#include "small_texture_lane.hpp"
+
+namespace otbb = oneapi::tbb;
+
+namespace {
+
+using todds::encoder_image;
+using todds::encoder_settings;
+
+// Images are already processed in parallel, so OpenCV runs in sequential mode while any encoder is alive. This setting
+// is global, and the number of threads used by OpenCV before the first encoder is restored by the last one.
+std::mutex opencv_mutex;
+std::size_t opencv_users{};
+int opencv_threads{};
+
+void use_sequential_opencv() {
+	const std::lock_guard lock{opencv_mutex};
+	if (opencv_users++ > 0U) { return; }
+	opencv_threads = cv::getNumThreads();
+	cv::setNumThreads(0);
+}
+
+void restore_opencv_threads() {
+	const std::lock_guard lock{opencv_mutex};
+	if (--opencv_users > 0U) { return; }
+	cv::setNumThreads(opencv_threads);
+}
+
+struct job {
+	encoder_image image;
+	encoder_settings settings;
+	std::promise<std::vector<std::uint8_t>> result;
+	// Reason why the image could not be decoded.
+	std::string error;
+	bool finished{};
+};
+
+// Copies RGBA pixels into a mipmap image, allocating memory for its mipmaps if needed.
+std::unique_ptr<todds::mipmap_image> from_rgba(
+	std::size_t file_index, const encoder_image& input, bool flip, bool mipmaps) {
+	const std::size_t row_bytes = input.width * todds::image::bytes_per_pixel;
+	if (input.data.size() != row_bytes * input.height) {
+		throw std::runtime_error{fmt::format("A {:d}x{:d} RGBA image requires {:d} bytes, but {:d} were provided.",
+			input.width, input.height, row_bytes * input.height, input.data.size())};
+	}
+
+	auto result = std::make_unique<todds::mipmap_image>(file_index, input.width, input.height, mipmaps);
+	todds::image& first = result->get_image(0UL);
+	for (std::size_t row = 0UL; row < input.height; ++row) {
+		const auto* row_start = input.data.data() + row * row_bytes;
+		std::copy(row_start, row_start + row_bytes, &first.row_start(!flip ? row : input.height - row - 1UL));
+	}
+	return result;
+}
+
+// Decodes each image of a batch and registers its size.
+class prepare_image final {
+public:
+	prepare_image(todds::vector<job>& batch, todds::vector<todds::pipeline::impl::file_data>& files_data) noexcept
+		: _batch{batch}
+		, _files_data{files_data} {}
+
+	std::unique_ptr<todds::mipmap_image> operator()(std::size_t file_index) const {
+		std::unique_ptr<todds::mipmap_image> result{};
+		job& current = _batch[file_index];
+		auto& file_data = _files_data[file_index];
+		const bool mipmaps = current.settings.mipmaps;
+		try {
+			if (current.image.width == 0UL && current.image.height == 0UL) {
+				const todds::string name = "submitted PNG file";
+				result = todds::png::decode(
+					file_index, name, current.image.data, current.settings.vflip, file_data.width, file_data.height, mipmaps);
+			} else {
+				result = from_rgba(file_index, current.image, current.settings.vflip, mipmaps);
+				file_data.width = current.image.width;
+				file_data.height = current.image.height;
+			}
+			file_data.mipmaps = result->mipmap_count();
+		} catch (const std::runtime_error& exc) { current.error = exc.what(); }
+		// The source data is not needed anymore.
+		current.image.data = {};
+		return result;
+	}
+
+private:
+	todds::vector<job>& _batch;
+	todds::vector<todds::pipeline::impl::file_data>& _files_data;
+};
+
+// Writes the DDS file of each encoded image into memory and hands it to the caller.
+class complete_image final {
+public:
+	complete_image(todds::vector<job>& batch, const todds::vector<todds::pipeline::impl::file_data>& files_data) noexcept
+		: _batch{batch}
+		, _files_data{files_data} {}
+
+	void operator()(const todds::vector<todds::pipeline::impl::dds_data>& dds_images) const {
+		for (const auto& dds_img : dds_images) {
+			if (dds_img.file_index == todds::pipeline::impl::error_file_index) [[unlikely]] { continue; }
+			const todds::pipeline::impl::dds_file_header header{_files_data[dds_img.file_index]};
+			const std::size_t image_bytes = dds_img.image.size() * sizeof(std::uint64_t);
+			std::vector<std::uint8_t> file(header.data().size() + image_bytes);
+			const auto output = std::copy(header.data().begin(), header.data().end(), file.begin());
+			const auto* image_start = reinterpret_cast<const std::uint8_t*>(dds_img.image.data());
+			std::copy(image_start, image_start + image_bytes, output);
+
+			job& current = _batch[dds_img.file_index];
+			current.result.set_value(std::move(file));
+			current.finished = true;
+		}
+	}
+
+private:
+	todds::vector<job>& _batch;
+	const todds::vector<todds::pipeline::impl::file_data>& _files_data;
+};
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+class encoder_engine final {
+public:
+	encoder_engine(std::size_t threads, cpu::target cpu_target)
+		: _threads{std::max<std::size_t>(threads, 1UL)}
+		, _arena{static_cast<int>(_threads)}
+		, _scheduler{_threads}
+		, _mutex{}
+		, _pending_changed{}
+		, _pending{}
+		, _dispatcher{} {
+		// Every format is initialized up front, since submissions may use any of them.
+		static_cast<void>(
+			dds::initialize_encoding(format::type::bc7, format::type::bc1, format::type::invalid, cpu_target));
+		_arena.initialize();
+		use_sequential_opencv();
+		_dispatcher = std::thread{[this] { dispatch(); }};
+	}
+
+	encoder_engine(const encoder_engine&) = delete;
+	encoder_engine(encoder_engine&&) noexcept = delete;
+	encoder_engine& operator=(const encoder_engine&) = delete;
+	encoder_engine& operator=(encoder_engine&&) noexcept = delete;
+
+	~encoder_engine() {
+		{
+			const std::lock_guard lock{_mutex};
+			_stopping = true;
+		}
+		_pending_changed.notify_one();
+		_dispatcher.join();
+		restore_opencv_threads();
+	}
+
+	std::future<std::vector<std::uint8_t>> submit(encoder_image image, const encoder_settings& settings) {
+		job current{std::move(image), settings, {}, {}, false};
+		auto result = current.result.get_future();
+		if (settings.format == format::type::png || settings.format == format::type::invalid) [[unlikely]] {
+			current.result.set_exception(std::make_exception_ptr(std::runtime_error{
+				fmt::format("The encoder does not support the {:s} format.", format::name(settings.format))}));
+			return result;
+		}
+
+		{
+			const std::lock_guard lock{_mutex};
+			_pending.emplace_back(std::move(current));
+		}
+		_pending_changed.notify_one();
+		return result;
+	}
+
+private:
+	// Images submitted while a batch is being encoded wait for the next one. Each batch only contains images with the
+	// same settings, the rest are left for the following batches.
+	void dispatch() {
+		while (true) {
+			vector<job> batch;
+			{
+				std::unique_lock lock{_mutex};
+				_pending_changed.wait(lock, [this] { return _stopping || !_pending.empty(); });
+				if (_pending.empty()) { return; }
+				const encoder_settings settings = _pending.front().settings;
+				const auto batch_end = std::stable_partition(
+					_pending.begin(), _pending.end(), [&settings](const job& current) { return current.settings == settings; });
+				batch.assign(std::make_move_iterator(_pending.begin()), std::make_move_iterator(batch_end));
+				_pending.erase(_pending.begin(), batch_end);
+			}
+			encode_batch(batch);
+		}
+	}
+
+	void encode_batch(vector<job>& batch) {
+		const encoder_settings& settings = batch.front().settings;
+		vector<file_data> files_data(batch.size());
+		// Small images of the batch are encoded together.
+		small_texture_lane small_textures;
+		encode_settings encoding{};
+		encoding.scheduler = &_scheduler;
+		encoding.small_textures = &small_textures;
+
+		// Submitted images are taken in order, and each one keeps its position in the batch as its file index.
+		std::size_t next_index = 0UL;
+		const auto next_image = otbb::make_filter<void, std::size_t>(otbb::filter_mode::serial_in_order,
+			[&next_index, size = batch.size()](otbb::flow_control& control) {
+				if (next_index >= size) {
+					control.stop();
+					return std::size_t{};
+				}
+				return next_index++;
+			});
+		auto prepare = next_image & otbb::make_filter<std::size_t, std::unique_ptr<mipmap_image>>(
+			otbb::filter_mode::parallel, prepare_image{batch, files_data});
+		if (settings.mipmaps) {
+			prepare &= generate_mipmaps_filter(settings.mipmap_filter, settings.mipmap_blur, nullptr, nullptr);
+		}
+		const auto encode = pixel_blocks_filter(nullptr) &
+			encode_dds_filter(files_data, settings.format, settings.alpha_format, settings.grayscale_format, settings.quality,
+				settings.alpha_black, encoding, nullptr);
+		const auto complete = otbb::make_filter<vector<dds_data>, void>(
+			otbb::filter_mode::serial_out_of_order, complete_image{batch, files_data});
+		const otbb::filter<void, void> filters = prepare & encode & complete;
+		// Small images left in the lane are encoded once every image of the batch has been processed.
+		const otbb::filter<void, void> pending_filters =
+			encode_pending_small_textures_filter(files_data, settings.quality, settings.alpha_black, encoding) & complete;
+
+		std::exception_ptr failure{};
+		try {
+			_arena.execute([this, &filters, &pending_filters] {
+				otbb::parallel_pipeline(_threads * 4UL, filters);
+				otbb::parallel_pipeline(1UL, pending_filters);
+			});
+		} catch (...) { failure = std::current_exception(); }
+
+		for (job& current : batch) {
+			if (current.finished) { continue; }
+			if (failure == nullptr) {
+				const char* error = current.error.empty() ? "The image could not be encoded." : current.error.c_str();
+				current.result.set_exception(std::make_exception_ptr(std::runtime_error{error}));
+			} else {
+				current.result.set_exception(failure);
+			}
+		}
+	}
+
+	std::size_t _threads;
+	otbb::task_arena _arena;
+	dds::encode_scheduler _scheduler;
+	std::mutex _mutex;
+	std::condition_variable _pending_changed;
+	vector<job> _pending;
+	bool _stopping{};
+	std::thread _dispatcher;
+};
+
+} // namespace todds::pipeline::impl
+
+namespace todds {
+
+encoder::encoder(std::size_t threads, cpu::target cpu_target)
+	: _engine{std::make_unique<pipeline::impl::encoder_engine>(threads, cpu_target)} {}
+
+encoder::~encoder() = default;
+
+std::future<std::vector<std::uint8_t>> encoder::submit(encoder_image image, const encoder_settings& settings) {
+	return _engine->submit(std::move(image), settings);
+}
+
+} // namespace todds
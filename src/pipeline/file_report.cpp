@@ -0,0 +1,94 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "file_report.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+#include "stage_statistics.hpp"
+
+namespace {
+
+using todds::pipeline::impl::alpha_type;
+
+constexpr std::string_view alpha_name(alpha_type alpha) noexcept {
+	std::string_view name_str{};
+	switch (alpha) {
+	case alpha_type::unknown: break;
+	case alpha_type::opaque: name_str = "Opaque"; break;
+	case alpha_type::transparent: name_str = "Transparent"; break;
+	}
+	return name_str;
+}
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+file_report::file_report(const input& input_data, vector<file_data>& files_data, report_queue& updates)
+	: _paths{input_data.paths}
+	, _files_data{files_data}
+	, _format{input_data.format}
+	, _quality_metrics{input_data.quality_metrics && input_data.format != format::type::png}
+	, _updates{updates} {
+	string header{"File;Width;Height;Mipmaps;Format"};
+	if (_quality_metrics) { header += ";PSNR;SSIM;Mipmap PSNR"; }
+	header += ";Alpha;Input bytes;Output bytes";
+	for (std::size_t index = 0U; index < static_cast<std::size_t>(stage::total_stages); ++index) {
+		header += fmt::format(";{:s} ms", stage_name(static_cast<stage>(index)));
+	}
+	header += ";Error";
+	_updates.emplace(report_type::file_report, std::move(header));
+}
+
+void file_report::record_time(stage stg, std::size_t file_index, std::uint64_t nanoseconds) {
+	if (file_index == error_file_index) [[unlikely]] { return; }
+	file_data& data = _files_data[file_index];
+	data.stage_ns[static_cast<std::size_t>(stg)] += nanoseconds;
+	// Files which could not be written have already sent their row.
+	if ((stg == stage::save_dds || stg == stage::save_png) && data.output_bytes > 0U) { send(file_index, {}); }
+}
+
+void file_report::failed(std::size_t file_index, std::string_view error) { send(file_index, error); }
+
+void file_report::send(std::size_t file_index, std::string_view error) {
+	const file_data& data = _files_data[file_index];
+	const bool written = data.output_bytes > 0U;
+	// file_data only contains the format of DDS files.
+	const format::type output_format = _format == format::type::png ? _format : data.format;
+	const std::string_view format_name = written ? format::name(output_format) : std::string_view{};
+	string row = fmt::format("{:s};{:d};{:d};{:d};{:s}", _paths[file_index].second.string(), data.width, data.height,
+		data.mipmaps, format_name);
+	if (_quality_metrics) {
+		string levels;
+		for (const auto& level : data.quality.levels) {
+			levels += fmt::format("{:s}{:.2f}", levels.empty() ? "" : ",", level.psnr);
+		}
+		if (written) {
+			row += fmt::format(";{:.2f};{:.4f};{:s}", data.quality.image.psnr, data.quality.image.ssim, levels);
+		} else {
+			row += ";;;";
+		}
+	}
+	row += fmt::format(";{:s};{:d};{:d}", alpha_name(data.alpha), data.input_bytes, data.output_bytes);
+	for (const std::uint64_t nanoseconds : data.stage_ns) {
+		row += fmt::format(";{:.3f}", static_cast<double>(nanoseconds) / 1000000.0);
+	}
+
+	// Errors are kept in a single column.
+	string error_column{error};
+	std::replace_if(error_column.begin(), error_column.end(), [](char chr) { return chr == ';' || chr == '\n'; }, ' ');
+	row += fmt::format(";{:s}", error_column);
+	_updates.emplace(report_type::file_report, std::move(row));
+}
+
+void report_file_error(report_queue& updates, file_report* report, std::size_t file_index, string error) {
+	if (report != nullptr) { report->failed(file_index, error); }
+	updates.emplace(report_type::pipeline_error, std::move(error));
+}
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,71 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/input.hpp"
+#include "todds/report.hpp"
+#include "todds/string.hpp"
+#include "todds/vector.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+#include "filter_common.hpp"
+
+namespace todds::pipeline::impl {
+
+/**
+ * Sends a report row for each file as soon as it has been processed, instead of waiting for the pipeline to finish.
+ * Rows are separated with semicolons. They contain the size, format and transparency of the image, the size of its
+ * input and output files, the time spent by each stage on it and the error preventing it from being processed, if any.
+ * Rows of images with quality metrics include them after their format.
+ */
+class file_report final {
+public:
+	/**
+	 * Sends the header of the report.
+	 * @param input_data Input of the pipeline.
+	 * @param files_data Data of each file.
+	 * @param updates Queue receiving the rows of the report.
+	 */
+	file_report(const input& input_data, vector<file_data>& files_data, report_queue& updates);
+
+	/**
+	 * Adds the time spent by a stage to a file. Each file is processed by a single token at a time, so this function
+	 * does not require synchronization. The row of the file is sent once the stage writing it has recorded its time.
+	 * @param stg Stage processing the file.
+	 * @param file_index Index of the file. Files with errors are ignored.
+	 * @param nanoseconds Time spent by the stage on the file.
+	 */
+	void record_time(stage stg, std::size_t file_index, std::uint64_t nanoseconds);
+
+	/**
+	 * Sends the row of a file which could not be processed.
+	 * @param file_index Index of the file.
+	 * @param error Description of the error.
+	 */
+	void failed(std::size_t file_index, std::string_view error);
+
+private:
+	void send(std::size_t file_index, std::string_view error);
+
+	const paths_vector& _paths;
+	vector<file_data>& _files_data;
+	format::type _format;
+	bool _quality_metrics;
+	report_queue& _updates;
+};
+
+/**
+ * Reports an error preventing a file from being processed, both to the user and in the report of the file.
+ * @param updates Queue receiving the error.
+ * @param report Report of each file. Only the user receives the error if this is nullptr.
+ * @param file_index Index of the file.
+ * @param error Description of the error.
+ */
+void report_file_error(report_queue& updates, file_report* report, std::size_t file_index, string error);
+
+} // namespace todds::pipeline::impl
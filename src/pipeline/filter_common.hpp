@@ -5,11 +5,14 @@
 
 #pragma once
 
+#include "todds/dds.hpp"
 #include "todds/format.hpp"
 #include "todds/report.hpp"
 
 #include <oneapi/tbb/concurrent_queue.h>
 
+#include <array>
+#include <cstdint>
 #include <limits>
 
 namespace todds::pipeline::impl {
@@ -17,6 +20,28 @@ namespace todds::pipeline::impl {
 // Files using this file index have triggered errors and should not be processed.
 constexpr std::size_t error_file_index = std::numeric_limits<std::size_t>::max();
 
+/** Filters of the pipeline measured by pipeline_statistics. */
+enum class stage : std::uint8_t {
+	load_png,
+	decode_png,
+	scale_image,
+	generate_mipmaps,
+	pixel_blocks,
+	encode_dds,
+	measure_quality,
+	save_dds,
+	encode_png,
+	save_png,
+	total_stages,
+};
+
+// Transparency of an image, when it has been checked to choose its format.
+enum class alpha_type : std::uint8_t {
+	unknown,
+	opaque,
+	transparent,
+};
+
 struct file_data {
 	// Width of the image excluding extra columns. Set during the decoding PNG stage.
 	std::size_t width{};
@@ -26,6 +51,22 @@ struct file_data {
 	std::size_t mipmaps{};
 	// DDS format of the image. Set during the encoding DDS stage.
 	format::type format{};
+	// Quality of the encoded image. Set during the measure quality stage.
+	dds::image_quality quality{};
+	// Size of the PNG file. Set during the decode PNG stage.
+	std::size_t input_bytes{};
+	// Size of the output file. Set once it has been written.
+	std::size_t output_bytes{};
+	// Transparency of the image. Set during the encoding DDS stage if it is used to choose the format of the image.
+	alpha_type alpha{};
+	// Time spent by each stage on this file in nanoseconds. Only measured when per-file reports are enabled.
+	std::array<std::uint64_t, static_cast<std::size_t>(stage::total_stages)> stage_ns{};
 };
 
+// Latency and throughput of each pipeline stage. Defined in stage_statistics.hpp.
+class pipeline_statistics;
+
+// Report of each file. Defined in file_report.hpp.
+class file_report;
+
 } // namespace todds::pipeline::impl
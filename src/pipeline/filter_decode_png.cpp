@@ -19,6 +19,9 @@
 #include <boost/nowide/fstream.hpp>
 #endif // defined(TODDS_PIPELINE_DUMP)
 
+#include "file_report.hpp"
+#include "stage_statistics.hpp"
+
 namespace {
 
 std::unique_ptr<todds::mipmap_image> fix_image_size(todds::mipmap_image& original, bool mipmaps) {
@@ -28,11 +31,18 @@ std::unique_ptr<todds::mipmap_image> fix_image_size(todds::mipmap_image& origina
 	std::unique_ptr<todds::mipmap_image> resized =
 		std::make_unique<todds::mipmap_image>(original.file_index(), new_width, new_height, mipmaps);
 
+	// Image buffers are not initialized, so padding pixels must be set to zero explicitly.
 	auto& resized_img = resized->get_image(0UL);
+	const std::size_t row_bytes = original_img.width() * todds::image::bytes_per_pixel;
+	const std::size_t padding_bytes = (new_width - original_img.width()) * todds::image::bytes_per_pixel;
 	for (std::size_t row = 0UL; row < original_img.height(); ++row) {
 		const std::uint8_t* original_start = &original_img.row_start(row);
-		const std::uint8_t* original_end = original_start + original_img.width() * todds::image::bytes_per_pixel;
-		std::copy(original_start, original_end, &resized_img.row_start(row));
+		std::uint8_t* resized_start = &resized_img.row_start(row);
+		std::copy(original_start, original_start + row_bytes, resized_start);
+		std::fill_n(resized_start + row_bytes, padding_bytes, std::uint8_t{});
+	}
+	for (std::size_t row = original_img.height(); row < new_height; ++row) {
+		std::fill_n(&resized_img.row_start(row), new_width * todds::image::bytes_per_pixel, std::uint8_t{});
 	}
 	return resized;
 }
@@ -44,11 +54,12 @@ namespace todds::pipeline::impl {
 class decode_png final {
 public:
 	explicit decode_png(vector<file_data>& files_data, const paths_vector& paths, bool vflip, bool mipmaps, bool fix_size,
-		report_queue& updates) noexcept
+		report_queue& updates, file_report* report) noexcept
 		: _files_data{files_data}
 		, _paths{paths}
 		, _vflip{vflip}
 		, _updates{updates}
+		, _report{report}
 		, _mipmaps{mipmaps}
 		, _fix_size{fix_size} {}
 
@@ -62,6 +73,7 @@ public:
 			const string& path = _paths[file.file_index].first.string();
 			try {
 				auto& file_data = _files_data[file.file_index];
+				file_data.input_bytes = file.buffer.size();
 				// Load the first image of the mipmap image and reserve the memory for the rest of the images.
 				result = png::decode(file.file_index, path, file.buffer, _vflip, file_data.width, file_data.height, _mipmaps);
 				const auto& first = result->get_image(0UL);
@@ -80,7 +92,8 @@ public:
 				dmp.write(reinterpret_cast<const char*>(image_start), static_cast<std::ptrdiff_t>(result->data_size()));
 #endif // defined(TODDS_PIPELINE_DUMP)
 			} catch (const std::runtime_error& exc) {
-				_updates.emplace(report_type::pipeline_error, fmt::format("PNG Decoding error {:s} -> {:s}", path, exc.what()));
+				report_file_error(
+					_updates, _report, file.file_index, fmt::format("PNG Decoding error {:s} -> {:s}", path, exc.what()));
 			}
 		}
 
@@ -92,14 +105,16 @@ private:
 	const paths_vector& _paths;
 	bool _vflip;
 	report_queue& _updates;
+	file_report* _report;
 	bool _mipmaps;
 	bool _fix_size;
 };
 
 oneapi::tbb::filter<png_file, std::unique_ptr<mipmap_image>> decode_png_filter(vector<file_data>& files_data,
-	const paths_vector& paths, bool vflip, bool mipmaps, bool fix_size, report_queue& updates) {
-	return oneapi::tbb::make_filter<png_file, std::unique_ptr<mipmap_image>>(
-		oneapi::tbb::filter_mode::parallel, decode_png(files_data, paths, vflip, mipmaps, fix_size, updates));
+	const paths_vector& paths, bool vflip, bool mipmaps, bool fix_size, report_queue& updates, file_report* report,
+	pipeline_statistics* stats) {
+	return make_timed_filter<png_file, std::unique_ptr<mipmap_image>>(
+		stats, stage::decode_png, decode_png(files_data, paths, vflip, mipmaps, fix_size, updates, report));
 }
 
 } // namespace todds::pipeline::impl
@@ -20,5 +20,6 @@
 
 namespace todds::pipeline::impl {
 oneapi::tbb::filter<png_file, std::unique_ptr<mipmap_image>> decode_png_filter(vector<file_data>& files_data,
-	const paths_vector& paths, bool vflip, bool mipmaps, bool fix_size, report_queue& updates);
+	const paths_vector& paths, bool vflip, bool mipmaps, bool fix_size, report_queue& updates, file_report* report,
+	pipeline_statistics* stats);
 } // namespace todds::pipeline::impl
@@ -7,16 +7,22 @@
 
 #include "todds/dds.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <limits>
+#include <memory>
 
 #if defined(TODDS_PIPELINE_DUMP)
 #include <boost/dll/runtime_symbol_info.hpp>
 #include <boost/nowide/fstream.hpp>
 #endif // defined(TODDS_PIPELINE_DUMP)
 
+#include "stage_statistics.hpp"
+
 namespace {
 
+constexpr std::size_t pixels_per_block = todds::pixel_block_side * todds::pixel_block_side;
+
 todds::pipeline::impl::dds_data create_dds_data(todds::dds_image image, std::size_t file_index) {
 	todds::pipeline::impl::dds_data data{std::move(image), file_index};
 #if defined(TODDS_PIPELINE_DUMP)
@@ -42,126 +48,225 @@ bool has_alpha(const todds::pixel_block_image& img) {
 	return false;
 }
 
+// When using grayscale_format, this function determines if a file should be encoded as grayscale.
+bool is_grayscale(const todds::pixel_block_image& img) {
+	constexpr std::uint32_t opaque = 0xFF000000U;
+	constexpr std::uint32_t channel_mask = 0xFFU;
+	return std::all_of(img.cbegin(), img.cend(), [](std::uint32_t pixel) {
+		const std::uint32_t red = pixel & channel_mask;
+		const std::uint32_t green = (pixel >> 8U) & channel_mask;
+		const std::uint32_t blue = (pixel >> 16U) & channel_mask;
+		return (pixel & opaque) == opaque && green == red && blue == red;
+	});
+}
+
+// Encoding options of a single image. Owns its block cache when caches are limited to one image.
+class image_encode_options final {
+public:
+	explicit image_encode_options(const todds::pipeline::impl::encode_settings& settings)
+		: _image_cache{}
+		, _options{} {
+		_options.transparent_blocks = settings.transparent_blocks;
+		_options.complexity_threshold = settings.complexity_threshold;
+		_options.low_complexity_quality = settings.low_complexity_quality;
+		_options.adaptive_stats = settings.adaptive_stats;
+		_options.scheduler = settings.scheduler;
+		_options.rdo_lambda = settings.rdo_lambda;
+		_options.rdo_stats = settings.rdo_stats;
+		_options.rdo_measure_size = settings.rdo_measure_size;
+		_options.refine_psnr = settings.refine_psnr;
+		_options.fast_pass_quality = settings.fast_pass_quality;
+		_options.refine_stats = settings.refine_stats;
+		_options.force_finish = settings.force_finish;
+		if (settings.cache_scope == todds::cache::scope::image) {
+			_image_cache = std::make_unique<todds::dds::block_cache>(settings.cache_memory, *settings.cache_statistics);
+			_options.cache = _image_cache.get();
+		} else {
+			_options.cache = settings.batch_cache;
+		}
+	}
+	image_encode_options(const image_encode_options&) = delete;
+	image_encode_options(image_encode_options&&) noexcept = delete;
+	image_encode_options& operator=(const image_encode_options&) = delete;
+	image_encode_options& operator=(image_encode_options&&) noexcept = delete;
+	~image_encode_options() = default;
+
+	[[nodiscard]] const todds::dds::encode_options& get() const noexcept { return _options; }
+
+private:
+	std::unique_ptr<todds::dds::block_cache> _image_cache;
+	todds::dds::encode_options _options;
+};
+
 } // Anonymous namespace
 
 namespace todds::pipeline::impl {
 
-class encode_bc1_image final {
+// Encodes images with any format, sending small images through the small texture lane when it is enabled.
+class dds_encoder final {
 public:
-	encode_bc1_image(vector<file_data>& files_data, const format::quality quality, const bool alpha_black) noexcept
+	dds_encoder(vector<file_data>& files_data, const format::quality quality, const bool alpha_black,
+		const encode_settings& settings) noexcept
 		: _files_data{files_data}
+		, _params{dds::bc7_encode_params(quality)}
 		, _quality{quality}
-		, _alpha_black{alpha_black} {}
+		, _alpha_black{alpha_black}
+		, _settings{settings} {}
+
+	vector<dds_data> operator()(pixel_block_data pixel_data, const format::type format) const {
+		vector<dds_data> result;
+		if (pixel_data.file_index == error_file_index) [[unlikely]] { return result; }
 
-	dds_data operator()(const pixel_block_data& pixel_data) const {
-		if (pixel_data.file_index == error_file_index) [[unlikely]] { return {{}, error_file_index}; }
-		_files_data[pixel_data.file_index].format = format::type::bc1;
-		return create_dds_data(dds::bc1_encode(_quality, _alpha_black, pixel_data.image), pixel_data.file_index);
+		_files_data[pixel_data.file_index].format = format;
+		small_texture_lane* lane = _settings.small_textures;
+		if (lane != nullptr && small_texture_lane::accepts(pixel_data.image)) {
+			vector<pixel_block_data> images = lane->add(format, std::move(pixel_data));
+			if (!images.empty()) { encode_batch(format, images, result); }
+		} else {
+			const image_encode_options options{_settings};
+			result.emplace_back(create_dds_data(encode(format, pixel_data.image, options.get()), pixel_data.file_index));
+			if (_settings.keep_source) { result.back().source = std::move(pixel_data.image); }
+		}
+		return result;
 	}
 
-private:
-	vector<file_data>& _files_data;
-	format::quality _quality;
-	bool _alpha_black;
-};
+	// Encodes the pixel blocks of every image with a single call and splits the result into one DDS image per file.
+	void encode_batch(const format::type format, vector<pixel_block_data>& images, vector<dds_data>& result) const {
+		std::size_t pixels = 0U;
+		for (const auto& image : images) { pixels += image.image.size(); }
+		pixel_block_image blocks;
+		blocks.reserve(pixels);
+		for (const auto& image : images) { blocks.insert(blocks.end(), image.image.cbegin(), image.image.cend()); }
 
-class encode_bc3_image final {
-public:
-	encode_bc3_image(vector<file_data>& files_data, const format::quality quality) noexcept
-		: _files_data{files_data}
-		, _quality{quality} {}
+		const image_encode_options options{_settings};
+		const dds_image encoded = encode(format, blocks, options.get());
+		const std::size_t block_size = encoded.size() / (pixels / pixels_per_block);
 
-	dds_data operator()(const pixel_block_data& pixel_data) const {
-		if (pixel_data.file_index == error_file_index) [[unlikely]] { return {{}, error_file_index}; }
-		_files_data[pixel_data.file_index].format = format::type::bc3;
-		return create_dds_data(dds::bc3_encode(_quality, pixel_data.image), pixel_data.file_index);
+		auto current = encoded.cbegin();
+		for (auto& image : images) {
+			const auto end = current + static_cast<std::ptrdiff_t>(image.image.size() / pixels_per_block * block_size);
+			result.emplace_back(create_dds_data(dds_image(current, end), image.file_index));
+			if (_settings.keep_source) { result.back().source = std::move(image.image); }
+			current = end;
+		}
 	}
 
 private:
+	[[nodiscard]] dds_image encode(
+		const format::type format, const pixel_block_image& image, const dds::encode_options& options) const {
+		switch (format) {
+		case format::type::bc1: return dds::bc1_encode(_quality, _alpha_black, image, options);
+		case format::type::bc3: return dds::bc3_encode(_quality, image, options);
+		case format::type::bc4: return dds::bc4_encode(image, options);
+		case format::type::bc5: return dds::bc5_encode(image, options);
+		case format::type::bc7: return dds::bc7_encode(_params, image, options);
+		case format::type::png:
+		case format::type::invalid: break;
+		}
+		assert(false);
+		return {};
+	}
+
 	vector<file_data>& _files_data;
+	dds::bc7_params _params;
 	format::quality _quality;
+	bool _alpha_black;
+	encode_settings _settings;
 };
 
-class encode_bc7_image final {
+class encode_image final {
 public:
-	encode_bc7_image(vector<file_data>& files_data, format::quality quality) noexcept
-		: _files_data{files_data}
-		, _params{dds::bc7_encode_params(quality)} {}
+	encode_image(const dds_encoder& encoder, const format::type format) noexcept
+		: _encoder{encoder}
+		, _format{format} {}
 
-	dds_data operator()(const pixel_block_data& pixel_data) const {
-		if (pixel_data.file_index == error_file_index) [[unlikely]] { return {{}, error_file_index}; }
-		_files_data[pixel_data.file_index].format = format::type::bc7;
-		return create_dds_data(dds::bc7_encode(_params, pixel_data.image), pixel_data.file_index);
-	}
+	vector<dds_data> operator()(pixel_block_data pixel_data) const { return _encoder(std::move(pixel_data), _format); }
 
 private:
-	vector<file_data>& _files_data;
-	dds::bc7_params _params;
+	dds_encoder _encoder;
+	format::type _format;
 };
 
-class encode_alpha_format_image final {
+// Chooses the format of each image depending on its contents.
+class encode_detected_format_image final {
 public:
-	explicit encode_alpha_format_image(vector<file_data>& files_data, const format::type format,
-		const format::type alpha_format, const format::quality quality, const bool alpha_black) noexcept
+	encode_detected_format_image(vector<file_data>& files_data, const dds_encoder& encoder, const format::type format,
+		const format::type alpha_format, const format::type grayscale_format) noexcept
 		: _files_data{files_data}
+		, _encoder{encoder}
 		, _format{format}
 		, _alpha_format{alpha_format}
-		, _params{dds::bc7_encode_params(quality)}
-		, _quality{quality}
-		, _alpha_black{alpha_black} {
-		assert(_alpha_format != format::type::invalid);
+		, _grayscale_format{grayscale_format} {
+		assert(_alpha_format != format::type::invalid || _grayscale_format != format::type::invalid);
 	}
 
-	dds_data operator()(const pixel_block_data& pixel_data) const {
-		if (pixel_data.file_index == error_file_index) [[unlikely]] { return {{}, error_file_index}; }
-		const auto format = has_alpha(pixel_data.image) ? _alpha_format : _format;
-		_files_data[pixel_data.file_index].format = format;
-
-		vector<std::uint64_t> image_data;
-		switch (format) {
-		case format::type::bc1: image_data = dds::bc1_encode(_quality, _alpha_black, pixel_data.image); break;
-		case format::type::bc3: image_data = dds::bc3_encode(_quality, pixel_data.image); break;
-		case format::type::bc7: image_data = dds::bc7_encode(_params, pixel_data.image); break;
-		case format::type::png:
-		case format::type::invalid: assert(false); break;
+	vector<dds_data> operator()(pixel_block_data pixel_data) const {
+		auto format = _format;
+		if (pixel_data.file_index != error_file_index) [[likely]] {
+			alpha_type& alpha = _files_data[pixel_data.file_index].alpha;
+			if (_alpha_format != format::type::invalid) {
+				alpha = has_alpha(pixel_data.image) ? alpha_type::transparent : alpha_type::opaque;
+			}
+			if (alpha == alpha_type::transparent) {
+				format = _alpha_format;
+			} else if (_grayscale_format != format::type::invalid && is_grayscale(pixel_data.image)) {
+				// Grayscale images are always opaque.
+				alpha = alpha_type::opaque;
+				format = _grayscale_format;
+			}
 		}
-
-		return create_dds_data(image_data, pixel_data.file_index);
+		return _encoder(std::move(pixel_data), format);
 	}
 
 private:
 	vector<file_data>& _files_data;
+	dds_encoder _encoder;
 	format::type _format;
 	format::type _alpha_format;
-	dds::bc7_params _params;
-	format::quality _quality;
-	bool _alpha_black;
+	format::type _grayscale_format;
 };
 
-oneapi::tbb::filter<pixel_block_data, dds_data> encode_dds_filter(vector<file_data>& files_data, format::type format,
-	format::type alpha_format, const format::quality quality, const bool alpha_black) {
-	using oneapi::tbb::filter_mode;
-	using oneapi::tbb::make_filter;
+// Encodes every batch left in the small texture lane into a single token. Each batch uses nested parallelism.
+class encode_pending_batches final {
+public:
+	encode_pending_batches(const dds_encoder& encoder, small_texture_lane& lane) noexcept
+		: _encoder{encoder}
+		, _lane{lane} {}
 
-	if (alpha_format != format::type::invalid) {
-		return make_filter<pixel_block_data, dds_data>(
-			filter_mode::parallel, encode_alpha_format_image{files_data, format, alpha_format, quality, alpha_black});
+	vector<dds_data> operator()(oneapi::tbb::flow_control& flow) const {
+		vector<dds_data> result;
+		for (auto batches = _lane.take_pending(); !batches.empty(); batches.pop_back()) {
+			_encoder.encode_batch(batches.back().format, batches.back().images, result);
+		}
+		if (result.empty()) { flow.stop(); }
+		return result;
 	}
 
-	switch (format) {
-	case format::type::bc1:
-		return make_filter<pixel_block_data, dds_data>(
-			filter_mode::parallel, encode_bc1_image{files_data, quality, alpha_black});
-	case format::type::bc3:
-		return make_filter<pixel_block_data, dds_data>(filter_mode::parallel, encode_bc3_image{files_data, quality});
-	case format::type::bc7:
-		return make_filter<pixel_block_data, dds_data>(filter_mode::parallel, encode_bc7_image{files_data, quality});
-	case format::type::png:
-	case format::type::invalid: break;
+private:
+	dds_encoder _encoder;
+	small_texture_lane& _lane;
+};
+
+oneapi::tbb::filter<pixel_block_data, vector<dds_data>> encode_dds_filter(vector<file_data>& files_data,
+	format::type format, format::type alpha_format, format::type grayscale_format, const format::quality quality,
+	const bool alpha_black, const encode_settings& settings, pipeline_statistics* stats) {
+
+	assert(format != format::type::png && format != format::type::invalid);
+	const dds_encoder encoder{files_data, quality, alpha_black, settings};
+	if (alpha_format != format::type::invalid || grayscale_format != format::type::invalid) {
+		return make_timed_filter<pixel_block_data, vector<dds_data>>(stats, stage::encode_dds,
+			encode_detected_format_image{files_data, encoder, format, alpha_format, grayscale_format});
 	}
 
-	assert(false);
-	return {};
+	return make_timed_filter<pixel_block_data, vector<dds_data>>(stats, stage::encode_dds, encode_image{encoder, format});
+}
+
+oneapi::tbb::filter<void, vector<dds_data>> encode_pending_small_textures_filter(vector<file_data>& files_data,
+	const format::quality quality, const bool alpha_black, const encode_settings& settings) {
+	assert(settings.small_textures != nullptr);
+	const dds_encoder encoder{files_data, quality, alpha_black, settings};
+	return oneapi::tbb::make_filter<void, vector<dds_data>>(
+		oneapi::tbb::filter_mode::serial_in_order, encode_pending_batches{encoder, *settings.small_textures});
 }
 
 } // namespace todds::pipeline::impl
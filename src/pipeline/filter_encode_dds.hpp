@@ -5,19 +5,78 @@
 
 #pragma once
 
+#include "todds/block_cache.hpp"
+#include "todds/cache.hpp"
+#include "todds/dds.hpp"
 #include "todds/image_types.hpp"
 
 #include <oneapi/tbb/parallel_pipeline.h>
 
+#include <atomic>
+
 #include "filter_pixel_blocks.hpp"
+#include "small_texture_lane.hpp"
 
 namespace todds::pipeline::impl {
 
 struct dds_data {
 	dds_image image;
 	std::size_t file_index;
+	/** Source pixels of the image. Only kept when measuring the quality of encoded images. */
+	pixel_block_image source{};
+	/** CRC-32 checksum of the DDS file. Only calculated when writing a pack file. */
+	std::uint32_t checksum{};
+};
+
+/** Optional encoder features applied during the encoding DDS stage. */
+struct encode_settings {
+	/** Scope of the caches reusing the encoded data of identical pixel blocks. */
+	cache::scope cache_scope{};
+	/** Maximum memory in bytes used by each cache. */
+	std::size_t cache_memory{};
+	/** Cache shared by every image. Only used with cache::scope::batch. */
+	dds::block_cache* batch_cache{};
+	/** Hit-rate counters shared by every cache. */
+	dds::block_cache_statistics* cache_statistics{};
+	/** Emit canonical blocks for fully transparent blocks in formats supporting alpha. */
+	bool transparent_blocks{};
+	/** Blocks with a complexity below this threshold use low_complexity_quality. Disabled if it is zero. */
+	float complexity_threshold{};
+	/** Quality level used for low complexity blocks. */
+	format::quality low_complexity_quality{};
+	/** Number of blocks encoded with each quality level. */
+	dds::adaptive_statistics* adaptive_stats{};
+	/** Chooses between inter-file and intra-file parallelism for each image. */
+	dds::encode_scheduler* scheduler{};
+	/** Rate-distortion optimization lambda for BC1 and BC7. Disabled if it is zero. */
+	float rdo_lambda{};
+	/** Results of rate-distortion optimization. */
+	dds::rdo_statistics* rdo_stats{};
+	/** Measure the compressed size of images before and after rate-distortion optimization. */
+	bool rdo_measure_size{};
+	/** Regions encoded by the fast pass with a PSNR below this value are encoded again. Disabled if it is zero. */
+	double refine_psnr{};
+	/** Quality level of the first pass of two-tier encoding. */
+	format::quality fast_pass_quality{};
+	/** Results of two-tier encoding. */
+	dds::refine_statistics* refine_stats{};
+	/** Batches small images encoded with the same format. Disabled if it is null. */
+	small_texture_lane* small_textures{};
+	/** Keep the source pixels of each image in its DDS data. */
+	bool keep_source{};
+	/** Encoding stops once it is set. Images are always encoded completely if it is null. */
+	const std::atomic<bool>* force_finish{};
 };
 
-oneapi::tbb::filter<pixel_block_data, dds_data> encode_dds_filter(todds::vector<file_data>& files_data,
-	todds::format::type format, todds::format::type alpha_format, todds::format::quality quality, bool alpha_black);
+oneapi::tbb::filter<pixel_block_data, vector<dds_data>> encode_dds_filter(todds::vector<file_data>& files_data,
+	todds::format::type format, todds::format::type alpha_format, todds::format::type grayscale_format,
+	todds::format::quality quality, bool alpha_black, const encode_settings& settings,
+	pipeline_statistics* stats);
+
+/**
+ * Encodes the small images left in the lane of the settings once every file has gone through the encoding stage.
+ * Batches are only encoded as they fill up, so the last ones are pending until the input is exhausted.
+ */
+oneapi::tbb::filter<void, vector<dds_data>> encode_pending_small_textures_filter(todds::vector<file_data>& files_data,
+	todds::format::quality quality, bool alpha_black, const encode_settings& settings);
 } // namespace todds::pipeline::impl
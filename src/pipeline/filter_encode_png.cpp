@@ -10,47 +10,51 @@
 
 #include <fmt/format.h>
 
+#include "file_report.hpp"
 #include "filter_common.hpp"
+#include "stage_statistics.hpp"
 
 namespace todds::pipeline::impl {
 
 class encode_png_image final {
 public:
-	explicit encode_png_image(const paths_vector& paths, report_queue& updates)
+	explicit encode_png_image(const paths_vector& paths, report_queue& updates, file_report* report)
 		: _paths{paths}
-		, _updates{updates} {}
+		, _updates{updates}
+		, _report{report} {}
 
 	png_data operator()(std::unique_ptr<mipmap_image> input) const {
 		TracyZoneScopedN("encode_png");
-		if (input == nullptr || input->file_index() == error_file_index) [[unlikely]] {
-			png_data error{};
-			error.file_index = error_file_index;
-			return error;
-		}
+		png_data error{};
+		error.file_index = error_file_index;
+		if (input == nullptr || input->file_index() == error_file_index) [[unlikely]] { return error; }
 
-		TracyZoneFileIndex(input->file_index());
-		const string& path = _paths[input->file_index()].first.string();
+		const std::size_t file_index = input->file_index();
+		TracyZoneFileIndex(file_index);
+		const string& path = _paths[file_index].first.string();
 		try {
 			png_data result;
-			result.file_index = input->file_index();
+			result.file_index = file_index;
 			result.image = png::encode(path, std::move(input));
 			return result;
 		} catch (const std::runtime_error& exc) {
-			_updates.emplace(report_type::pipeline_error, fmt::format("PNG Encoding error {:s} -> {:s}", path, exc.what()));
+			report_file_error(
+				_updates, _report, file_index, fmt::format("PNG Encoding error {:s} -> {:s}", path, exc.what()));
 		}
 
-		return {};
+		return error;
 	}
 
 private:
 	const paths_vector& _paths;
 	report_queue& _updates;
+	file_report* _report;
 };
 
 oneapi::tbb::filter<std::unique_ptr<mipmap_image>, png_data> encode_png_filter(
-	const paths_vector& paths, report_queue& updates) {
-	return make_filter<std::unique_ptr<mipmap_image>, png_data>(
-		tbb::filter_mode::parallel, encode_png_image{paths, updates});
+	const paths_vector& paths, report_queue& updates, file_report* report, pipeline_statistics* stats) {
+	return make_timed_filter<std::unique_ptr<mipmap_image>, png_data>(
+		stats, stage::encode_png, encode_png_image{paths, updates, report});
 }
 
 } // namespace todds::pipeline::impl
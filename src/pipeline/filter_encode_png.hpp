@@ -16,11 +16,11 @@
 namespace todds::pipeline::impl {
 
 struct png_data {
-	vector<std::uint8_t> image{};
+	buffer_pool::vector<std::uint8_t> image{};
 	std::size_t file_index{};
 };
 
 oneapi::tbb::filter<std::unique_ptr<mipmap_image>, png_data> encode_png_filter(
-	const paths_vector& paths, report_queue& updates);
+	const paths_vector& paths, report_queue& updates, file_report* report, pipeline_statistics* stats);
 
 } // namespace todds::pipeline::impl
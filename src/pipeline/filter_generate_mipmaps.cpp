@@ -11,18 +11,26 @@
 
 #include <opencv2/imgproc.hpp>
 
+#include <atomic>
+
 #if defined(TODDS_PIPELINE_DUMP)
 #include <boost/dll/runtime_symbol_info.hpp>
 #include <boost/nowide/fstream.hpp>
 #endif // defined(TODDS_PIPELINE_DUMP)
 
+#include "stage_statistics.hpp"
+
 namespace {
 
-void process_image(todds::mipmap_image& mipmap_img, todds::filter::type filter, double blur) {
+void process_image(todds::mipmap_image& mipmap_img, todds::filter::type filter, double blur,
+	const std::atomic<bool>* force_finish) {
 	// Used to store images with gaussian blur applied.
 	todds::mipmap_image mipmap_blur(mipmap_img);
 
 	for (std::size_t mipmap_index = 1UL; mipmap_index < mipmap_img.mipmap_count(); ++mipmap_index) {
+		// The image will be discarded if the pipeline has been cancelled.
+		if (force_finish != nullptr && force_finish->load(std::memory_order_relaxed)) [[unlikely]] { return; }
+
 		// Calculate gaussian blur of the previous stage.
 		auto& input_current = mipmap_img.get_image(mipmap_index - 1UL);
 		auto& blur_current = mipmap_blur.get_image(mipmap_index - 1UL);
@@ -42,15 +50,16 @@ namespace todds::pipeline::impl {
 
 class generate_mipmaps final {
 public:
-	explicit generate_mipmaps(filter::type filter, double blur) noexcept
+	explicit generate_mipmaps(filter::type filter, double blur, const std::atomic<bool>* force_finish) noexcept
 		: _filter{filter}
-		, _blur{blur} {}
+		, _blur{blur}
+		, _force_finish{force_finish} {}
 
 	std::unique_ptr<mipmap_image> operator()(std::unique_ptr<mipmap_image> img) const {
 		TracyZoneScopedN("mipmap");
 		if (img != nullptr) [[likely]] {
 			TracyZoneFileIndex(img->file_index());
-			process_image(*img, _filter, _blur);
+			process_image(*img, _filter, _blur, _force_finish);
 
 #if defined(TODDS_PIPELINE_DUMP)
 			const auto dmp_path = boost::dll::program_location().parent_path() / "generate_mipmaps.dmp";
@@ -65,12 +74,13 @@ public:
 private:
 	filter::type _filter;
 	double _blur;
+	const std::atomic<bool>* _force_finish;
 };
 
 oneapi::tbb::filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>> generate_mipmaps_filter(
-	filter::type filter, double blur) {
-	return oneapi::tbb::make_filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>>(
-		oneapi::tbb::filter_mode::parallel, generate_mipmaps(filter, blur));
+	filter::type filter, double blur, const std::atomic<bool>* force_finish, pipeline_statistics* stats) {
+	return make_timed_filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>>(
+		stats, stage::generate_mipmaps, generate_mipmaps(filter, blur, force_finish));
 }
 
 } // namespace todds::pipeline::impl
@@ -7,10 +7,20 @@
 
 #include "todds/mipmap_image.hpp"
 
+#include <atomic>
+
 #include "filter_common.hpp"
 #include "filter_decode_png.hpp"
 
 namespace todds::pipeline::impl {
+/**
+ * Generates every mipmap level of each image.
+ * @param filter Filter used to resize each level.
+ * @param blur Gaussian blur applied before resizing each level.
+ * @param force_finish Mipmaps stop being generated once it is set. Ignored if it is nullptr.
+ * @param stats Statistics of the pipeline. Statistics are not recorded if this is nullptr.
+ * @return Filter generating mipmaps.
+ */
 oneapi::tbb::filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>> generate_mipmaps_filter(
-	filter::type filter, double blur);
+	filter::type filter, double blur, const std::atomic<bool>* force_finish, pipeline_statistics* stats);
 } // namespace todds::pipeline::impl
@@ -10,28 +10,40 @@
 #include <boost/nowide/fstream.hpp>
 #include <boost/predef.h>
 #include <fmt/format.h>
+#include <oneapi/tbb/task.h>
 
 #if defined(TODDS_PIPELINE_DUMP)
 #include <boost/dll/runtime_symbol_info.hpp>
 #endif // defined(TODDS_PIPELINE_DUMP)
 
+#include "file_report.hpp"
+#include "stage_statistics.hpp"
+
 namespace todds::pipeline::impl {
 
 class load_png_file final {
 public:
 	explicit load_png_file(const paths_vector& paths, std::atomic<std::size_t>& counter, std::atomic<bool>& force_finish,
-		report_queue& updates) noexcept
+		report_queue& updates, file_report* report) noexcept
 		: _paths{paths}
 		, _counter{counter}
 		, _force_finish{force_finish}
-		, _updates{updates} {}
+		, _updates{updates}
+		, _report{report} {}
 
 	png_file operator()(oneapi::tbb::flow_control& flow) const {
 		const std::size_t index = _counter++;
 		TracyZoneScopedN("load");
 		TracyZoneFileIndex(index);
 
-		if (index >= _paths.size() || _force_finish) [[unlikely]] {
+		if (index >= _paths.size()) [[unlikely]] {
+			flow.stop();
+			return {};
+		}
+		if (_force_finish) [[unlikely]] {
+			// Images still being processed are discarded instead of waiting for them to reach the last filter. Nested
+			// parallel loops of the pipeline are cancelled as well.
+			oneapi::tbb::task::current_context()->cancel_group_execution();
 			flow.stop();
 			return {};
 		}
@@ -48,10 +60,21 @@ public:
 				report_type::pipeline_error, fmt::format("Load PNG file error in {:s}", _paths[index].first.string()));
 		}
 
-		png_file result{{std::istreambuf_iterator<char>{ifs}, {}}, index};
+		// Read the whole file with a single call into a buffer of its size, which is usually recycled from a previous file.
+		png_file result{{}, index};
+		if (ifs.is_open()) [[likely]] {
+			ifs.seekg(0, std::ios::end);
+			const std::streamoff file_size = ifs.tellg();
+			ifs.seekg(0, std::ios::beg);
+			if (file_size > 0) {
+				result.buffer.resize(static_cast<std::size_t>(file_size));
+				ifs.read(reinterpret_cast<char*>(result.buffer.data()), file_size);
+				result.buffer.resize(static_cast<std::size_t>(ifs.gcount()));
+			}
+		}
 
 		if (result.buffer.empty()) [[unlikely]] {
-			_updates.emplace(report_type::pipeline_error,
+			report_file_error(_updates, _report, index,
 				fmt::format("Could not load any data for PNG file {:s}", _paths[index].first.string()));
 		}
 #if defined(TODDS_PIPELINE_DUMP)
@@ -71,11 +94,12 @@ private:
 	std::atomic<std::size_t>& _counter;
 	std::atomic<bool>& _force_finish;
 	report_queue& _updates;
+	file_report* _report;
 };
 
 oneapi::tbb::filter<void, png_file> load_png_filter(const paths_vector& paths, std::atomic<std::size_t>& counter,
-	std::atomic<bool>& force_finish, report_queue& updates) {
-	return oneapi::tbb::make_filter<void, png_file>(
-		oneapi::tbb::filter_mode::parallel, load_png_file(paths, counter, force_finish, updates));
+	std::atomic<bool>& force_finish, report_queue& updates, file_report* report, pipeline_statistics* stats) {
+	return make_timed_filter<void, png_file>(
+		stats, stage::load_png, load_png_file(paths, counter, force_finish, updates, report));
 }
 } // namespace todds::pipeline::impl
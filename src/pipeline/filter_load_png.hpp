@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "todds/buffer_pool.hpp"
 #include "todds/input.hpp"
 #include "todds/vector.hpp"
 
@@ -18,11 +19,12 @@
 namespace todds::pipeline::impl {
 
 struct png_file {
-	vector<std::uint8_t> buffer;
+	buffer_pool::vector<std::uint8_t> buffer;
 	std::size_t file_index;
 };
 
 oneapi::tbb::filter<void, png_file> load_png_filter(
-	const paths_vector& paths, std::atomic<std::size_t>& counter, std::atomic<bool>& force_finish, report_queue& updates);
+	const paths_vector& paths, std::atomic<std::size_t>& counter, std::atomic<bool>& force_finish, report_queue& updates,
+	file_report* report, pipeline_statistics* stats);
 
 } // namespace todds::pipeline::impl
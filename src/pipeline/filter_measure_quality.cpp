@@ -0,0 +1,44 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "filter_measure_quality.hpp"
+
+#include "todds/dds.hpp"
+#include "todds/profiler.hpp"
+
+#include "stage_statistics.hpp"
+
+namespace todds::pipeline::impl {
+
+class measure_dds_quality final {
+public:
+	explicit measure_dds_quality(vector<file_data>& files_data) noexcept
+		: _files_data{files_data} {}
+
+	vector<dds_data> operator()(vector<dds_data> dds_images) const {
+		for (auto& dds_img : dds_images) {
+			if (dds_img.source.empty()) [[unlikely]] { continue; }
+			TracyZoneScopedN("measure");
+			TracyZoneFileIndex(dds_img.file_index);
+			file_data& data = _files_data[dds_img.file_index];
+			data.quality =
+				dds::measure_quality(data.format, data.width, data.height, data.mipmaps, dds_img.source, dds_img.image);
+			// Release the source pixels before the save stage.
+			dds_img.source = {};
+		}
+		return dds_images;
+	}
+
+private:
+	vector<file_data>& _files_data;
+};
+
+oneapi::tbb::filter<vector<dds_data>, vector<dds_data>> measure_quality_filter(
+	vector<file_data>& files_data, pipeline_statistics* stats) {
+	return make_timed_filter<vector<dds_data>, vector<dds_data>>(
+		stats, stage::measure_quality, measure_dds_quality(files_data));
+}
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,18 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <oneapi/tbb/parallel_pipeline.h>
+
+#include "filter_common.hpp"
+#include "filter_encode_dds.hpp"
+
+namespace todds::pipeline::impl {
+
+oneapi::tbb::filter<vector<dds_data>, vector<dds_data>> measure_quality_filter(
+	vector<file_data>& files_data, pipeline_statistics* stats);
+
+} // namespace todds::pipeline::impl
@@ -12,6 +12,8 @@
 #include <boost/nowide/fstream.hpp>
 #endif // defined(TODDS_PIPELINE_DUMP)
 
+#include "stage_statistics.hpp"
+
 namespace todds::pipeline::impl {
 class get_pixel_blocks final {
 public:
@@ -32,9 +34,9 @@ public:
 	}
 };
 
-oneapi::tbb::filter<std::unique_ptr<mipmap_image>, pixel_block_data> pixel_blocks_filter() {
-	return oneapi::tbb::make_filter<std::unique_ptr<mipmap_image>, pixel_block_data>(
-		oneapi::tbb::filter_mode::parallel, get_pixel_blocks{});
+oneapi::tbb::filter<std::unique_ptr<mipmap_image>, pixel_block_data> pixel_blocks_filter(pipeline_statistics* stats) {
+	return make_timed_filter<std::unique_ptr<mipmap_image>, pixel_block_data>(
+		stats, stage::pixel_blocks, get_pixel_blocks{});
 }
 
 } // namespace todds::pipeline::impl
@@ -8,30 +8,67 @@
 #include "todds/dds.hpp"
 #include "todds/profiler.hpp"
 
-#include <boost/nowide/fstream.hpp>
 #include <boost/predef.h>
-#include <dds_defs.h>
+#include <fmt/format.h>
 
+#include <algorithm>
+#include <string_view>
+
+#include "file_report.hpp"
 #include "filter_pixel_blocks.hpp"
+#include "output_file.hpp"
+#include "stage_statistics.hpp"
 
 namespace todds::pipeline::impl {
 
-// Header extension for BC7 files.
-constexpr DDS_HEADER_DXT10 header_extension{DXGI_FORMAT_BC7_UNORM, D3D10_RESOURCE_DIMENSION_TEXTURE2D, 0U, 1U, 0U};
+dds_file_header::dds_file_header(const file_data& data)
+	: _data{}
+	, _size{} {
+	constexpr std::string_view magic{"DDS "};
+	auto output = std::copy(magic.cbegin(), magic.cend(), _data.begin());
+	const auto header = dds::dds_header(data.format, data.width, data.height, data.mipmaps);
+	output = std::copy(header.cbegin(), header.cend(), output);
+	if (dds::has_header_extension(data.format)) {
+		const auto extension = dds::dds_header_extension(data.format);
+		output = std::copy(extension.cbegin(), extension.cend(), output);
+	}
+	_size = static_cast<std::size_t>(output - _data.begin());
+}
+
+std::span<const char> dds_file_header::data() const noexcept { return {_data.data(), _size}; }
+
+namespace {
+
+std::span<const char> image_bytes(const dds_data& dds_img) noexcept {
+	return {reinterpret_cast<const char*>(dds_img.image.data()), dds_img.image.size() * sizeof(std::uint64_t)};
+}
+
+} // Anonymous namespace
 
 class save_dds_file final {
 public:
-	explicit save_dds_file(const vector<file_data>& files_data, const paths_vector& paths, report_queue& updates) noexcept
+	explicit save_dds_file(vector<file_data>& files_data, const paths_vector& paths,
+		const std::atomic<bool>& force_finish, report_queue& updates, file_report* report,
+		std::atomic<std::size_t>* skipped_writes) noexcept
 		: _files_data{files_data}
 		, _paths{paths}
-		, _updates{updates} {}
+		, _force_finish{force_finish}
+		, _updates{updates}
+		, _report{report}
+		, _skipped_writes{skipped_writes} {}
+
+	void operator()(const vector<dds_data>& dds_images) const {
+		for (const auto& dds_img : dds_images) { save(dds_img); }
+	}
 
-	void operator()(const dds_data& dds_img) const {
+private:
+	void save(const dds_data& dds_img) const {
 		TracyZoneScopedN("save");
 		const std::size_t file_index = dds_img.file_index;
 		TracyZoneFileIndex(file_index);
 
-		if (file_index == error_file_index) [[unlikely]] { return; }
+		// Images encoded after cancelling the pipeline may be incomplete.
+		if (file_index == error_file_index || _force_finish) [[unlikely]] { return; }
 
 #if BOOST_OS_WINDOWS
 		const boost::filesystem::path output{R"(\\?\)" + _paths[file_index].second.string()};
@@ -39,32 +76,127 @@ public:
 		const boost::filesystem::path& output{_paths[file_index].second.string()};
 #endif
 
-		boost::nowide::ofstream ofs{output, std::ios::out | std::ios::binary};
-
-		ofs << "DDS ";
-		const auto& file_data = _files_data[file_index];
-		const auto header = dds::dds_header(file_data.format, file_data.width, file_data.height, file_data.mipmaps);
-		ofs.write(header.data(), header.size());
-		if (file_data.format == format::type::bc7) {
-			ofs.write(reinterpret_cast<const char*>(&header_extension), sizeof(header_extension));
+		const dds_file_header header{_files_data[file_index]};
+		const std::span<const char> image = image_bytes(dds_img);
+		if (_skipped_writes != nullptr && has_contents(output, {header.data(), image})) {
+			// Identical files are left untouched, keeping their modification time.
+			_skipped_writes->fetch_add(1U, std::memory_order_relaxed);
+		} else {
+			output_file file{output};
+			file.write(header.data());
+			file.write(image);
+			if (!file.commit()) [[unlikely]] {
+				report_file_error(_updates, _report, file_index,
+					fmt::format("Could not write DDS file {:s}", _paths[file_index].second.string()));
+				return;
+			}
 		}
-
-		const std::size_t block_size_bytes = dds_img.image.size() * sizeof(std::uint64_t);
-		ofs.write(reinterpret_cast<const char*>(dds_img.image.data()), static_cast<std::ptrdiff_t>(block_size_bytes));
-		ofs.close();
+		_files_data[file_index].output_bytes = header.data().size() + image.size();
 		_updates.emplace(report_type::encoding_progress);
 	}
 
+	vector<file_data>& _files_data;
+	const paths_vector& _paths;
+	const std::atomic<bool>& _force_finish;
+	report_queue& _updates;
+	file_report* _report;
+	std::atomic<std::size_t>* _skipped_writes;
+};
+
+// Calculates the checksum of each DDS file before writing them.
+class checksum_dds_file final {
+public:
+	explicit checksum_dds_file(const vector<file_data>& files_data) noexcept
+		: _files_data{files_data} {}
+
+	vector<dds_data> operator()(vector<dds_data> dds_images) const {
+		for (auto& dds_img : dds_images) {
+			if (dds_img.file_index == error_file_index) [[unlikely]] { continue; }
+			const dds_file_header header{_files_data[dds_img.file_index]};
+			dds_img.checksum = pack_writer::checksum({header.data(), image_bytes(dds_img)});
+		}
+		return dds_images;
+	}
+
 private:
 	const vector<file_data>& _files_data;
+};
+
+// Writes every DDS file into a pack file as soon as it is encoded. The index of the pack follows the input order.
+class save_pack_file final {
+public:
+	explicit save_pack_file(vector<file_data>& files_data, const paths_vector& paths, pack_writer& pack,
+		boost::filesystem::path pack_directory, const std::atomic<bool>& force_finish, report_queue& updates,
+		file_report* report) noexcept
+		: _files_data{files_data}
+		, _paths{paths}
+		, _pack{pack}
+		, _pack_directory{std::move(pack_directory)}
+		, _force_finish{force_finish}
+		, _updates{updates}
+		, _report{report} {}
+
+	// Filters copy their body, but the references to the state of the pipeline cannot be reassigned.
+	save_pack_file(const save_pack_file&) = default;
+	save_pack_file(save_pack_file&&) noexcept = default;
+	save_pack_file& operator=(const save_pack_file&) = delete;
+	save_pack_file& operator=(save_pack_file&&) noexcept = delete;
+	~save_pack_file() = default;
+
+	void operator()(const vector<dds_data>& dds_images) const {
+		for (const auto& dds_img : dds_images) { save(dds_img); }
+	}
+
+private:
+	void save(const dds_data& dds_img) const {
+		TracyZoneScopedN("pack");
+		const std::size_t file_index = dds_img.file_index;
+		TracyZoneFileIndex(file_index);
+
+		if (file_index == error_file_index || _force_finish) [[unlikely]] { return; }
+
+		// Files inside of the directory of the pack use relative paths.
+		const boost::filesystem::path& output = _paths[file_index].second;
+		const boost::filesystem::path relative = output.lexically_relative(_pack_directory);
+		const bool inside = !relative.empty() && relative.begin()->string() != "..";
+		const string path = (inside ? relative : output).generic_string();
+
+		const dds_file_header header{_files_data[file_index]};
+		const std::span<const char> image = image_bytes(dds_img);
+		if (!_pack.add(file_index, path, dds_img.checksum, {header.data(), image})) [[unlikely]] {
+			report_file_error(_updates, _report, file_index, fmt::format("Could not write {:s} into the pack file", path));
+			return;
+		}
+		_files_data[file_index].output_bytes = header.data().size() + image.size();
+		_updates.emplace(report_type::encoding_progress);
+	}
+
+	vector<file_data>& _files_data;
 	const paths_vector& _paths;
+	pack_writer& _pack;
+	boost::filesystem::path _pack_directory;
+	const std::atomic<bool>& _force_finish;
 	report_queue& _updates;
+	file_report* _report;
 };
 
-oneapi::tbb::filter<dds_data, void> save_dds_filter(
-	const vector<file_data>& files_data, const paths_vector& paths, report_queue& updates) {
-	return oneapi::tbb::make_filter<dds_data, void>(
-		oneapi::tbb::filter_mode::parallel, save_dds_file(files_data, paths, updates));
+oneapi::tbb::filter<vector<dds_data>, void> save_dds_filter(vector<file_data>& files_data, const paths_vector& paths,
+	const std::atomic<bool>& force_finish, report_queue& updates, file_report* report,
+	std::atomic<std::size_t>* skipped_writes, pipeline_statistics* stats) {
+	return make_timed_filter<vector<dds_data>, void>(
+		stats, stage::save_dds, save_dds_file(files_data, paths, force_finish, updates, report, skipped_writes));
+}
+
+oneapi::tbb::filter<vector<dds_data>, void> save_pack_filter(vector<file_data>& files_data,
+	const paths_vector& paths, pack_writer& pack, const boost::filesystem::path& pack_directory,
+	const std::atomic<bool>& force_finish, report_queue& updates, file_report* report, pipeline_statistics* stats) {
+	// Checksums are calculated in parallel, leaving only the writes to the serial filter.
+	const auto checksums = oneapi::tbb::make_filter<vector<dds_data>, vector<dds_data>>(
+		oneapi::tbb::filter_mode::parallel, checksum_dds_file{files_data});
+	const auto writes = make_timed_filter<vector<dds_data>, void>(stats, stage::save_dds,
+		save_pack_file(files_data, paths, pack, pack_directory, force_finish, updates, report),
+		oneapi::tbb::filter_mode::serial_out_of_order);
+	return checksums & writes;
 }
 
 } // namespace todds::pipeline::impl
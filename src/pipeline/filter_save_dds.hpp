@@ -5,14 +5,61 @@
 
 #pragma once
 
+#include <boost/filesystem/path.hpp>
 #include <oneapi/tbb/parallel_pipeline.h>
 
+#include <array>
+#include <atomic>
+#include <span>
+
 #include "filter_common.hpp"
 #include "filter_encode_dds.hpp"
+#include "pack_writer.hpp"
 
 namespace todds::pipeline::impl {
 
-oneapi::tbb::filter<dds_data, void> save_dds_filter(
-	const vector<file_data>& files_data, const paths_vector& paths, report_queue& updates);
+/** Data preceding the encoded image in a DDS file: the DDS magic number, its header and its header extension. */
+class dds_file_header final {
+public:
+	explicit dds_file_header(const file_data& data);
+
+	[[nodiscard]] std::span<const char> data() const noexcept;
+
+private:
+	std::array<char, 148U> _data;
+	std::size_t _size;
+};
+
+/**
+ * Writes each DDS file separately. Files are discarded once the pipeline has been cancelled, as they may be incomplete.
+ * @param files_data Data of each file. The size of each file is set once it has been written.
+ * @param paths Input and output paths of each file.
+ * @param force_finish Set when the pipeline has been cancelled.
+ * @param updates Used to report progress and errors.
+ * @param report Report of each file. Files which could not be written are reported to it if it is not nullptr.
+ * @param skipped_writes If not nullptr, files which already contain the encoded data are not written again, and they
+ * are counted here.
+ * @param stats Statistics of the pipeline. Statistics are not recorded if this is nullptr.
+ * @return Filter saving DDS files.
+ */
+oneapi::tbb::filter<vector<dds_data>, void> save_dds_filter(vector<file_data>& files_data, const paths_vector& paths,
+	const std::atomic<bool>& force_finish, report_queue& updates, file_report* report,
+	std::atomic<std::size_t>* skipped_writes, pipeline_statistics* stats);
+
+/**
+ * Writes DDS files into a pack file instead of creating them separately. The index of the pack is sorted by file index.
+ * @param files_data Data of each file. The size of each file is set once it has been written.
+ * @param paths Input and output paths of each file.
+ * @param pack Pack file receiving the DDS files.
+ * @param pack_directory Output paths inside of this directory are stored as relative paths in the pack file.
+ * @param force_finish Set when the pipeline has been cancelled.
+ * @param updates Used to report progress and errors.
+ * @param report Report of each file. Files which could not be written are reported to it if it is not nullptr.
+ * @param stats Statistics of the pipeline. Statistics are not recorded if this is nullptr.
+ * @return Filter saving DDS files.
+ */
+oneapi::tbb::filter<vector<dds_data>, void> save_pack_filter(vector<file_data>& files_data,
+	const paths_vector& paths, pack_writer& pack, const boost::filesystem::path& pack_directory,
+	const std::atomic<bool>& force_finish, report_queue& updates, file_report* report, pipeline_statistics* stats);
 
 } // namespace todds::pipeline::impl
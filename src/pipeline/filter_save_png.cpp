@@ -7,22 +7,33 @@
 
 #include "todds/profiler.hpp"
 
-#include <boost/nowide/fstream.hpp>
 #include <boost/predef.h>
+#include <fmt/format.h>
 
+#include "file_report.hpp"
 #include "filter_pixel_blocks.hpp"
+#include "output_file.hpp"
+#include "stage_statistics.hpp"
 
 namespace todds::pipeline::impl {
 
 class save_png_file final {
 public:
-	explicit save_png_file(const paths_vector& paths) noexcept
-		: _paths{paths} {}
+	explicit save_png_file(vector<file_data>& files_data, const paths_vector& paths,
+		const std::atomic<bool>& force_finish, report_queue& updates, file_report* report,
+		std::atomic<std::size_t>* skipped_writes) noexcept
+		: _files_data{files_data}
+		, _paths{paths}
+		, _force_finish{force_finish}
+		, _updates{updates}
+		, _report{report}
+		, _skipped_writes{skipped_writes} {}
 
 	void operator()(const png_data& input) const {
 		TracyZoneScopedN("save_png");
 		const std::size_t file_index = input.file_index;
-		if (file_index == error_file_index) [[unlikely]] { return; }
+		// Images encoded after cancelling the pipeline may be incomplete.
+		if (file_index == error_file_index || _force_finish) [[unlikely]] { return; }
 		TracyZoneFileIndex(file_index);
 
 #if BOOST_OS_WINDOWS
@@ -31,19 +42,36 @@ public:
 		const boost::filesystem::path& output_path{_paths[file_index].second.string()};
 #endif
 
-		boost::nowide::ofstream ofs{output_path, std::ios::out | std::ios::binary};
-
-		const auto size = static_cast<std::ptrdiff_t>(input.image.size());
-		ofs.write(reinterpret_cast<const char*>(input.image.data()), size);
-		ofs.close();
+		const std::span<const char> image{reinterpret_cast<const char*>(input.image.data()), input.image.size()};
+		if (_skipped_writes != nullptr && has_contents(output_path, {image})) {
+			// Identical files are left untouched, keeping their modification time.
+			_skipped_writes->fetch_add(1U, std::memory_order_relaxed);
+		} else {
+			output_file file{output_path};
+			file.write(image);
+			if (!file.commit()) [[unlikely]] {
+				report_file_error(_updates, _report, file_index,
+					fmt::format("Could not write PNG file {:s}", _paths[file_index].second.string()));
+				return;
+			}
+		}
+		_files_data[file_index].output_bytes = input.image.size();
 	}
 
 private:
+	vector<file_data>& _files_data;
 	const paths_vector& _paths;
+	const std::atomic<bool>& _force_finish;
+	report_queue& _updates;
+	file_report* _report;
+	std::atomic<std::size_t>* _skipped_writes;
 };
 
-oneapi::tbb::filter<png_data, void> save_png_filter(const paths_vector& paths) {
-	return oneapi::tbb::make_filter<png_data, void>(oneapi::tbb::filter_mode::parallel, save_png_file(paths));
+oneapi::tbb::filter<png_data, void> save_png_filter(vector<file_data>& files_data, const paths_vector& paths,
+	const std::atomic<bool>& force_finish, report_queue& updates, file_report* report,
+	std::atomic<std::size_t>* skipped_writes, pipeline_statistics* stats) {
+	return make_timed_filter<png_data, void>(
+		stats, stage::save_png, save_png_file(files_data, paths, force_finish, updates, report, skipped_writes));
 }
 
 } // namespace todds::pipeline::impl
@@ -10,11 +10,15 @@
 
 #include <oneapi/tbb/parallel_pipeline.h>
 
+#include <atomic>
+
 #include "filter_common.hpp"
 #include "filter_encode_png.hpp"
 
 namespace todds::pipeline::impl {
 
-oneapi::tbb::filter<png_data, void> save_png_filter(const paths_vector& paths);
+oneapi::tbb::filter<png_data, void> save_png_filter(vector<file_data>& files_data, const paths_vector& paths,
+	const std::atomic<bool>& force_finish, report_queue& updates, file_report* report,
+	std::atomic<std::size_t>* skipped_writes, pipeline_statistics* stats);
 
 } // namespace todds::pipeline::impl
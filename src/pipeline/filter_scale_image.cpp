@@ -12,19 +12,23 @@
 #include <fmt/format.h>
 #include <opencv2/imgproc.hpp>
 
+#include "file_report.hpp"
+#include "stage_statistics.hpp"
+
 namespace todds::pipeline::impl {
 
 class scale_image final {
 public:
 	explicit scale_image(vector<file_data>& files_data, bool mipmaps, std::uint16_t scale, std::uint32_t max_size,
-		filter::type filter, const paths_vector& paths, report_queue& updates) noexcept
+		filter::type filter, const paths_vector& paths, report_queue& updates, file_report* report) noexcept
 		: _files_data{files_data}
 		, _mipmaps{mipmaps}
 		, _scale{scale}
 		, _max_size{max_size}
 		, _filter{filter}
 		, _paths{paths}
-		, _updates{updates} {}
+		, _updates{updates}
+		, _report{report} {}
 
 	std::unique_ptr<mipmap_image> operator()(std::unique_ptr<mipmap_image> img) const {
 		TracyZoneScopedN("scale");
@@ -49,7 +53,7 @@ public:
 		}
 
 		if (width == 0 || height == 0) {
-			_updates.emplace(report_type::pipeline_error,
+			report_file_error(_updates, _report, img->file_index(),
 				fmt::format("Could not scale {:s} from ({:d}, {:d}) to ({:d}, {:d}).", _paths[img->file_index()].first.string(),
 					input_image.width(), input_image.height(), width, height));
 			return nullptr;
@@ -81,13 +85,14 @@ private:
 	filter::type _filter;
 	const paths_vector& _paths;
 	report_queue& _updates;
+	file_report* _report;
 };
 
 oneapi::tbb::filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>> scale_image_filter(
 	vector<file_data>& files_data, bool mipmaps, std::uint16_t scale, std::uint32_t max_size, filter::type filter,
-	const paths_vector& paths, report_queue& updates) {
-	return oneapi::tbb::make_filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>>(
-		oneapi::tbb::filter_mode::parallel, scale_image(files_data, mipmaps, scale, max_size, filter, paths, updates));
+	const paths_vector& paths, report_queue& updates, file_report* report, pipeline_statistics* stats) {
+	return make_timed_filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>>(
+		stats, stage::scale_image, scale_image(files_data, mipmaps, scale, max_size, filter, paths, updates, report));
 }
 
 } // namespace todds::pipeline::impl
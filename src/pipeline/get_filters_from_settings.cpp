@@ -12,6 +12,7 @@
 #include "filter_encode_png.hpp"
 #include "filter_generate_mipmaps.hpp"
 #include "filter_load_png.hpp"
+#include "filter_measure_quality.hpp"
 #include "filter_pixel_blocks.hpp"
 #include "filter_save_dds.hpp"
 #include "filter_save_png.hpp"
@@ -21,48 +22,87 @@ namespace todds::pipeline::impl {
 
 inline oneapi::tbb::filter<void, std::unique_ptr<mipmap_image>> png_decoding_filters(const input& input_data,
 	std::atomic<std::size_t>& counter, std::atomic<bool>& force_finish, report_queue& updates,
-	vector<impl::file_data>& files_data) {
+	vector<impl::file_data>& files_data, file_report* report, pipeline_statistics* stats) {
 	// If scale and mipmaps are enabled, space for mipmaps will be allocated by the scale filter.
 	const bool should_allocate_mipmaps = input_data.mipmaps && input_data.scale == 100U;
 	return // Load PNG files from disk into memory.
-		impl::load_png_filter(input_data.paths, counter, force_finish, updates) &
+		impl::load_png_filter(input_data.paths, counter, force_finish, updates, report, stats) &
 		// Decode a PNG file to raw pixels. Fix size and allocate for mipmaps if needed.
-		impl::decode_png_filter(
-			files_data, input_data.paths, input_data.vflip, should_allocate_mipmaps, input_data.fix_size, updates);
+		impl::decode_png_filter(files_data, input_data.paths, input_data.vflip, should_allocate_mipmaps,
+			input_data.fix_size, updates, report, stats);
+}
+
+inline oneapi::tbb::filter<vector<dds_data>, void> dds_saving_filters(const input& input_data,
+	vector<impl::file_data>& files_data, std::atomic<bool>& force_finish, report_queue& updates, pack_writer* pack,
+	file_report* report, std::atomic<std::size_t>* skipped_writes, pipeline_statistics* stats) {
+	oneapi::tbb::filter<vector<dds_data>, void> save_dds;
+	if (pack != nullptr) {
+		// Write every DDS file into a single pack file, indexed in the order of the input.
+		const boost::filesystem::path pack_directory = input_data.pack->parent_path();
+		save_dds = impl::save_pack_filter(
+			files_data, input_data.paths, *pack, pack_directory, force_finish, updates, report, stats);
+	} else {
+		// Save DDS files back into the file system, one by one.
+		save_dds =
+			impl::save_dds_filter(files_data, input_data.paths, force_finish, updates, report, skipped_writes, stats);
+	}
+	// Decode DDS files and compare them with their source pixels.
+	if (input_data.quality_metrics) { return impl::measure_quality_filter(files_data, stats) & save_dds; }
+	return save_dds;
 }
 
 inline oneapi::tbb::filter<std::unique_ptr<mipmap_image>, void> dds_encoding_filters(
-	const input& input_data, vector<impl::file_data>& files_data, report_queue& updates) {
-	return
+	const input& input_data, vector<impl::file_data>& files_data, std::atomic<bool>& force_finish, report_queue& updates,
+	const encode_settings& settings, pack_writer* pack, file_report* report, std::atomic<std::size_t>* skipped_writes,
+	pipeline_statistics* stats) {
+	const auto encode_dds =
 		// Convert images into pixel block images. The pixels of these images are rearranged into 4x4 blocks,
 		// ready for the DDS encoding stage.
-		impl::pixel_blocks_filter() &
+		impl::pixel_blocks_filter(stats) &
 		// Encode pixel block images as DDS files.
-		impl::encode_dds_filter(
-			files_data, input_data.format, input_data.alpha_format, input_data.quality, input_data.alpha_black) &
-		// Save DDS files back into the file system, one by one.
-		impl::save_dds_filter(files_data, input_data.paths, updates);
+		impl::encode_dds_filter(files_data, input_data.format, input_data.alpha_format, input_data.grayscale_format,
+			input_data.quality, input_data.alpha_black, settings, stats);
+	return encode_dds &
+				 dds_saving_filters(input_data, files_data, force_finish, updates, pack, report, skipped_writes, stats);
 }
 
-inline oneapi::tbb::filter<std::unique_ptr<mipmap_image>, void> png_encoding_filters(
-	const input& input_data, report_queue& updates) {
-	return impl::encode_png_filter(input_data.paths, updates) & impl::save_png_filter(input_data.paths);
+inline oneapi::tbb::filter<std::unique_ptr<mipmap_image>, void> png_encoding_filters(const input& input_data,
+	vector<impl::file_data>& files_data, std::atomic<bool>& force_finish, report_queue& updates, file_report* report,
+	std::atomic<std::size_t>* skipped_writes, pipeline_statistics* stats) {
+	return impl::encode_png_filter(input_data.paths, updates, report, stats) &
+				 impl::save_png_filter(files_data, input_data.paths, force_finish, updates, report, skipped_writes, stats);
 }
 
 oneapi::tbb::filter<void, void> get_filters_from_settings(const input& input_data, std::atomic<std::size_t>& counter,
-	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data) {
-	auto prepare_image = png_decoding_filters(input_data, counter, force_finish, updates, files_data);
+	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data,
+	const encode_settings& settings, pack_writer* pack, file_report* report, std::atomic<std::size_t>* skipped_writes,
+	pipeline_statistics* stats) {
+	auto prepare_image = png_decoding_filters(input_data, counter, force_finish, updates, files_data, report, stats);
 	if (input_data.scale != 100U || input_data.max_size > 0U) {
 		prepare_image &= impl::scale_image_filter(files_data, input_data.mipmaps, input_data.scale, input_data.max_size,
-			input_data.scale_filter, input_data.paths, updates);
+			input_data.scale_filter, input_data.paths, updates, report, stats);
 	}
 
-	if (input_data.format == format::type::png) { return prepare_image & png_encoding_filters(input_data, updates); }
+	if (input_data.format == format::type::png) {
+		return prepare_image &
+					 png_encoding_filters(input_data, files_data, force_finish, updates, report, skipped_writes, stats);
+	}
 
 	if (input_data.mipmaps) {
-		prepare_image &= impl::generate_mipmaps_filter(input_data.mipmap_filter, input_data.mipmap_blur);
+		prepare_image &=
+			impl::generate_mipmaps_filter(input_data.mipmap_filter, input_data.mipmap_blur, &force_finish, stats);
 	}
-	return prepare_image & dds_encoding_filters(input_data, files_data, updates);
+	return prepare_image &
+				 dds_encoding_filters(
+					 input_data, files_data, force_finish, updates, settings, pack, report, skipped_writes, stats);
+}
+
+oneapi::tbb::filter<void, void> get_pending_small_texture_filters(const input& input_data,
+	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data,
+	const encode_settings& settings, pack_writer* pack, file_report* report, std::atomic<std::size_t>* skipped_writes,
+	pipeline_statistics* stats) {
+	return impl::encode_pending_small_textures_filter(files_data, input_data.quality, input_data.alpha_black, settings) &
+				 dds_saving_filters(input_data, files_data, force_finish, updates, pack, report, skipped_writes, stats);
 }
 
 } // namespace todds::pipeline::impl
@@ -9,10 +9,23 @@
 #include <oneapi/tbb/parallel_pipeline.h>
 
 #include "filter_common.hpp"
+#include "filter_encode_dds.hpp"
+#include "pack_writer.hpp"
 
 namespace todds::pipeline::impl {
 
 oneapi::tbb::filter<void, void> get_filters_from_settings(const input& input_data, std::atomic<std::size_t>& counter,
-	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data);
+	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data,
+	const encode_settings& settings, pack_writer* pack, file_report* report, std::atomic<std::size_t>* skipped_writes,
+	pipeline_statistics* stats);
+
+/**
+ * Encodes and saves the small images left in the lane of the encoding settings after the main pipeline finishes.
+ * Output files are written in the same way as those of the main pipeline.
+ */
+oneapi::tbb::filter<void, void> get_pending_small_texture_filters(const input& input_data,
+	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data,
+	const encode_settings& settings, pack_writer* pack, file_report* report, std::atomic<std::size_t>* skipped_writes,
+	pipeline_statistics* stats);
 
 } // namespace todds::pipeline::impl
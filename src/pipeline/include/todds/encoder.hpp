@@ -0,0 +1,104 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/cpu.hpp"
+#include "todds/filter.hpp"
+#include "todds/format.hpp"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace todds {
+
+/** Options used to encode an image submitted to an encoder. */
+struct encoder_settings {
+	/** DDS file format to use for encoding. PNG is not supported. */
+	format::type format{format::type::bc7};
+
+	/** Use a different DDS encoding format for images with alpha. Disabled if it is invalid. */
+	format::type alpha_format{format::type::invalid};
+
+	/** Use a different DDS encoding format for opaque grayscale images. Disabled if it is invalid. */
+	format::type grayscale_format{format::type::invalid};
+
+	/** Encoder quality level. */
+	format::quality quality{format::quality::really_slow};
+
+	/** True if mipmaps should be generated. */
+	bool mipmaps{true};
+
+	/** Filter used to resize images during mipmap generation. */
+	filter::type mipmap_filter{filter::type::lanczos};
+
+	/** Blur applied during mipmap generation. */
+	double mipmap_blur{0.55};
+
+	/** The BC1 encoder will use 3 color blocks for blocks containing black or very dark pixels. */
+	bool alpha_black{};
+
+	/** Flip source images vertically before encoding. */
+	bool vflip{};
+
+	[[nodiscard]] bool operator==(const encoder_settings&) const noexcept = default;
+};
+
+/** Image submitted to an encoder. */
+struct encoder_image {
+	/** Contents of a PNG file, or RGBA pixels in rows from top to bottom if width and height are not zero. */
+	std::vector<std::uint8_t> data;
+
+	/** Width of the RGBA pixels. Must be zero for PNG files. */
+	std::size_t width{};
+
+	/** Height of the RGBA pixels. Must be zero for PNG files. */
+	std::size_t height{};
+};
+
+namespace pipeline::impl {
+class encoder_engine;
+} // namespace pipeline::impl
+
+/**
+ * Long-lived DDS encoder intended for embedding todds in other programs.
+ * Encoders are initialized once, and their threads and image buffers are kept between submissions. Images submitted
+ * while the encoder is busy are encoded together in the next batch of the pipeline, which lets small images share
+ * encoding calls.
+ * While any encoder is alive, OpenCV runs in sequential mode, as its global number of threads is set to zero. The
+ * previous number of threads is restored when the last encoder is destroyed.
+ */
+class encoder final {
+public:
+	/**
+	 * Initializes every DDS encoder and starts the threads of the pipeline.
+	 * @param threads Maximum number of threads used to encode images.
+	 * @param cpu_target Instruction set of the BC7 encoder. Only used if bc7e_ispc has been compiled for several targets.
+	 * Every encoder of the process shares the instruction set selected by the first one, or by encode_as_dds.
+	 */
+	explicit encoder(std::size_t threads, cpu::target cpu_target = cpu::target::automatic);
+	encoder(const encoder&) = delete;
+	encoder(encoder&&) noexcept = delete;
+	encoder& operator=(const encoder&) = delete;
+	encoder& operator=(encoder&&) noexcept = delete;
+
+	/** Waits until every submitted image has been encoded. */
+	~encoder();
+
+	/**
+	 * Queues an image for encoding. This function is thread safe.
+	 * @param image PNG file or RGBA pixels to encode.
+	 * @param settings Options used to encode the image.
+	 * @return Contents of the resulting DDS file. If the image cannot be encoded, the future holds a std::runtime_error.
+	 */
+	[[nodiscard]] std::future<std::vector<std::uint8_t>> submit(encoder_image image, const encoder_settings& settings);
+
+private:
+	std::unique_ptr<pipeline::impl::encoder_engine> _engine;
+};
+
+} // namespace todds
@@ -5,12 +5,16 @@
 
 #pragma once
 
+#include "todds/cache.hpp"
+#include "todds/cpu.hpp"
 #include "todds/filter.hpp"
 #include "todds/format.hpp"
 #include "todds/vector.hpp"
 
 #include <boost/filesystem/path.hpp>
 
+#include <optional>
+
 namespace todds::pipeline {
 
 /** Each entry is a PNG file to be encoded and the desired destination path for the resulting DDS file. */
@@ -33,6 +37,9 @@ struct input {
 	/** Use a different DDS encoding format for files with alpha. */
 	format::type alpha_format{};
 
+	/** Use a different DDS encoding format for opaque grayscale files. */
+	format::type grayscale_format{};
+
 	/** Quality level to use in this encoding. */
 	format::quality quality{};
 
@@ -68,6 +75,48 @@ struct input {
 
 	/** Prints information about the encoding process of each file. */
 	bool report{};
+
+	/** Reuse the encoded data of identical pixel blocks within this scope. */
+	cache::scope block_cache{};
+
+	/** Maximum memory used by each block cache, in MiB. */
+	std::size_t block_cache_size{};
+
+	/** BC3 and BC7 encoders emit a canonical block for fully transparent blocks. */
+	bool transparent_blocks{};
+
+	/** Blocks with an average channel variance below this threshold use low_complexity_quality. Zero disables it. */
+	float complexity_threshold{};
+
+	/** Quality level used for low complexity blocks. */
+	format::quality low_complexity_quality{};
+
+	/** Rate-distortion optimization lambda for BC1 and BC7. Zero disables it. */
+	float rdo_lambda{};
+
+	/** Regions encoded by the fast pass with a PSNR below this value are encoded again. Zero disables two-tier mode. */
+	double refine_psnr{};
+
+	/** Quality level of the first pass of two-tier encoding. */
+	format::quality fast_pass_quality{};
+
+	/** Measure the PSNR and SSIM of each encoded image. */
+	bool quality_metrics{};
+
+	/** Measure the latency, throughput and waiting time of each pipeline stage. */
+	bool stats{};
+
+	/** The pipeline will run again for files changing in watch mode. Recycled buffers are kept between runs. */
+	bool watch{};
+
+	/** Output files which already contain the encoded data are not written again. */
+	bool skip_unchanged{};
+
+	/** If set, DDS files are written into this pack file instead of their output paths. */
+	std::optional<boost::filesystem::path> pack{};
+
+	/** Instruction set used by the BC7 encoder in builds including several ISPC targets. */
+	cpu::target cpu_target{};
 };
 
 } // namespace todds::pipeline
@@ -13,7 +13,8 @@ namespace todds::pipeline {
 /**
  * Encodes a list of PNG files as DDS.
  * @param input_data Input data to use for the pipeline.
- * @param force_finish Used to force the pipeline to finish early, leaving it in a clean state.
+ * @param force_finish Used to force the pipeline to finish early, leaving it in a clean state. Images being processed
+ * are discarded within a few milliseconds, and files being written are never left partially written.
  * @param updates The pipeline will report updates back to the caller using this queue.
  */
 void encode_as_dds(const input& input_data, std::atomic<bool>& force_finish, todds::report_queue& updates);
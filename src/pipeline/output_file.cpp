@@ -0,0 +1,64 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "output_file.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <array>
+
+namespace todds::pipeline::impl {
+
+output_file::output_file(const boost::filesystem::path& path)
+	: _path{path}
+	, _temporary{path.string() + ".tmp"}
+	, _stream{_temporary, std::ios::out | std::ios::binary | std::ios::trunc}
+	, _committed{} {}
+
+output_file::~output_file() {
+	if (_committed) { return; }
+	_stream.close();
+	boost::system::error_code error_code;
+	boost::filesystem::remove(_temporary, error_code);
+}
+
+void output_file::write(std::span<const char> data) {
+	_stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+bool output_file::commit() {
+	_stream.close();
+	if (_stream.fail()) { return false; }
+	boost::system::error_code error_code;
+	boost::filesystem::rename(_temporary, _path, error_code);
+	_committed = !error_code;
+	return _committed;
+}
+
+bool has_contents(const boost::filesystem::path& path, std::initializer_list<std::span<const char>> parts) {
+	std::size_t size = 0U;
+	for (const auto& part : parts) { size += part.size(); }
+	boost::system::error_code error_code;
+	if (boost::filesystem::file_size(path, error_code) != size || error_code) { return false; }
+
+	boost::nowide::ifstream stream{path, std::ios::in | std::ios::binary};
+	if (!stream.is_open()) { return false; }
+	// Files are compared in chunks, which avoids reading the rest of the file after the first difference.
+	std::array<char, 16384U> buffer{};
+	for (const auto& part : parts) {
+		for (std::size_t offset = 0U; offset < part.size(); offset += buffer.size()) {
+			const std::size_t chunk = std::min(buffer.size(), part.size() - offset);
+			stream.read(buffer.data(), static_cast<std::streamsize>(chunk));
+			if (static_cast<std::size_t>(stream.gcount()) != chunk ||
+					!std::equal(buffer.data(), buffer.data() + chunk, part.data() + offset)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,64 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <initializer_list>
+#include <span>
+
+namespace todds::pipeline::impl {
+
+/**
+ * Writes a file into a temporary file next to it, and replaces the file with it once it has been written completely.
+ * Files are never left partially written, even if todds is stopped or fails while writing them.
+ */
+class output_file final {
+public:
+	/**
+	 * Creates the temporary file.
+	 * @param path Path of the file.
+	 */
+	explicit output_file(const boost::filesystem::path& path);
+	output_file(const output_file&) = delete;
+	output_file(output_file&&) noexcept = delete;
+	output_file& operator=(const output_file&) = delete;
+	output_file& operator=(output_file&&) noexcept = delete;
+
+	/** Deletes the temporary file if the output has not been committed. */
+	~output_file();
+
+	/**
+	 * Appends data to the temporary file.
+	 * @param data Data to write.
+	 */
+	void write(std::span<const char> data);
+
+	/**
+	 * Replaces the file with the temporary file.
+	 * @return False if the file could not be written. The temporary file is deleted in this case.
+	 */
+	[[nodiscard]] bool commit();
+
+private:
+	boost::filesystem::path _path;
+	boost::filesystem::path _temporary;
+	boost::nowide::ofstream _stream;
+	bool _committed;
+};
+
+/**
+ * Checks if a file already contains some data, so it does not need to be written again. Files with a different size are
+ * rejected without reading them.
+ * @param path Path of the file.
+ * @param parts Data that would be written into the file, one part after another.
+ * @return True if the file exists and its contents are identical to the data.
+ */
+[[nodiscard]] bool has_contents(
+	const boost::filesystem::path& path, std::initializer_list<std::span<const char>> parts);
+
+} // namespace todds::pipeline::impl
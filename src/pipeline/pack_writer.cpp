@@ -0,0 +1,83 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "pack_writer.hpp"
+
+#include <fmt/format.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace {
+
+template<typename Integer> void write_integer(boost::nowide::ofstream& stream, Integer value) {
+	std::array<char, sizeof(Integer)> bytes{};
+	for (char& byte : bytes) {
+		byte = static_cast<char>(value & 0xFFU);
+		value = static_cast<Integer>(value >> 8U);
+	}
+	stream.write(bytes.data(), bytes.size());
+}
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+pack_writer::pack_writer(const boost::filesystem::path& path)
+	: _mutex{}
+	, _stream{path, std::ios::out | std::ios::binary | std::ios::trunc}
+	, _offset{}
+	, _entries{} {
+	if (!_stream.is_open()) { throw std::runtime_error{fmt::format("Could not create pack file {:s}", path.string())}; }
+	_stream.write(magic.data(), magic.size());
+	write_integer(_stream, version);
+	write_integer(_stream, std::uint32_t{});
+	_offset = magic.size() + sizeof(version) + sizeof(std::uint32_t);
+}
+
+std::uint32_t pack_writer::checksum(std::initializer_list<std::span<const char>> parts) noexcept {
+	mz_ulong result = MZ_CRC32_INIT;
+	for (const auto& part : parts) {
+		result = mz_crc32(result, reinterpret_cast<const unsigned char*>(part.data()), part.size());
+	}
+	return static_cast<std::uint32_t>(result);
+}
+
+bool pack_writer::add(std::size_t file_index, const string& path, std::uint32_t checksum,
+	std::initializer_list<std::span<const char>> parts) {
+	// Each NUMA node runs its own pipeline, all of them writing into the same pack.
+	const std::lock_guard lock{_mutex};
+	entry current{file_index, path, _offset, 0U, checksum};
+	for (const auto& part : parts) {
+		if (!_stream.write(part.data(), static_cast<std::streamsize>(part.size()))) [[unlikely]] { return false; }
+		current.size += part.size();
+	}
+	_offset += current.size;
+	_entries.emplace_back(std::move(current));
+	return true;
+}
+
+bool pack_writer::finish() {
+	// Files are added as soon as they are encoded, but the index follows the order of the input.
+	std::sort(_entries.begin(), _entries.end(),
+		[](const entry& lhs, const entry& rhs) { return lhs.file_index < rhs.file_index; });
+	const std::uint64_t index_offset = _offset;
+	for (const auto& current : _entries) {
+		write_integer(_stream, current.offset);
+		write_integer(_stream, current.size);
+		write_integer(_stream, current.checksum);
+		write_integer(_stream, static_cast<std::uint32_t>(current.path.size()));
+		_stream.write(current.path.data(), static_cast<std::streamsize>(current.path.size()));
+	}
+	write_integer(_stream, index_offset);
+	write_integer(_stream, std::uint64_t{_entries.size()});
+	_stream.write(magic.data(), magic.size());
+	_stream.close();
+	return !_stream.fail();
+}
+
+} // namespace todds::pipeline::impl
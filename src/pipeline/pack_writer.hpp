@@ -0,0 +1,87 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/string.hpp"
+#include "todds/vector.hpp"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <span>
+#include <string_view>
+
+namespace todds::pipeline::impl {
+
+/**
+ * Writes several files into a single pack file.
+ * Pack files start with an 8 byte magic number followed by a 32-bit version and 4 reserved bytes. The contents of each
+ * file are stored next, one after another, in the order in which they were added. The index follows them, sorted by the
+ * index of each file in the input. It contains for each file its 64-bit offset, 64-bit size, CRC-32 checksum, the
+ * 32-bit size of its path and its path encoded in UTF-8. Pack files end with the 64-bit offset of the index, the 64-bit
+ * number of files and the magic number again. All values are little-endian.
+ * tools/unpack.py lists, verifies and extracts the contents of pack files.
+ */
+class pack_writer final {
+public:
+	static constexpr std::string_view magic{"TODDSPAK"};
+	static constexpr std::uint32_t version = 1U;
+
+	/**
+	 * Creates a pack file, replacing any previous file in the same path.
+	 * @param path Path of the pack file.
+	 * @exception std::runtime_error If the file could not be created.
+	 */
+	explicit pack_writer(const boost::filesystem::path& path);
+	pack_writer(const pack_writer&) = delete;
+	pack_writer(pack_writer&&) noexcept = delete;
+	pack_writer& operator=(const pack_writer&) = delete;
+	pack_writer& operator=(pack_writer&&) noexcept = delete;
+	~pack_writer() = default;
+
+	/**
+	 * Calculates the CRC-32 checksum of a file. Checksums are calculated separately so they can be done in parallel.
+	 * @param parts Contents of the file.
+	 * @return Checksum of the contents.
+	 */
+	[[nodiscard]] static std::uint32_t checksum(std::initializer_list<std::span<const char>> parts) noexcept;
+
+	/**
+	 * Appends a file to the pack. This function is thread safe.
+	 * @param file_index Index of the file in the input, used to sort the index of the pack.
+	 * @param path Path of the file inside of the pack.
+	 * @param checksum CRC-32 checksum of the contents of the file.
+	 * @param parts Contents of the file, written one after another.
+	 * @return False if the file could not be written. Files which could not be written are left out of the index.
+	 */
+	[[nodiscard]] bool add(std::size_t file_index, const string& path, std::uint32_t checksum,
+		std::initializer_list<std::span<const char>> parts);
+
+	/**
+	 * Writes the index of the pack. No more files can be added afterwards.
+	 * @return False if any write to the pack file failed.
+	 */
+	bool finish();
+
+private:
+	struct entry {
+		std::size_t file_index;
+		string path;
+		std::uint64_t offset;
+		std::uint64_t size;
+		std::uint32_t checksum;
+	};
+
+	std::mutex _mutex;
+	boost::nowide::ofstream _stream;
+	std::uint64_t _offset;
+	vector<entry> _entries;
+};
+
+} // namespace todds::pipeline::impl
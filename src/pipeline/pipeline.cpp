@@ -5,26 +5,84 @@
 
 #include "todds/pipeline.hpp"
 
+#include "todds/buffer_pool.hpp"
 #include "todds/dds.hpp"
 #include "todds/string.hpp"
 
-#include <boost/nowide/iostream.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <fmt/format.h>
 #include <oneapi/tbb/global_control.h>
+#include <oneapi/tbb/info.h>
 #include <oneapi/tbb/parallel_pipeline.h>
+#include <oneapi/tbb/task_arena.h>
+#include <oneapi/tbb/task_group.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 
+#include "file_report.hpp"
 #include "filter_common.hpp"
 #include "get_filters_from_settings.hpp"
+#include "pack_writer.hpp"
+#include "stage_statistics.hpp"
 
 namespace otbb = oneapi::tbb;
 using todds::dds_image;
 using todds::pipeline::paths_vector;
+
+namespace {
+
+// On systems with several NUMA nodes, each node runs its own copy of the pipeline in an arena constrained to it. Files
+// are taken from the shared counter, so each file stays in the same node from loading to saving. Since image buffers
+// are first touched by the thread writing them, their memory is also allocated in that node.
+// Arenas do not reserve a slot for the calling thread, so worker threads run every node at the same time while the
+// calling thread waits for each one of them.
+void run_pipeline(std::size_t parallelism, std::size_t tokens, const otbb::filter<void, void>& filters,
+	todds::report_queue& updates) {
+	const std::vector<otbb::numa_node_id> numa_nodes = otbb::info::numa_nodes();
+	if (numa_nodes.size() <= 1U) {
+		otbb::parallel_pipeline(tokens, filters);
+		return;
+	}
+
+	const std::size_t node_count = numa_nodes.size();
+	const auto node_concurrency = static_cast<int>(std::max<std::size_t>(parallelism / node_count, 1U));
+	const std::size_t node_tokens = std::max<std::size_t>(tokens / node_count, 1U);
+	updates.emplace(todds::report_type::statistics,
+		fmt::format("Running the pipeline on {:d} NUMA nodes with up to {:d} threads each.", node_count, node_concurrency));
+
+	std::vector<otbb::task_arena> arenas(node_count);
+	std::vector<otbb::task_group> task_groups(node_count);
+	for (std::size_t index = 0U; index < node_count; ++index) {
+		arenas[index].initialize(otbb::task_arena::constraints{numa_nodes[index], node_concurrency}, 0U);
+		arenas[index].execute([&task_groups, index, node_tokens, &filters] {
+			task_groups[index].run([node_tokens, &filters] { otbb::parallel_pipeline(node_tokens, filters); });
+		});
+	}
+	for (std::size_t index = 0U; index < node_count; ++index) {
+		arenas[index].execute([&task_groups, index] { task_groups[index].wait(); });
+	}
+}
+
+} // Anonymous namespace
+
 namespace todds::pipeline {
 
 void encode_as_dds(const input& input_data, std::atomic<bool>& force_finish, report_queue& updates) {
-	dds::initialize_encoding(input_data.format, input_data.alpha_format);
+	const cpu::target bc7_target = dds::initialize_encoding(
+		input_data.format, input_data.alpha_format, input_data.grayscale_format, input_data.cpu_target);
+	if (bc7_target != cpu::target::automatic) {
+		if (input_data.cpu_target != cpu::target::automatic && input_data.cpu_target != bc7_target) {
+			updates.emplace(report_type::pipeline_error,
+				fmt::format("CPU target {:s} is not supported by this CPU, or another one is already in use.",
+					cpu::name(input_data.cpu_target)));
+		}
+		updates.emplace(report_type::statistics, fmt::format("BC7 encoder CPU target: {:s}.", cpu::name(bc7_target)));
+	}
 
 	// Ensure that OpenCV is working in sequential mode.
 	cv::setNumThreads(0);
@@ -40,19 +98,149 @@ void encode_as_dds(const input& input_data, std::atomic<bool>& force_finish, rep
 	// accesses are thread-safe.
 	vector<impl::file_data> files_data(input_data.paths.size());
 
-	const otbb::filter<void, void> filters =
-		get_filters_from_settings(input_data, counter, force_finish, updates, files_data);
+	// Caches reusing the encoded data of identical pixel blocks.
+	dds::block_cache_statistics cache_statistics;
+	const std::size_t cache_memory = input_data.block_cache_size * 1024UL * 1024UL;
+	std::unique_ptr<dds::block_cache> batch_cache;
+	if (input_data.block_cache == cache::scope::batch) {
+		batch_cache = std::make_unique<dds::block_cache>(cache_memory, cache_statistics);
+	}
+	dds::adaptive_statistics adaptive_stats;
+	dds::encode_scheduler scheduler{input_data.parallelism};
+	dds::rdo_statistics rdo_stats;
+	dds::refine_statistics refine_stats;
+	// The small texture lane encodes each batch of files as a single image. Rate-distortion optimization reuses data from
+	// previous blocks, which would belong to other files. Image block caches and fast pass regions would be shared by
+	// every file of the batch.
+	impl::small_texture_lane small_textures;
+	const bool use_small_textures = input_data.rdo_lambda <= 0.0F && input_data.block_cache != cache::scope::image &&
+																	input_data.refine_psnr <= 0.0;
+	const impl::encode_settings settings{input_data.block_cache, cache_memory, batch_cache.get(), &cache_statistics,
+		input_data.transparent_blocks, input_data.complexity_threshold, input_data.low_complexity_quality, &adaptive_stats,
+		&scheduler, input_data.rdo_lambda, &rdo_stats, input_data.stats, input_data.refine_psnr,
+		input_data.fast_pass_quality, &refine_stats, use_small_textures ? &small_textures : nullptr,
+		input_data.quality_metrics, &force_finish};
+
+	// Rows of the report are sent as soon as each file has been written, using the time measured by the statistics.
+	std::unique_ptr<impl::file_report> report;
+	if (input_data.report) { report = std::make_unique<impl::file_report>(input_data, files_data, updates); }
+	std::unique_ptr<impl::pipeline_statistics> stats;
+	if (input_data.stats || report != nullptr) {
+		stats = std::make_unique<impl::pipeline_statistics>(input_data.parallelism, updates, report.get());
+	}
 
-	otbb::parallel_pipeline(tokens, filters);
+	std::unique_ptr<impl::pack_writer> pack;
+	if (input_data.pack.has_value() && input_data.format != format::type::png) {
+		try {
+			pack = std::make_unique<impl::pack_writer>(*input_data.pack);
+		} catch (const std::runtime_error& exc) {
+			updates.emplace(report_type::pipeline_error, exc.what());
+			return;
+		}
+	}
 
-	if (input_data.report) {
-		// Reports are not supported by the report system at the moment.
-		boost::nowide::cout << "File;Width;Height;Mipmaps;Format\n";
-		for (std::size_t index = 0U; index < input_data.paths.size(); ++index) {
-			const string& dds_path = input_data.paths[index].second.string();
-			const auto& data = files_data[index];
-			boost::nowide::cout << fmt::format(
-				"{:s};{:d};{:d};{:d};{:s}\n", dds_path, data.width, data.height, data.mipmaps, format::name(data.format));
+	// Files which already contain the encoded data are not written again.
+	std::atomic<std::size_t> skipped_writes{};
+	const otbb::filter<void, void> filters = get_filters_from_settings(input_data, counter, force_finish, updates,
+		files_data, settings, pack.get(), report.get(), input_data.skip_unchanged ? &skipped_writes : nullptr, stats.get());
+
+	run_pipeline(input_data.parallelism, tokens, filters, updates);
+	// The last batches of small textures are only complete once every file has left the pipeline.
+	if (settings.small_textures != nullptr && input_data.format != format::type::png && !force_finish) {
+		const otbb::filter<void, void> pending_filters =
+			get_pending_small_texture_filters(input_data, force_finish, updates, files_data, settings, pack.get(),
+				report.get(), input_data.skip_unchanged ? &skipped_writes : nullptr, stats.get());
+		otbb::parallel_pipeline(tokens, pending_filters);
+	}
+
+	if (pack != nullptr && force_finish) {
+		// Incomplete pack files are discarded, like any other partially written output.
+		pack.reset();
+		boost::system::error_code error_code;
+		boost::filesystem::remove(*input_data.pack, error_code);
+	} else if (pack != nullptr && !pack->finish()) {
+		updates.emplace(
+			report_type::pipeline_error, fmt::format("Could not write pack file {:s}.", input_data.pack->string()));
+	}
+
+	if (input_data.stats) { updates.emplace(report_type::statistics, stats->summary()); }
+	if (input_data.skip_unchanged) {
+		updates.emplace(report_type::statistics,
+			fmt::format("{:d} files were not written again, as their contents had not changed.", skipped_writes.load()));
+	}
+	// Buffers recycled between files are not needed anymore, unless the pipeline will run again in watch mode.
+	if (!input_data.watch) { buffer_pool::trim(); }
+
+	if (input_data.block_cache != cache::scope::none && input_data.format != format::type::png) {
+		const std::size_t hits = cache_statistics.hits;
+		const std::size_t total = hits + cache_statistics.misses;
+		const double hit_rate = total > 0U ? 100.0 * static_cast<double>(hits) / static_cast<double>(total) : 0.0;
+		updates.emplace(report_type::statistics,
+			fmt::format("Block cache {:s}: {:d} of {:d} blocks reused ({:.2f}%). {:d} blocks could not be cached due to the "
+									"memory limit.",
+				cache::name(input_data.block_cache), hits, total, hit_rate, cache_statistics.rejected.load()));
+	}
+
+	if (input_data.complexity_threshold > 0.0F && input_data.format != format::type::png) {
+		const std::size_t low_complexity = adaptive_stats.low_complexity_blocks;
+		const std::size_t total = low_complexity + adaptive_stats.regular_blocks;
+		const double low_rate = total > 0U ? 100.0 * static_cast<double>(low_complexity) / static_cast<double>(total) : 0.0;
+		updates.emplace(report_type::statistics,
+			fmt::format("Adaptive quality: {:d} of {:d} encoded blocks ({:.2f}%) used quality level {:d}.", low_complexity,
+				total, low_rate, static_cast<unsigned int>(input_data.low_complexity_quality)));
+	}
+
+	if (input_data.rdo_lambda > 0.0F && rdo_stats.total_blocks > 0U && !input_data.stats) {
+		updates.emplace(report_type::statistics,
+			fmt::format("Rate-distortion optimization: {:d} of {:d} blocks replaced.", rdo_stats.replaced_blocks.load(),
+				rdo_stats.total_blocks.load()));
+	} else if (input_data.rdo_lambda > 0.0F && rdo_stats.total_blocks > 0U) {
+		// Compressed sizes are only measured along with the other statistics, as they compress every image twice.
+		const std::size_t original_size = rdo_stats.original_size;
+		const std::size_t optimized_size = rdo_stats.optimized_size;
+		const double ratio =
+			original_size > 0U ? static_cast<double>(optimized_size) / static_cast<double>(original_size) : 1.0;
+		updates.emplace(report_type::statistics,
+			fmt::format("Rate-distortion optimization: {:d} of {:d} blocks replaced. Compressed size of encoded data reduced "
+									"from {:d} to {:d} bytes ({:.2f}%).",
+				rdo_stats.replaced_blocks.load(), rdo_stats.total_blocks.load(), original_size, optimized_size,
+				100.0 * (1.0 - ratio)));
+	}
+
+	if (input_data.refine_psnr > 0.0 && refine_stats.regions > 0U) {
+		const std::size_t refined = refine_stats.refined_regions;
+		const std::size_t regions = refine_stats.regions;
+		updates.emplace(report_type::statistics,
+			fmt::format("Two-tier encoding: {:d} of {:d} regions ({:.2f}%) encoded again with quality level {:d}.", refined,
+				regions, 100.0 * static_cast<double>(refined) / static_cast<double>(regions),
+				static_cast<unsigned int>(input_data.quality)));
+	}
+
+	if (input_data.quality_metrics) {
+		// Lossless images are excluded from the mean PSNR, as their PSNR is infinite.
+		std::size_t measured = 0U;
+		std::size_t lossy = 0U;
+		double psnr_sum = 0.0;
+		double ssim_sum = 0.0;
+		const impl::file_data* worst = nullptr;
+		for (const auto& data : files_data) {
+			if (data.quality.levels.empty()) { continue; }
+			++measured;
+			ssim_sum += data.quality.image.ssim;
+			if (std::isfinite(data.quality.image.psnr)) {
+				++lossy;
+				psnr_sum += data.quality.image.psnr;
+			}
+			if (worst == nullptr || data.quality.image.psnr < worst->quality.image.psnr) { worst = &data; }
+		}
+		if (worst != nullptr) {
+			const auto worst_index = static_cast<std::size_t>(worst - files_data.data());
+			updates.emplace(report_type::statistics,
+				fmt::format("Quality metrics of {:d} files: mean PSNR {:.2f} dB, mean SSIM {:.4f}. Lowest PSNR {:.2f} dB in "
+										"{:s}.",
+					measured, lossy > 0U ? psnr_sum / static_cast<double>(lossy) : std::numeric_limits<double>::infinity(),
+					ssim_sum / static_cast<double>(measured), worst->quality.image.psnr,
+					input_data.paths[worst_index].second.string()));
 		}
 	}
 }
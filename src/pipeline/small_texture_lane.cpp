@@ -0,0 +1,49 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "small_texture_lane.hpp"
+
+#include <cassert>
+#include <utility>
+
+namespace {
+
+constexpr std::size_t pixels_per_block = todds::pixel_block_side * todds::pixel_block_side;
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+bool small_texture_lane::accepts(const pixel_block_image& image) noexcept {
+	return image.size() / pixels_per_block <= max_image_blocks;
+}
+
+vector<pixel_block_data> small_texture_lane::add(format::type format, pixel_block_data data) {
+	assert(static_cast<std::size_t>(format) < format_count);
+	pending_batch& batch = _batches[static_cast<std::size_t>(format)];
+	const std::size_t blocks = data.image.size() / pixels_per_block;
+
+	const std::lock_guard lock{batch.mutex};
+	batch.images.emplace_back(std::move(data));
+	batch.blocks += blocks;
+	if (batch.blocks < batch_blocks) { return {}; }
+
+	batch.blocks = 0U;
+	return std::exchange(batch.images, {});
+}
+
+vector<small_texture_batch> small_texture_lane::take_pending() {
+	vector<small_texture_batch> pending;
+	for (std::size_t index = 0U; index < format_count; ++index) {
+		pending_batch& batch = _batches[index];
+		const std::lock_guard lock{batch.mutex};
+		if (batch.images.empty()) { continue; }
+		pending.push_back({static_cast<format::type>(index), std::exchange(batch.images, {})});
+		batch.blocks = 0U;
+	}
+	return pending;
+}
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,76 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/format.hpp"
+#include "todds/vector.hpp"
+
+#include <array>
+#include <mutex>
+
+#include "filter_pixel_blocks.hpp"
+
+namespace todds::pipeline::impl {
+
+/** Small images waiting to be encoded together with the same format. */
+struct small_texture_batch {
+	format::type format;
+	vector<pixel_block_data> images;
+};
+
+/**
+ * Groups small images encoded with the same format into batches.
+ * Encoding each icon on its own spends most of the time on per-image setup. Batches concatenate the pixel blocks of
+ * many images so they are encoded by a single call.
+ */
+class small_texture_lane final {
+public:
+	/** Images with up to this number of blocks use the lane. Matches a 128x128 image including its mipmaps. */
+	static constexpr std::size_t max_image_blocks = 1366U;
+	/** A batch is encoded as soon as it contains at least this number of blocks. */
+	static constexpr std::size_t batch_blocks = 16384U;
+
+	small_texture_lane() noexcept = default;
+	small_texture_lane(const small_texture_lane&) = delete;
+	small_texture_lane(small_texture_lane&&) noexcept = delete;
+	small_texture_lane& operator=(const small_texture_lane&) = delete;
+	small_texture_lane& operator=(small_texture_lane&&) noexcept = delete;
+	~small_texture_lane() = default;
+
+	/**
+	 * Checks if an image is small enough to use the lane.
+	 * @param image Pixel blocks of the image.
+	 * @return True if the image should be added to the lane.
+	 */
+	[[nodiscard]] static bool accepts(const pixel_block_image& image) noexcept;
+
+	/**
+	 * Adds an image to the batch of its format.
+	 * @param format Format used to encode the image.
+	 * @param data Pixel blocks of the image.
+	 * @return Images of the batch if it is full and must be encoded by the caller. Empty otherwise.
+	 */
+	[[nodiscard]] vector<pixel_block_data> add(format::type format, pixel_block_data data);
+
+	/**
+	 * Removes the batches which did not fill up. Must be called once every file has left the encoding stage.
+	 * @return Every pending batch. These must be encoded by the caller.
+	 */
+	[[nodiscard]] vector<small_texture_batch> take_pending();
+
+private:
+	struct pending_batch {
+		std::mutex mutex{};
+		vector<pixel_block_data> images{};
+		std::size_t blocks{};
+	};
+
+	static constexpr std::size_t format_count = static_cast<std::size_t>(format::type::bc7) + 1U;
+
+	std::array<pending_batch, format_count> _batches{};
+};
+
+} // namespace todds::pipeline::impl
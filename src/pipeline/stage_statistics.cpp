@@ -0,0 +1,309 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "stage_statistics.hpp"
+
+#include "todds/buffer_pool.hpp"
+
+#include <boost/predef.h>
+#include <fmt/format.h>
+#include <oneapi/tbb/task_arena.h>
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <string_view>
+
+#if BOOST_OS_WINDOWS
+#include <windows.h>
+
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+
+#include <csignal>
+#endif
+
+#include "file_report.hpp"
+
+namespace {
+
+std::atomic<bool> summary_requested{};
+
+// Counters used by the current thread. Instances are identified by a number which is never reused, unlike addresses.
+struct thread_slot {
+	std::uint64_t statistics_id{};
+	std::size_t index{};
+};
+
+std::atomic<std::uint64_t> next_statistics_id{1U};
+thread_local thread_slot current_slot{};
+
+#if !BOOST_OS_WINDOWS
+// The SIGUSR1 handler is installed by the first live instance of pipeline_statistics, and the previous handler is
+// restored by the last one. Instances may be created by several pipelines running at the same time.
+std::mutex usr1_mutex;
+std::size_t usr1_users{};
+struct sigaction usr1_oldact {};
+
+void usr1_signal(int signum) {
+	if (signum == SIGUSR1) { summary_requested.store(true); }
+}
+
+void install_usr1_handler() {
+	const std::lock_guard lock{usr1_mutex};
+	if (usr1_users++ > 0U) { return; }
+	summary_requested.store(false);
+	struct sigaction usr1_act {};
+	usr1_act.sa_handler = usr1_signal;
+	sigemptyset(&usr1_act.sa_mask);
+	usr1_act.sa_flags = 0;
+	sigaction(SIGUSR1, &usr1_act, &usr1_oldact);
+}
+
+void remove_usr1_handler() {
+	const std::lock_guard lock{usr1_mutex};
+	if (--usr1_users > 0U) { return; }
+	sigaction(SIGUSR1, &usr1_oldact, nullptr);
+}
+#endif
+
+// Memory usage of the process.
+struct memory_usage {
+	std::uint64_t peak_rss{};
+	std::uint64_t page_faults{};
+	std::uint64_t major_page_faults{};
+};
+
+memory_usage current_memory_usage() noexcept {
+	memory_usage usage{};
+#if BOOST_OS_WINDOWS
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) != 0) {
+		usage.peak_rss = counters.PeakWorkingSetSize;
+		usage.page_faults = counters.PageFaultCount;
+	}
+#else
+	rusage resources{};
+	if (getrusage(RUSAGE_SELF, &resources) == 0) {
+		// Linux reports the maximum resident set size in KiB.
+		usage.peak_rss = static_cast<std::uint64_t>(resources.ru_maxrss) * 1024U;
+		usage.page_faults = static_cast<std::uint64_t>(resources.ru_minflt + resources.ru_majflt);
+		usage.major_page_faults = static_cast<std::uint64_t>(resources.ru_majflt);
+	}
+#endif
+	return usage;
+}
+
+constexpr double nanoseconds_to_ms(double nanoseconds) noexcept { return nanoseconds / 1000000.0; }
+
+constexpr double to_megabytes(std::uint64_t bytes) noexcept { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+pipeline_statistics::pipeline_statistics(std::size_t threads, report_queue& updates, file_report* report)
+	: _id{next_statistics_id.fetch_add(1U)}
+	, _threads{std::max<std::size_t>(threads, 1U)}
+	, _slots{std::max(_threads, static_cast<std::size_t>(oneapi::tbb::this_task_arena::max_concurrency())) + 1U}
+	, _next_slot{}
+	, _counters{std::make_unique<thread_counters[]>(_slots)}
+	, _updates{updates}
+	, _report{report}
+	, _start{clock::now()}
+	, _initial_page_faults{}
+	, _initial_major_page_faults{} {
+	const memory_usage usage = current_memory_usage();
+	_initial_page_faults = usage.page_faults;
+	_initial_major_page_faults = usage.major_page_faults;
+	buffer_pool::reset_statistics();
+#if !BOOST_OS_WINDOWS
+	install_usr1_handler();
+#endif
+}
+
+pipeline_statistics::~pipeline_statistics() {
+#if !BOOST_OS_WINDOWS
+	remove_usr1_handler();
+#endif
+}
+
+pipeline_statistics::thread_counters& pipeline_statistics::current_thread() noexcept {
+	// Thread indexes of TBB are only unique within an arena, and pipelines may run in one arena per NUMA node.
+	if (current_slot.statistics_id != _id) [[unlikely]] {
+		current_slot.statistics_id = _id;
+		current_slot.index = _next_slot.fetch_add(1U, std::memory_order_relaxed);
+	}
+	// Threads beyond the expected ones share the first slot. Their updates are still atomic.
+	if (current_slot.index >= _slots) [[unlikely]] { return _counters[0]; }
+	return _counters[current_slot.index];
+}
+
+std::uint64_t pipeline_statistics::record(
+	stage stg, clock::time_point start, std::size_t bytes_in, std::size_t bytes_out) noexcept {
+	constexpr auto relaxed = std::memory_order_relaxed;
+	const auto end = clock::now();
+	const auto since_start = [this](clock::time_point point) {
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(point - _start).count());
+	};
+	const std::uint64_t start_ns = since_start(start);
+	const std::uint64_t end_ns = since_start(end);
+	const std::uint64_t busy_ns = end_ns - start_ns;
+
+	thread_counters& thread = current_thread();
+	stage_counters& counters = thread.stages[static_cast<std::size_t>(stg)];
+	// Time this thread spent between its previous token and this one, waiting for work to become available.
+	const std::uint64_t last_end_ns = thread.last_end_ns.exchange(end_ns, relaxed);
+	if (last_end_ns > 0U && start_ns > last_end_ns) { counters.wait_ns.fetch_add(start_ns - last_end_ns, relaxed); }
+
+	// Bit width of the latency in microseconds. std::countl_zero always returns int, unlike std::bit_width.
+	const int width = std::numeric_limits<std::uint64_t>::digits - std::countl_zero(busy_ns / 1000U);
+	const std::size_t bucket = std::min(static_cast<std::size_t>(width), histogram_buckets - 1U);
+	counters.tokens.fetch_add(1U, relaxed);
+	counters.busy_ns.fetch_add(busy_ns, relaxed);
+	counters.bytes_in.fetch_add(bytes_in, relaxed);
+	counters.bytes_out.fetch_add(bytes_out, relaxed);
+	counters.histogram[bucket].fetch_add(1U, relaxed);
+	return busy_ns;
+}
+
+bool pipeline_statistics::per_file() const noexcept { return _report != nullptr; }
+
+void pipeline_statistics::record_file(stage stg, std::size_t file_index, std::uint64_t nanoseconds) {
+	if (_report != nullptr) { _report->record_time(stg, file_index, nanoseconds); }
+}
+
+void pipeline_statistics::report_if_requested() {
+	if (summary_requested.load(std::memory_order_relaxed) && summary_requested.exchange(false)) [[unlikely]] {
+		_updates.emplace(report_type::statistics, summary());
+	}
+}
+
+string pipeline_statistics::summary() const {
+	constexpr auto relaxed = std::memory_order_relaxed;
+	const double elapsed =
+		static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - _start).count());
+	string result = fmt::format("Pipeline statistics after {:.3f} seconds:", elapsed / 1000000000.0);
+
+	for (std::size_t stage_index = 0U; stage_index < static_cast<std::size_t>(stage::total_stages); ++stage_index) {
+		std::uint64_t tokens{};
+		std::uint64_t busy_ns{};
+		std::uint64_t wait_ns{};
+		std::uint64_t bytes_in{};
+		std::uint64_t bytes_out{};
+		std::array<std::uint64_t, histogram_buckets> histogram{};
+		for (std::size_t thread_index = 0U; thread_index < _slots; ++thread_index) {
+			const stage_counters& counters = _counters[thread_index].stages[stage_index];
+			tokens += counters.tokens.load(relaxed);
+			busy_ns += counters.busy_ns.load(relaxed);
+			wait_ns += counters.wait_ns.load(relaxed);
+			bytes_in += counters.bytes_in.load(relaxed);
+			bytes_out += counters.bytes_out.load(relaxed);
+			for (std::size_t bucket = 0U; bucket < histogram_buckets; ++bucket) {
+				histogram[bucket] += counters.histogram[bucket].load(relaxed);
+			}
+		}
+		if (tokens == 0U) { continue; }
+
+		// Percentiles are reported as the upper bound of the histogram bucket containing them.
+		const auto percentile = [&histogram, tokens](std::uint64_t percent) {
+			const std::uint64_t target = std::max<std::uint64_t>((tokens * percent + 99U) / 100U, 1U);
+			std::uint64_t accumulated{};
+			std::size_t bucket = 0U;
+			for (; bucket < histogram_buckets - 1U; ++bucket) {
+				accumulated += histogram[bucket];
+				if (accumulated >= target) { break; }
+			}
+			return static_cast<double>(std::uint64_t{1U} << bucket) / 1000.0;
+		};
+
+		// Throughput while the stage is running, across every thread running it.
+		const double busy_seconds = static_cast<double>(busy_ns) / 1000000000.0;
+		const auto throughput = [busy_seconds](std::uint64_t bytes) {
+			return busy_seconds > 0.0 ? to_megabytes(bytes) / busy_seconds : 0.0;
+		};
+
+		result += fmt::format(
+			"\n  {:<15s} {:>7d} tokens | mean {:>9.3f} ms | p50 <= {:.3f} ms | p90 <= {:.3f} ms | p99 <= {:.3f} ms | "
+			"busy {:.3f} s ({:.1f}%) | in {:.1f} MB ({:.1f} MB/s) | out {:.1f} MB ({:.1f} MB/s) | waiting {:.3f} s",
+			stage_name(static_cast<stage>(stage_index)), tokens,
+			nanoseconds_to_ms(static_cast<double>(busy_ns) / static_cast<double>(tokens)), percentile(50U),
+			percentile(90U), percentile(99U), busy_seconds,
+			elapsed > 0.0 ? 100.0 * static_cast<double>(busy_ns) / (elapsed * static_cast<double>(_threads)) : 0.0,
+			to_megabytes(bytes_in), throughput(bytes_in), to_megabytes(bytes_out), throughput(bytes_out),
+			static_cast<double>(wait_ns) / 1000000000.0);
+	}
+
+	const memory_usage usage = current_memory_usage();
+	result += fmt::format("\n  Memory: peak RSS {:.1f} MB | {:d} page faults ({:d} major) since the pipeline started",
+		to_megabytes(usage.peak_rss), usage.page_faults - _initial_page_faults,
+		usage.major_page_faults - _initial_major_page_faults);
+	const buffer_pool::statistics pool = buffer_pool::get_statistics();
+	result += fmt::format("\n  Buffer pool: {:d} of {:d} large buffers reused | {:d} discarded | {:.1f} MB cached",
+		pool.reused, pool.rented, pool.discarded, to_megabytes(pool.cached_bytes));
+	return result;
+}
+
+std::size_t token_bytes(const png_file& file) noexcept { return file.buffer.size(); }
+
+std::size_t token_bytes(const std::unique_ptr<mipmap_image>& image) noexcept {
+	return image != nullptr ? image->data_size() : 0U;
+}
+
+std::size_t token_bytes(const pixel_block_data& data) noexcept { return data.image.size() * sizeof(std::uint32_t); }
+
+std::size_t token_bytes(const vector<dds_data>& data) noexcept {
+	return std::accumulate(data.cbegin(), data.cend(), std::size_t{},
+		[](std::size_t bytes, const dds_data& dds) { return bytes + dds.image.size() * sizeof(std::uint64_t); });
+}
+
+std::size_t token_bytes(const png_data& data) noexcept { return data.image.size(); }
+
+void record_files(pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const png_file& file) {
+	stats.record_file(stg, file.file_index, nanoseconds);
+}
+
+void record_files(
+	pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const std::unique_ptr<mipmap_image>& image) {
+	if (image != nullptr) { stats.record_file(stg, image->file_index(), nanoseconds); }
+}
+
+void record_files(pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const pixel_block_data& data) {
+	stats.record_file(stg, data.file_index, nanoseconds);
+}
+
+void record_files(pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const vector<dds_data>& data) {
+	// Small images are encoded together, so the time of their batch is shared between them.
+	if (data.empty()) { return; }
+	const std::uint64_t share = nanoseconds / data.size();
+	for (const auto& dds : data) { stats.record_file(stg, dds.file_index, share); }
+}
+
+void record_files(pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const png_data& data) {
+	stats.record_file(stg, data.file_index, nanoseconds);
+}
+
+std::string_view stage_name(stage stg) noexcept {
+	std::string_view name_str{};
+	switch (stg) {
+	case stage::load_png: name_str = "Load PNG"; break;
+	case stage::decode_png: name_str = "Decode PNG"; break;
+	case stage::scale_image: name_str = "Scale image"; break;
+	case stage::generate_mipmaps: name_str = "Mipmaps"; break;
+	case stage::pixel_blocks: name_str = "Pixel blocks"; break;
+	case stage::encode_dds: name_str = "Encode DDS"; break;
+	case stage::measure_quality: name_str = "Quality metrics"; break;
+	case stage::save_dds: name_str = "Save DDS"; break;
+	case stage::encode_png: name_str = "Encode PNG"; break;
+	case stage::save_png: name_str = "Save PNG"; break;
+	case stage::total_stages: break;
+	}
+	return name_str;
+}
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,205 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/mipmap_image.hpp"
+#include "todds/report.hpp"
+#include "todds/string.hpp"
+
+#include <oneapi/tbb/parallel_pipeline.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "filter_encode_dds.hpp"
+#include "filter_encode_png.hpp"
+#include "filter_load_png.hpp"
+#include "filter_pixel_blocks.hpp"
+
+namespace todds::pipeline::impl {
+
+/**
+ * Latency, throughput and waiting time of each pipeline stage.
+ * Each thread updates its own counters, so recording a token does not require locks or contended atomics. Threads
+ * get their counters the first time they record a token, so threads of different arenas never share them. Summaries
+ * can be requested at any time, including from other threads while the pipeline is running.
+ * The time spent by each stage on each file can be recorded as well, to include it in the report of the file.
+ */
+class pipeline_statistics final {
+public:
+	using clock = std::chrono::steady_clock;
+
+	/** Number of buckets of the latency histogram of each stage. Bucket N counts latencies below 2^N microseconds. */
+	static constexpr std::size_t histogram_buckets = 32U;
+
+	/**
+	 * Creates statistics with every counter set to zero.
+	 * On POSIX systems, SIGUSR1 requests a summary while the pipeline is running.
+	 * @param threads Maximum number of threads running the pipeline.
+	 * @param updates Queue receiving the summaries requested with SIGUSR1.
+	 * @param report If not nullptr, the time spent by each stage on each file is added to its report.
+	 */
+	pipeline_statistics(std::size_t threads, report_queue& updates, file_report* report);
+	pipeline_statistics(const pipeline_statistics&) = delete;
+	pipeline_statistics(pipeline_statistics&&) noexcept = delete;
+	pipeline_statistics& operator=(const pipeline_statistics&) = delete;
+	pipeline_statistics& operator=(pipeline_statistics&&) noexcept = delete;
+	~pipeline_statistics();
+
+	/**
+	 * Records a token processed by a stage in the current thread.
+	 * @param stg Stage processing the token.
+	 * @param start Time at which the stage started processing the token.
+	 * @param bytes_in Size of the data received by the stage.
+	 * @param bytes_out Size of the data produced by the stage.
+	 * @return Time spent by the stage processing the token, in nanoseconds.
+	 */
+	std::uint64_t record(stage stg, clock::time_point start, std::size_t bytes_in, std::size_t bytes_out) noexcept;
+
+	/**
+	 * Checks if the time spent on each file is being recorded.
+	 * @return True if record_file must be called for each file of every token.
+	 */
+	[[nodiscard]] bool per_file() const noexcept;
+
+	/**
+	 * Adds the time spent by a stage to the report of a file.
+	 * @param stg Stage processing the file.
+	 * @param file_index Index of the file.
+	 * @param nanoseconds Time spent by the stage on the file.
+	 */
+	void record_file(stage stg, std::size_t file_index, std::uint64_t nanoseconds);
+
+	/**
+	 * Sends a summary to the updates queue if it has been requested with SIGUSR1 since the last call.
+	 */
+	void report_if_requested();
+
+	/**
+	 * Summary of the statistics of every stage which has processed at least one token.
+	 * @return Text description of the statistics.
+	 */
+	[[nodiscard]] string summary() const;
+
+private:
+	struct stage_counters {
+		std::atomic<std::uint64_t> tokens{};
+		std::atomic<std::uint64_t> busy_ns{};
+		std::atomic<std::uint64_t> wait_ns{};
+		std::atomic<std::uint64_t> bytes_in{};
+		std::atomic<std::uint64_t> bytes_out{};
+		std::array<std::atomic<std::uint64_t>, histogram_buckets> histogram{};
+	};
+
+	// Counters updated by a single thread. Aligned to avoid false sharing between threads.
+	struct alignas(64) thread_counters {
+		std::array<stage_counters, static_cast<std::size_t>(stage::total_stages)> stages{};
+		// Time at which this thread finished its last token, in nanoseconds since the pipeline started.
+		std::atomic<std::uint64_t> last_end_ns{};
+	};
+
+	[[nodiscard]] thread_counters& current_thread() noexcept;
+
+	std::uint64_t _id;
+	std::size_t _threads;
+	std::size_t _slots;
+	std::atomic<std::size_t> _next_slot;
+	std::unique_ptr<thread_counters[]> _counters;
+	report_queue& _updates;
+	file_report* _report;
+	clock::time_point _start;
+	std::uint64_t _initial_page_faults;
+	std::uint64_t _initial_major_page_faults;
+};
+
+/** Size of the data of each type of token, used to measure the throughput of each stage. */
+[[nodiscard]] std::size_t token_bytes(const png_file& file) noexcept;
+[[nodiscard]] std::size_t token_bytes(const std::unique_ptr<mipmap_image>& image) noexcept;
+[[nodiscard]] std::size_t token_bytes(const pixel_block_data& data) noexcept;
+[[nodiscard]] std::size_t token_bytes(const vector<dds_data>& data) noexcept;
+[[nodiscard]] std::size_t token_bytes(const png_data& data) noexcept;
+
+/** Adds the time spent by a stage on a token to each file contained in it. Tokens with several files split it. */
+void record_files(pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const png_file& file);
+void record_files(
+	pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const std::unique_ptr<mipmap_image>& image);
+void record_files(pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const pixel_block_data& data);
+void record_files(pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const vector<dds_data>& data);
+void record_files(pipeline_statistics& stats, stage stg, std::uint64_t nanoseconds, const png_data& data);
+
+/**
+ * Name of a stage.
+ * @param stg Stage of the pipeline.
+ * @return Name of the stage, used in summaries and reports.
+ */
+[[nodiscard]] std::string_view stage_name(stage stg) noexcept;
+
+/**
+ * Wraps the body of a pipeline filter to record its statistics. Does nothing if statistics are disabled.
+ * @tparam Body Type of the body of the filter.
+ */
+template<typename Body> class timed_stage final {
+public:
+	timed_stage(pipeline_statistics* stats, stage stg, Body body)
+		: _stats{stats}
+		, _stage{stg}
+		, _body{std::move(body)} {}
+
+	// Filters copy their body. Assignment is only available if the body supports it.
+	timed_stage(const timed_stage&) = default;
+	timed_stage(timed_stage&&) noexcept = default;
+	timed_stage& operator=(const timed_stage&) = default;
+	timed_stage& operator=(timed_stage&&) noexcept = default;
+	~timed_stage() = default;
+
+	template<typename Input> auto operator()(Input&& input) const {
+		using output_type = decltype(_body(std::forward<Input>(input)));
+		if (_stats == nullptr) { return _body(std::forward<Input>(input)); }
+
+		_stats->report_if_requested();
+		const auto start = pipeline_statistics::clock::now();
+		std::size_t bytes_in = 0U;
+		if constexpr (!std::is_same_v<std::decay_t<Input>, oneapi::tbb::flow_control>) { bytes_in = token_bytes(input); }
+		// Time spent on each file is assigned using the files of the output, as stages such as encode_dds may produce
+		// files other than the ones they receive. Stages without output take their input by reference instead.
+		if constexpr (std::is_void_v<output_type>) {
+			_body(input);
+			const std::uint64_t nanoseconds = _stats->record(_stage, start, bytes_in, 0U);
+			if (_stats->per_file()) { record_files(*_stats, _stage, nanoseconds, input); }
+		} else {
+			output_type output = _body(std::forward<Input>(input));
+			const std::uint64_t nanoseconds = _stats->record(_stage, start, bytes_in, token_bytes(output));
+			if (_stats->per_file()) { record_files(*_stats, _stage, nanoseconds, output); }
+			return output;
+		}
+	}
+
+private:
+	pipeline_statistics* _stats;
+	stage _stage;
+	Body _body;
+};
+
+/**
+ * Creates a filter which records the statistics of its body.
+ * @param stats Statistics of the pipeline. Statistics are not recorded if this is nullptr.
+ * @param stg Stage of the filter.
+ * @param body Body of the filter.
+ * @param mode Filters are parallel unless their body must process tokens one by one.
+ */
+template<typename Input, typename Output, typename Body>
+oneapi::tbb::filter<Input, Output> make_timed_filter(pipeline_statistics* stats, stage stg, Body body,
+	oneapi::tbb::filter_mode mode = oneapi::tbb::filter_mode::parallel) {
+	return oneapi::tbb::make_filter<Input, Output>(mode, timed_stage<Body>{stats, stg, std::move(body)});
+}
+
+} // namespace todds::pipeline::impl
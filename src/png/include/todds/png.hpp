@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "todds/buffer_pool.hpp"
 #include "todds/memory.hpp"
 #include "todds/mipmap_image.hpp"
 #include "todds/string.hpp"
@@ -31,6 +32,6 @@ namespace todds::png {
 std::unique_ptr<mipmap_image> decode(std::size_t file_index, const string& png, std::span<const std::uint8_t> buffer,
 	bool flip, std::size_t& width, std::size_t& height, bool mipmaps);
 
-vector<std::uint8_t> encode(const string& png, std::unique_ptr<mipmap_image> input);
+buffer_pool::vector<std::uint8_t> encode(const string& png, std::unique_ptr<mipmap_image> input);
 
 } // namespace todds::png
@@ -113,7 +113,7 @@ std::unique_ptr<mipmap_image> decode(std::size_t file_index, const todds::string
 	return result;
 }
 
-vector<std::uint8_t> encode(const string& png, std::unique_ptr<mipmap_image> input) {
+buffer_pool::vector<std::uint8_t> encode(const string& png, std::unique_ptr<mipmap_image> input) {
 	if (input == nullptr) [[unlikely]] { return {}; }
 
 	const image& input_image = input->get_image(0U);
@@ -142,7 +142,7 @@ vector<std::uint8_t> encode(const string& png, std::unique_ptr<mipmap_image> inp
 			fmt::format("Could not obtain encoded PNG buffer for {:s}: {:s}", png, spng_strerror(ret))};
 	}
 
-	vector<std::uint8_t> result(png_size);
+	buffer_pool::vector<std::uint8_t> result(png_size);
 	auto* encoded_buffer = static_cast<std::uint8_t*>(png_buf);
 	std::copy(encoded_buffer, encoded_buffer + png_size, result.data());
 	return result;
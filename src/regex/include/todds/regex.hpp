@@ -6,6 +6,7 @@
 #pragma once
 
 #include <memory>
+#include <span>
 #include <string_view>
 
 namespace todds {
@@ -15,6 +16,16 @@ namespace todds {
  */
 class regex final {
 public:
+	/** Result of checking an input against the patterns of a database. */
+	enum class match_result {
+		/** The input does not match any pattern. */
+		none,
+		/** The input matches an include pattern and none of the exclude patterns. */
+		included,
+		/** The input matches an exclude pattern. */
+		excluded,
+	};
+
 	regex();
 	/**
 	 * Compiles a regular expression database which will only generate a single match per stream.
@@ -22,6 +33,14 @@ public:
 	 */
 	explicit regex(std::string_view pattern);
 
+	/**
+	 * Compiles every include and exclude pattern into a single database, so inputs are checked against all of them with
+	 * a single scan. Exclude patterns take precedence over include patterns.
+	 * @param include Regular expressions encoded as UTF-8 which inputs should match.
+	 * @param exclude Regular expressions encoded as UTF-8 which inputs should not match.
+	 */
+	regex(std::span<const std::string_view> include, std::span<const std::string_view> exclude);
+
 	regex(const regex&) = delete;
 	regex(regex&& other) noexcept;
 	regex& operator=(const regex&) = delete;
@@ -41,12 +60,19 @@ public:
 	[[nodiscard]] bool valid() const noexcept;
 
 	/**
-	 * Checks if an input matches the regular expression compiled into a database.
+	 * Checks if the database contains include patterns. Inputs not matching any pattern should only be rejected if it
+	 * does.
+	 * @return True if at least one include pattern was compiled.
+	 */
+	[[nodiscard]] bool has_include() const noexcept;
+
+	/**
+	 * Checks an input against every pattern compiled into the database.
 	 * This operation is not thread safe. Should never be called on invalid regex instances.
 	 * @param input Input to be checked for matches, encoded in UTF-8.
-	 * @return True if a match was found or if the internal database is not valid.
+	 * @return Result of the check. Inputs are never matched if the internal database is not valid.
 	 */
-	[[nodiscard]] bool match(std::string_view input) const;
+	[[nodiscard]] match_result match(std::string_view input) const;
 
 private:
 	std::unique_ptr<class regex_pimpl> _pimpl;
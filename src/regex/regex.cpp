@@ -6,21 +6,53 @@
 #include "todds/regex.hpp"
 
 #include "todds/string.hpp"
+#include "todds/vector.hpp"
 
 #include <hs.h>
 
+#include <algorithm>
 #include <cassert>
 
 namespace {
-hs_database* compile(std::string_view pattern, todds::string& error) {
+
+using match_result = todds::regex::match_result;
+
+// Identifiers of each type of pattern. Hyperscan allows several patterns to share the same identifier.
+constexpr unsigned int include_id = 0U;
+constexpr unsigned int exclude_id = 1U;
+
+hs_database* compile(
+	std::span<const std::string_view> include, std::span<const std::string_view> exclude, todds::string& error) {
 	hs_database* database{};
 
-	if (!pattern.empty()) {
+	// Hyperscan requires null-terminated patterns.
+	todds::vector<todds::string> patterns;
+	todds::vector<unsigned int> ids;
+	for (const std::string_view pattern : include) {
+		if (pattern.empty()) { continue; }
+		patterns.emplace_back(pattern);
+		ids.push_back(include_id);
+	}
+	for (const std::string_view pattern : exclude) {
+		if (pattern.empty()) { continue; }
+		patterns.emplace_back(pattern);
+		ids.push_back(exclude_id);
+	}
+
+	if (!patterns.empty()) {
 		constexpr unsigned int compile_flags = HS_FLAG_SINGLEMATCH | HS_FLAG_UTF8;
+		todds::vector<const char*> expressions;
+		for (const todds::string& pattern : patterns) { expressions.push_back(pattern.c_str()); }
+		const todds::vector<unsigned int> flags(patterns.size(), compile_flags);
 		assert(error.empty());
 		hs_compile_error_t* hs_error{};
-		if (hs_compile(pattern.data(), compile_flags, HS_MODE_BLOCK, nullptr, &database, &hs_error) != HS_SUCCESS) {
-			error = hs_error->message;
+		if (hs_compile_multi(expressions.data(), flags.data(), ids.data(), static_cast<unsigned int>(patterns.size()),
+					HS_MODE_BLOCK, nullptr, &database, &hs_error) != HS_SUCCESS) {
+			// Errors affecting a single pattern include its index.
+			if (hs_error->expression >= 0) {
+				error = patterns[static_cast<std::size_t>(hs_error->expression)] + ": ";
+			}
+			error += hs_error->message;
 			hs_free_compile_error(hs_error);
 		}
 	}
@@ -45,9 +77,14 @@ void free_scratch(hs_scratch* scratch) {
 }
 
 int handle_match(
-	unsigned int /*id*/, unsigned long long /*from*/, unsigned long long /*to*/, unsigned int /*flags*/, void* context) {
-	bool& has_match = *static_cast<bool*>(context);
-	has_match = true;
+	unsigned int id, unsigned long long /*from*/, unsigned long long /*to*/, unsigned int /*flags*/, void* context) {
+	auto& result = *static_cast<match_result*>(context);
+	if (id == exclude_id) {
+		result = match_result::excluded;
+		// Exclude patterns take precedence, there is no need to keep scanning.
+		return 1;
+	}
+	result = match_result::included;
 	return 0;
 }
 
@@ -60,32 +97,40 @@ public:
 	using scratch_ptr = std::unique_ptr<hs_scratch, void (*)(hs_scratch*)>;
 	using database_ptr = std::unique_ptr<hs_database, void (*)(hs_database*)>;
 
-	explicit regex_pimpl(std::string_view pattern)
+	regex_pimpl(std::span<const std::string_view> include, std::span<const std::string_view> exclude)
 		: _error{}
-		, _database{compile(pattern, _error), free_database}
-		, _scratch{nullptr, free_scratch} {
+		, _database{compile(include, exclude, _error), free_database}
+		, _scratch{nullptr, free_scratch}
+		, _has_include{
+				std::any_of(include.begin(), include.end(), [](std::string_view pattern) { return !pattern.empty(); })} {
 		_scratch = {_database != nullptr ? create_scratch(*_database) : nullptr, free_scratch};
 	}
 
 	[[nodiscard]] std::string_view error() const noexcept { return _error; }
 
-	bool match(std::string_view input) {
-		bool has_match{_database == nullptr || _scratch == nullptr};
-		if (!has_match) {
+	[[nodiscard]] bool has_include() const noexcept { return _has_include && _database != nullptr; }
+
+	regex::match_result match(std::string_view input) {
+		regex::match_result result{regex::match_result::none};
+		if (_database != nullptr && _scratch != nullptr) {
 			hs_scan(_database.get(), input.data(), static_cast<unsigned int>(input.size()), 0, _scratch.get(), handle_match,
-				static_cast<void*>(&has_match));
+				static_cast<void*>(&result));
 		}
-		return has_match;
+		return result;
 	}
 
 private:
 	string _error;
 	database_ptr _database;
 	scratch_ptr _scratch;
+	bool _has_include;
 };
 
 regex::regex(std::string_view pattern)
-	: _pimpl{std::make_unique<regex_pimpl>(pattern)} {}
+	: regex{std::span<const std::string_view>{&pattern, 1U}, {}} {}
+
+regex::regex(std::span<const std::string_view> include, std::span<const std::string_view> exclude)
+	: _pimpl{std::make_unique<regex_pimpl>(include, exclude)} {}
 
 regex::regex()
 	: _pimpl{nullptr} {}
@@ -100,6 +145,8 @@ std::string_view regex::error() const noexcept { return valid() ? _pimpl->error(
 
 bool regex::valid() const noexcept { return _pimpl != nullptr; }
 
-bool regex::match(std::string_view input) const { return _pimpl->match(input); }
+bool regex::has_include() const noexcept { return valid() && _pimpl->has_include(); }
+
+regex::match_result regex::match(std::string_view input) const { return _pimpl->match(input); }
 
 } // namespace todds
@@ -12,6 +12,9 @@ class regex_pimpl final {};
 regex::regex(std::string_view) // NOLINT
 	: _pimpl{nullptr} {}
 
+regex::regex(std::span<const std::string_view>, std::span<const std::string_view>) // NOLINT
+	: _pimpl{nullptr} {}
+
 regex::regex()
 	: regex("") {}
 
@@ -23,6 +26,10 @@ regex::~regex() = default;
 
 std::string_view regex::error() const noexcept { return "Missing Hyperscan support."; } // NOLINT
 
-bool regex::match(std::string_view) const { return true; }															// NOLINT
+bool regex::valid() const noexcept { return false; }
+
+bool regex::has_include() const noexcept { return false; }
+
+regex::match_result regex::match(std::string_view) const { return match_result::none; } // NOLINT
 
 } // namespace todds
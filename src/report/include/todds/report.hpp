@@ -9,6 +9,12 @@
 
 #include <oneapi/tbb/concurrent_queue.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
 namespace todds {
 
 enum class report_type {
@@ -26,6 +32,12 @@ enum class report_type {
 	encoding_progress,
 	/// A non-critical error to be reported back to the user. Contains a text description of the error.
 	pipeline_error,
+	/// Information about the encoding process, such as the BC7 CPU target or block cache statistics. Contains a text
+	/// description.
+	statistics,
+	/// Row of the report of a file, sent as soon as the file has been processed. Only enabled if the user requested a
+	/// report. The first row contains the name of each column.
+	file_report,
 };
 
 class report final {
@@ -50,6 +62,55 @@ private:
 	std::size_t _value{};
 };
 
-using report_queue = oneapi::tbb::concurrent_queue<report>;
+/**
+ * Reports sent by the pipeline. Consumers can wait for new reports instead of polling the queue.
+ * Reports can be sent from any thread. Waking up consumers only requires locking when one of them is waiting.
+ */
+class report_queue final {
+public:
+	report_queue() = default;
+	report_queue(const report_queue&) = delete;
+	report_queue(report_queue&&) noexcept = delete;
+	report_queue& operator=(const report_queue&) = delete;
+	report_queue& operator=(report_queue&&) noexcept = delete;
+	~report_queue() = default;
+
+	/**
+	 * Sends a report, waking up any consumer waiting for it.
+	 * @param args Arguments used to construct the report.
+	 */
+	template<typename... Args> void emplace(Args&&... args) {
+		_queue.emplace(std::forward<Args>(args)...);
+		notify();
+	}
+
+	/**
+	 * Takes the oldest report of the queue without blocking.
+	 * @param update Assigned the report, if there was one.
+	 * @return False if the queue was empty.
+	 */
+	bool try_pop(report& update);
+
+	/**
+	 * Checks if the queue has any report.
+	 * @return True if the queue is empty.
+	 */
+	[[nodiscard]] bool empty() const;
+
+	/**
+	 * Blocks until there is at least one report in the queue, or until the timeout expires.
+	 * @param timeout Maximum waiting time.
+	 * @return True if there are reports in the queue.
+	 */
+	bool wait_for(std::chrono::milliseconds timeout);
+
+private:
+	void notify();
+
+	oneapi::tbb::concurrent_queue<report> _queue{};
+	std::mutex _mutex{};
+	std::condition_variable _changed{};
+	std::atomic<std::size_t> _waiting{};
+};
 
 } // namespace todds
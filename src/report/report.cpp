@@ -27,4 +27,26 @@ const todds::string& report::data() const { return _data; }
 
 std::size_t report::value() const { return _value; }
 
+bool report_queue::try_pop(report& update) { return _queue.try_pop(update); }
+
+bool report_queue::empty() const { return _queue.empty(); }
+
+bool report_queue::wait_for(std::chrono::milliseconds timeout) {
+	std::unique_lock lock{_mutex};
+	_waiting.fetch_add(1U);
+	// Pairs with the fence in notify. Either this consumer sees the new report, or notify sees the consumer waiting.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const bool available = _changed.wait_for(lock, timeout, [this] { return !_queue.empty(); });
+	_waiting.fetch_sub(1U);
+	return available;
+}
+
+void report_queue::notify() {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (_waiting.load(std::memory_order_relaxed) == 0U) [[likely]] { return; }
+	// Taking the mutex guarantees that the consumer is either blocked or has not checked the queue yet.
+	{ const std::lock_guard lock{_mutex}; }
+	_changed.notify_all();
+}
+
 } // namespace todds
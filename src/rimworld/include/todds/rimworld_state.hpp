@@ -51,6 +51,9 @@ public:
 	[[nodiscard]] bool process_all_files() const noexcept;
 	void set_process_all_files(bool value) noexcept;
 
+	[[nodiscard]] bool fast_pass() const noexcept;
+	void set_fast_pass(bool value) noexcept;
+
 	void set_threads(std::size_t threads) noexcept;
 	[[nodiscard]] std::size_t get_threads() const noexcept;
 	[[nodiscard]] std::size_t get_max_threads() const noexcept;
@@ -87,6 +90,7 @@ private:
 	todds::string _target_path{};
 	bool _valid_target_path{};
 	bool _process_all_files{};
+	bool _fast_pass{};
 	bool _encoding{};
 	bool _cleaning{};
 	std::size_t _threads{static_cast<std::size_t>(oneapi::tbb::info::default_concurrency())};
@@ -24,6 +24,7 @@ constexpr std::string_view font_size_key = "font_size";
 constexpr std::string_view style_index_key = "style_index";
 constexpr std::string_view target_path_key = "target_path";
 constexpr std::string_view process_all_files_key = "process_all_files";
+constexpr std::string_view fast_pass_key = "fast_pass";
 
 std::string default_mods_folder() {
 #if BOOST_OS_WINDOWS
@@ -46,6 +47,9 @@ todds::args::data arguments(const rimworld::execution_state& state) {
 	data.format = todds::format::type::bc1;
 	data.alpha_format = todds::format::type::bc7;
 	data.quality = todds::format::quality::really_slow;
+	// Most RimWorld textures are encoded without visible differences by the fast pass.
+	if (state.fast_pass()) { data.fast_pass = todds::format::quality::fast; }
+	data.fast_pass_psnr = 45.0;
 	data.fix_size = true;
 	data.mipmaps = true;
 	data.mipmap_filter = todds::filter::type::lanczos;
@@ -68,6 +72,7 @@ namespace rimworld {
 void execution_state::reset_preferences() {
 	_font_size = 22.0F;
 	_process_all_files = false;
+	_fast_pass = false;
 	set_target_path(default_mods_folder());
 }
 
@@ -90,6 +95,7 @@ void execution_state::load_preferences() {
 			if (json.contains(font_size_key)) { set_font_size(json.at(font_size_key)); }
 			if (json.contains(target_path_key)) { set_target_path(json.at(target_path_key)); }
 			if (json.contains(process_all_files_key)) { set_process_all_files(json.at(process_all_files_key)); }
+			if (json.contains(fast_pass_key)) { set_fast_pass(json.at(fast_pass_key)); }
 		} catch (const std::exception& exc) {
 			log::error(fmt::format("Could not load preferences because of an exception: {:s}", exc.what()));
 		}
@@ -108,6 +114,7 @@ void execution_state::save_preferences() {
 	json[font_size_key] = _font_size;
 	json[target_path_key] = _target_path;
 	json[process_all_files_key] = _process_all_files;
+	json[fast_pass_key] = _fast_pass;
 	const auto config_path = config_file_path();
 	nw::ofstream ofs(config_path);
 	ofs << std::setw(4U) << json << '\n';
@@ -148,6 +155,8 @@ void execution_state::update(std::uint32_t /*elapsed_milliseconds*/) {
 			rimworld::log::error(fmt::format("pipeline_error: {:s}", update.data()));
 			_errors.emplace_back(update.data());
 			break;
+		case todds::report_type::statistics: rimworld::log::info(fmt::format("statistics: {:s}", update.data())); break;
+		case todds::report_type::file_report: break;
 		}
 	}
 
@@ -205,6 +214,10 @@ bool execution_state::process_all_files() const noexcept { return _process_all_f
 
 void execution_state::set_process_all_files(bool value) noexcept { _process_all_files = value; }
 
+bool execution_state::fast_pass() const noexcept { return _fast_pass; }
+
+void execution_state::set_fast_pass(bool value) noexcept { _fast_pass = value; }
+
 void execution_state::set_threads(std::size_t threads) noexcept { _threads = threads; }
 std::size_t execution_state::get_threads() const noexcept { return _threads; }
 std::size_t execution_state::get_max_threads() const noexcept { return _max_threads; }
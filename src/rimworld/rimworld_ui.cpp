@@ -105,6 +105,17 @@ void show_setup_interface(execution_state& state, ui_impl& ui_data) {
 	ImGui::NewLine();
 	ImGui::NewLine();
 
+	bool fast_pass = state.fast_pass();
+	ImGui::SeparatorText("Encoding speed");
+	ImGui::Checkbox("Fast encoding", &fast_pass);
+	state.set_fast_pass(fast_pass);
+	ImGui::SameLine();
+	help_marker("Encode textures with a fast quality level first, and only encode again the parts of each texture which "
+							"lost too much quality. This makes encoding much faster, but some textures may look slightly worse. "
+							"Disabled by default.");
+	ImGui::NewLine();
+	ImGui::NewLine();
+
 	constexpr const char* encode_new = "Encode new textures";
 	constexpr const char* encode_all = "Encode all textures";
 	ImGui::SeparatorText("Launch");
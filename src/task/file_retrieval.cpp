@@ -4,18 +4,28 @@
  */
 #include "todds/file_retrieval.hpp"
 
+#include "todds/shard.hpp"
+
 #include <boost/nowide/convert.hpp>
 #include <boost/nowide/fstream.hpp>
 #include <boost/predef.h>
 #include <fmt/format.h>
+#include <oneapi/tbb/parallel_for.h>
 
+#include <algorithm>
+#include <array>
 #include <cwctype>
+#include <numeric>
+#include <optional>
 #include <stack>
 #include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 namespace fs = boost::filesystem;
 using todds::pipeline::paths_vector;
+using match_result = todds::regex::match_result;
 
 using path_view = std::basic_string_view<fs::path::value_type>;
 using path_string = fs::path::string_type;
@@ -74,13 +84,23 @@ bool has_extension(const fs::path& path, const path_view extension) {
 	return insensitive_equals(extension_view(path), extension);
 }
 
+// Key used to find a file name in the listing of its directory. File names are case-insensitive on Windows.
+path_string listing_key(const path_view name) {
+	path_string key{name};
+#if BOOST_OS_WINDOWS
+	std::transform(
+		key.begin(), key.end(), key.begin(), [](path_char chr) { return static_cast<path_char>(std::towlower(chr)); });
+#endif // BOOST_OS_WINDOWS
+	return key;
+}
+
 class file_retrieval_state final {
 public:
-	file_retrieval_state(todds::report_queue& updates, const todds::vector<boost::filesystem::path>& input,
+	file_retrieval_state(todds::report_queue& updates, todds::vector<boost::filesystem::path> input,
 		std::optional<boost::filesystem::path> output, todds::format::type format, bool create_folders, bool overwrite,
 		bool overwrite_new, const todds::string& substring, const todds::regex& regex, const std::size_t depth) // NOLINT
 		: _updates{updates}
-		, _input{input}
+		, _input{std::move(input)}
 		, _output{std::move(output)}
 		, _output_extension{format == todds::format::type::png ? png_extension : dds_extension}
 		, _create_folders{create_folders}
@@ -89,27 +109,66 @@ public:
 		, _substring{PATH_STRING_WIDEN(substring)}
 		, _regex{regex}
 		, _depth{depth}
-		, _files{} {}
+		, _files{}
+		, _pruned{}
+		, _output_directories{}
+		, _output_listings{} {}
 
-	paths_vector get_result() {
+	paths_vector get_result(std::size_t shard, std::size_t shard_count) {
 		process_user_input();
+		if (_pruned > 0U) {
+			_updates.emplace(todds::report_type::statistics,
+				fmt::format("Skipped {:d} excluded files and directories while retrieving files.", _pruned));
+		}
+		// Every process must split the same files, so shards are taken before checking which outputs are up-to-date.
+		if (shard_count > 1U) { _files = todds::get_shard(_files, shard, shard_count); }
+		return take_files();
+	}
+
+	paths_vector get_result(const todds::vector<fs::path>& changed) {
+		for (const fs::path& path : changed) { process_changed_file(path); }
+		return take_files();
+	}
+
+private:
+	// Removes the files whose output does not need to be generated.
+	paths_vector take_files() {
 		paths_vector result{};
 		std::swap(result, _files);
+		std::erase_if(result, [this](const auto& paths) { return !should_generate(paths.first, paths.second); });
 		return result;
 	}
 
-private:
-	[[nodiscard]] bool path_matches_criteria(const fs::path& path) const {
-		return (!_substring.empty() && path.native().find(_substring) != std::string::npos) ||
-					 (_regex.valid() && _regex.match(PATH_STRING_NARROW(path.native())));
+	// Paths are included if they match any include criteria, or if there are none.
+	[[nodiscard]] match_result path_matches_criteria(const fs::path& path) const {
+		const match_result result =
+			_regex.valid() ? _regex.match(PATH_STRING_NARROW(path.native())) : match_result::none;
+		if (result != match_result::none) { return result; }
+		if (!_substring.empty()) {
+			return path.native().find(_substring) != std::string::npos ? match_result::included : match_result::none;
+		}
+		return _regex.has_include() ? match_result::none : match_result::included;
 	}
 
-	[[nodiscard]] bool should_generate(const fs::path& input_path, const fs::path& output_path) const {
+	[[nodiscard]] bool should_generate(const fs::path& input_path, const fs::path& output_path) {
 		return input_path != output_path &&
-					 (_overwrite || !fs::exists(output_path) ||
+					 (_overwrite || !output_exists(output_path) ||
 						 (_overwrite_new && (fs::last_write_time(input_path) > fs::last_write_time(output_path))));
 	}
 
+	// Each output directory is listed once, instead of checking the existence of each output file separately.
+	[[nodiscard]] bool output_exists(const fs::path& output_path) {
+		const auto [listing, inserted] = _output_listings.try_emplace(output_path.parent_path().native());
+		if (inserted) {
+			boost::system::error_code error_code;
+			for (fs::directory_iterator itr{output_path.parent_path(), error_code};
+					 !error_code && itr != fs::directory_iterator{}; itr.increment(error_code)) {
+				listing->second.insert(listing_key(itr->path().filename().native()));
+			}
+		}
+		return listing->second.contains(listing_key(output_path.filename().native()));
+	}
+
 	void process_user_input() {
 		for (const fs::path& path : _input) {
 			if (fs::is_directory(path)) {
@@ -124,60 +183,117 @@ private:
 	void process_user_input_directory(const fs::path& path) {
 		const fs::directory_entry dir{path};
 
-		std::size_t match_update_depth = 0U;
-		bool current_match = path_matches_criteria(path);
+		const match_result root_match = path_matches_criteria(path);
+		if (root_match == match_result::excluded) {
+			++_pruned;
+			return;
+		}
+		// Every file inside of a directory matching the criteria is included. This keeps the depth of the shallowest one.
+		std::optional<std::size_t> match_depth{};
 
 		for (fs::recursive_directory_iterator itr{dir}; itr != fs::recursive_directory_iterator{}; ++itr) {
-			// When current_match is true, there is no need to update when going deeper.
-			// When reducing depth, the value must always be updated.
-			if (itr->is_directory()) {
-				const auto current_depth = static_cast<size_t>(itr.depth());
-				if (((current_depth > match_update_depth && !current_match) || current_depth < match_update_depth)) {
-					current_match = path_matches_criteria(path);
-					match_update_depth = current_depth;
-				}
-			}
+			const auto current_depth = static_cast<std::size_t>(itr.depth());
+			if (match_depth.has_value() && current_depth <= *match_depth) { match_depth.reset(); }
+			const bool current_match = root_match == match_result::included || match_depth.has_value();
 
 			_updates.emplace(todds::report_type::retrieving_files_progress);
 
 			try {
 				const fs::path& current_path = itr->path();
-				if (has_extension(current_path, png_extension)) {
-					// Determine output path.
-					fs::path current_output{};
-					if (_output.has_value()) {
-						current_output = _output.value();
-						const auto relative = fs::relative(current_path.parent_path(), path);
-						if (!relative.filename_is_dot()) { current_output /= relative; }
-						// Create the output folder if necessary.
-						if (_create_folders && !fs::exists(current_output)) { fs::create_directories(current_output); }
-					} else {
-						current_output = current_path.parent_path();
+				if (itr->is_directory()) {
+					// Excluded directories are never searched. Exclude patterns are checked even inside of matching directories.
+					const match_result result = path_matches_criteria(current_path);
+					if (result == match_result::excluded) {
+						++_pruned;
+						itr.disable_recursion_pending();
+						continue;
 					}
-
-					process_file(current_path, current_output, current_match);
+					if (!current_match && result == match_result::included) { match_depth = current_depth; }
+				} else if (has_extension(current_path, png_extension)) {
+					process_file(current_path, output_directory(current_path, path), current_match);
 				}
 			} catch (const fs::filesystem_error& error) {
 				_updates.emplace(todds::report_type::pipeline_error, error.what());
 			}
 
-			if (static_cast<unsigned int>(itr.depth()) >= _depth) { itr.disable_recursion_pending(); }
+			if (current_depth >= _depth) { itr.disable_recursion_pending(); }
 		}
 	}
 
-	// Assumes that the extension check has been performed already.
+	// Files inside of an input directory may be written to a mirrored folder structure in the output path.
+	// Output folders are calculated and created once for each input folder. The same folder may be found through several
+	// input directories, each one of them mirroring it into a different output folder.
+	[[nodiscard]] fs::path output_directory(const fs::path& input_file, const fs::path& input_directory) {
+		if (!_output.has_value()) { return input_file.parent_path(); }
+		const fs::path input_parent = input_file.parent_path();
+		auto& output_directories = _output_directories[input_directory.native()];
+		if (const auto cached = output_directories.find(input_parent.native()); cached != output_directories.end()) {
+			return cached->second;
+		}
+
+		fs::path current_output = _output.value();
+		const auto relative = fs::relative(input_parent, input_directory);
+		if (!relative.filename_is_dot()) { current_output /= relative; }
+		// Create the output folder if necessary. New folders do not need to be listed.
+		if (_create_folders && !fs::exists(current_output)) {
+			fs::create_directories(current_output);
+			_output_listings.try_emplace(current_output.native());
+		}
+		output_directories.emplace(input_parent.native(), current_output);
+		return current_output;
+	}
+
+	// Applies the same criteria as process_user_input to a single PNG file which has changed.
+	void process_changed_file(const fs::path& path) {
+		try {
+			for (const fs::path& input : _input) {
+				if (path == input) {
+					process_file(path, path.parent_path());
+					return;
+				}
+				if (!fs::is_directory(input)) { continue; }
+
+				const fs::path relative = path.parent_path().lexically_relative(input);
+				if (relative.empty() || relative.begin()->string() == "..") { continue; }
+				const auto depth =
+					relative.filename_is_dot() ? 0U : static_cast<std::size_t>(std::distance(relative.begin(), relative.end()));
+				if (depth > _depth) { continue; }
+
+				// Directories between the input and the file are checked in the same way as when searching the input.
+				fs::path directory = input;
+				match_result directory_match = path_matches_criteria(directory);
+				for (const fs::path& part : relative) {
+					if (directory_match == match_result::excluded || part.filename_is_dot()) { break; }
+					directory /= part;
+					const match_result result = path_matches_criteria(directory);
+					if (result != match_result::none) { directory_match = result; }
+				}
+				if (directory_match != match_result::excluded) {
+					process_file(path, output_directory(path, input), directory_match == match_result::included);
+				}
+				return;
+			}
+		} catch (const fs::filesystem_error& error) {
+			_updates.emplace(todds::report_type::pipeline_error, error.what());
+		}
+	}
+
+	// Assumes that the extension check has been performed already. Files with up-to-date outputs are removed later.
 	bool process_file(const fs::path& input_file, const fs::path& output_path, bool previous_match = false) {
-		if (!previous_match && !path_matches_criteria(input_file)) { return false; }
-		const fs::path output_file = (output_path / input_file.stem()) += _output_extension.data();
-		if (!should_generate(input_file, output_file)) { return false; }
-		_files.emplace_back(input_file, output_file);
+		const match_result result = path_matches_criteria(input_file);
+		if (result == match_result::excluded) {
+			++_pruned;
+			return false;
+		}
+		if (!previous_match && result != match_result::included) { return false; }
+		_files.emplace_back(input_file, (output_path / input_file.stem()) += _output_extension.data());
 		return true;
 	}
 
 	// Error reporting
 	todds::report_queue& _updates;
 	// Input and output.
-	const todds::vector<boost::filesystem::path>& _input;
+	const todds::vector<boost::filesystem::path> _input;
 	std::optional<boost::filesystem::path> _output;
 	const path_view _output_extension;
 	const bool _create_folders;
@@ -189,11 +305,29 @@ private:
 	const std::size_t _depth;
 	// Input state parameters.
 	paths_vector _files;
+	// Number of files and directories skipped because they matched an exclude pattern.
+	std::size_t _pruned;
+	// Output directory of each directory containing PNG files, for each input directory.
+	std::unordered_map<path_string, std::unordered_map<path_string, fs::path>> _output_directories;
+	// Names of the files found in each output directory.
+	std::unordered_map<path_string, std::unordered_set<path_string>> _output_listings;
 };
 
-file_retrieval_state from_args(const todds::args::data& args, todds::report_queue& updates) {
+todds::vector<boost::filesystem::path> input_paths(const todds::args::data& args) {
+	if (args.input.empty() || !has_extension(args.input[0], txt_extension)) { return args.input; }
+	todds::vector<boost::filesystem::path> input{};
+	boost::nowide::fstream stream{args.input[0]};
+	todds::string buffer;
+	while (std::getline(stream, buffer)) { input.push_back(fs::canonical(fs::path{buffer})); }
+	return input;
+}
+
+file_retrieval_state from_args(const todds::args::data& args, todds::report_queue& updates, bool overwrite = false) {
 	const bool has_output = args.output.has_value();
-	const bool create_folders = has_output && !args.dry_run && !args.clean;
+	// Output folders are not needed when every DDS file goes into a pack file.
+	const bool create_folders = has_output && !args.dry_run && !args.clean && !args.pack.has_value();
+	// Existing DDS files do not prevent their PNG files from being added to a new pack file.
+	overwrite = overwrite || args.overwrite || args.pack.has_value();
 
 	if (!args.input.empty() && has_extension(args.input[0], txt_extension)) {
 		if (args.input.size() > 1U) {
@@ -203,12 +337,8 @@ file_retrieval_state from_args(const todds::args::data& args, todds::report_queu
 			updates.emplace(
 				todds::report_type::pipeline_error, "Output argument is not supported when processing a TXT file.");
 		}
-		todds::vector<boost::filesystem::path> input{};
-		boost::nowide::fstream stream{args.input[0]};
-		todds::string buffer;
-		while (std::getline(stream, buffer)) { input.push_back(fs::canonical(fs::path{buffer})); }
-		return {updates, input, std::optional<boost::filesystem::path>{}, args.format, create_folders, args.overwrite,
-			args.overwrite_new, args.substring, args.regex, args.depth};
+		return {updates, input_paths(args), std::optional<boost::filesystem::path>{}, args.format, create_folders,
+			overwrite, args.overwrite_new, args.substring, args.regex, args.depth};
 	}
 
 	std::optional<boost::filesystem::path> output = args.output;
@@ -218,15 +348,70 @@ file_retrieval_state from_args(const todds::args::data& args, todds::report_queu
 		output.reset();
 	}
 
-	return {updates, args.input, std::move(output), args.format, create_folders, args.overwrite, args.overwrite_new,
+	return {updates, args.input, std::move(output), args.format, create_folders, overwrite, args.overwrite_new,
 		args.substring, args.regex, args.depth};
 }
 
+// Predicts the cost of encoding a PNG file using the number of pixels stored in its header.
+std::uint64_t predicted_cost(const fs::path& png) {
+	// Cost of reading and writing each file, measured in pixels.
+	constexpr std::uint64_t file_cost = 64U * 64U;
+	// PNG signature, followed by the length, type, width and height of the IHDR chunk, which always comes first.
+	constexpr std::size_t header_size = 24U;
+	constexpr std::size_t ihdr_type_offset = 12U;
+	constexpr std::size_t width_offset = 16U;
+	constexpr std::size_t height_offset = 20U;
+
+	std::array<char, header_size> header{};
+	boost::nowide::ifstream stream{png, std::ios::in | std::ios::binary};
+	if (!stream.read(header.data(), header.size())) { return file_cost; }
+	constexpr std::string_view ihdr_type{"IHDR"};
+	if (std::string_view{header.data() + ihdr_type_offset, ihdr_type.size()} != ihdr_type) { return file_cost; }
+
+	const auto read_u32 = [&header](std::size_t offset) {
+		std::uint32_t value = 0U;
+		for (std::size_t index = offset; index < offset + 4U; ++index) {
+			value = (value << 8U) | static_cast<std::uint8_t>(header[index]);
+		}
+		return value;
+	};
+	return file_cost + std::uint64_t{read_u32(width_offset)} * read_u32(height_offset);
+}
+
 namespace todds {
 
 paths_vector get_paths(const todds::args::data& arguments, todds::report_queue& updates) {
 	file_retrieval_state state = from_args(arguments, updates);
-	return state.get_result();
+	// Shards are numbered from 1 in the arguments.
+	return state.get_result(arguments.shard_count > 1U ? arguments.shard - 1U : 0U, arguments.shard_count);
+}
+
+todds::vector<fs::path> get_input_paths(const todds::args::data& arguments) { return input_paths(arguments); }
+
+paths_vector get_changed_paths(
+	const todds::args::data& arguments, const todds::vector<fs::path>& changed, todds::report_queue& updates) {
+	// Changed files are always newer than their previous output.
+	file_retrieval_state state = from_args(arguments, updates, true);
+	return state.get_result(changed);
+}
+
+paths_vector get_shard(const paths_vector& paths, std::size_t shard, std::size_t shard_count) {
+	// Files are sorted by path, making shards independent of the order in which files were found.
+	todds::vector<std::size_t> order(paths.size());
+	std::iota(order.begin(), order.end(), std::size_t{0U});
+	std::sort(order.begin(), order.end(),
+		[&paths](std::size_t lhs, std::size_t rhs) { return paths[lhs].first < paths[rhs].first; });
+
+	todds::vector<std::uint64_t> costs(paths.size());
+	oneapi::tbb::parallel_for(std::size_t{0U}, paths.size(),
+		[&paths, &order, &costs](std::size_t index) { costs[index] = predicted_cost(paths[order[index]].first); });
+
+	const todds::vector<std::size_t> shards = todds::util::balance_shards(costs, shard_count);
+	paths_vector result;
+	for (std::size_t index = 0U; index < order.size(); ++index) {
+		if (shards[index] == shard) { result.push_back(paths[order[index]]); }
+	}
+	return result;
 }
 
 } // namespace todds
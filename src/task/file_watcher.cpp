@@ -0,0 +1,170 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "file_watcher.hpp"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/predef.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#if BOOST_OS_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif // BOOST_OS_LINUX
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+bool is_png(const fs::path& path) { return boost::algorithm::iequals(path.extension().string(), ".png"); }
+
+} // Anonymous namespace
+
+namespace todds {
+
+file_watcher::file_watcher(
+	const vector<fs::path>& input, std::optional<fs::path> output, std::size_t depth, report_queue& updates)
+	: _updates{updates}
+	, _output{std::move(output)}
+	, _descriptor{-1}
+	, _directories{} {
+#if BOOST_OS_LINUX
+	_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_descriptor < 0) {
+		_updates.emplace(
+			report_type::pipeline_error, fmt::format("Could not start watching files: {:s}", std::strerror(errno)));
+		return;
+	}
+
+	for (const fs::path& path : input) {
+		// Only the parent directory of input files is watched, without its subdirectories.
+		const bool is_directory = fs::is_directory(path);
+		add_directory({is_directory ? path : path.parent_path(), 0U, is_directory ? depth : 0U}, nullptr);
+	}
+#else
+	static_cast<void>(input);
+	static_cast<void>(depth);
+	_updates.emplace(report_type::pipeline_error, "Watching files is only supported on Linux.");
+#endif // BOOST_OS_LINUX
+}
+
+file_watcher::~file_watcher() {
+#if BOOST_OS_LINUX
+	if (_descriptor >= 0) { close(_descriptor); }
+#endif // BOOST_OS_LINUX
+}
+
+bool file_watcher::valid() const noexcept { return _descriptor >= 0 && !_directories.empty(); }
+
+vector<fs::path> file_watcher::wait_for_changes(const std::atomic<bool>& force_finish) {
+	vector<fs::path> changes;
+#if BOOST_OS_LINUX
+	while (!force_finish.load()) {
+		pollfd descriptor{_descriptor, POLLIN, 0};
+		const auto timeout = changes.empty() ? poll_time : debounce_time;
+		const int ready = poll(&descriptor, 1U, static_cast<int>(timeout.count()));
+		if (ready > 0) {
+			read_events(changes);
+		} else if (ready == 0 && !changes.empty()) {
+			break;
+		} else if (ready < 0 && errno != EINTR) {
+			_updates.emplace(
+				report_type::pipeline_error, fmt::format("Could not watch files: {:s}", std::strerror(errno)));
+			break;
+		}
+	}
+#endif // BOOST_OS_LINUX
+
+	if (force_finish.load()) { return {}; }
+	std::sort(changes.begin(), changes.end());
+	changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+	return changes;
+}
+
+bool file_watcher::is_output(const fs::path& directory) const {
+	boost::system::error_code error_code;
+	return _output.has_value() && fs::equivalent(directory, *_output, error_code);
+}
+
+void file_watcher::add_directory(const watched_directory& directory, vector<fs::path>* changes) {
+#if BOOST_OS_LINUX
+	// Outputs may be mirrored inside of an input directory. Writing them must not trigger a new encoding.
+	if (directory.depth > 0U && is_output(directory.path)) { return; }
+	constexpr std::uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+	const int watch = inotify_add_watch(_descriptor, directory.path.c_str(), mask);
+	if (watch < 0) {
+		_updates.emplace(report_type::pipeline_error,
+			fmt::format("Could not watch {:s}: {:s}", directory.path.string(), std::strerror(errno)));
+		return;
+	}
+	_directories.insert_or_assign(watch, directory);
+
+	try {
+		for (fs::directory_iterator itr{directory.path}; itr != fs::directory_iterator{}; ++itr) {
+			// Symbolic links are not followed, matching the retrieval of files.
+			if (fs::is_directory(itr->symlink_status())) {
+				if (directory.depth < directory.max_depth) {
+					add_directory({itr->path(), directory.depth + 1U, directory.max_depth}, changes);
+				}
+			} else if (changes != nullptr && is_png(itr->path())) {
+				changes->push_back(itr->path());
+			}
+		}
+	} catch (const fs::filesystem_error& error) { _updates.emplace(report_type::pipeline_error, error.what()); }
+#else
+	static_cast<void>(directory);
+	static_cast<void>(changes);
+#endif // BOOST_OS_LINUX
+}
+
+void file_watcher::read_events(vector<fs::path>& changes) {
+#if BOOST_OS_LINUX
+	alignas(inotify_event) std::array<char, 16384U> buffer{};
+	while (true) {
+		const ssize_t length = read(_descriptor, buffer.data(), buffer.size());
+		if (length <= 0) { break; }
+
+		std::size_t offset = 0U;
+		while (offset < static_cast<std::size_t>(length)) {
+			inotify_event event{};
+			std::memcpy(&event, buffer.data() + offset, sizeof(inotify_event));
+			const char* name = buffer.data() + offset + sizeof(inotify_event);
+			offset += sizeof(inotify_event) + event.len;
+
+			if ((event.mask & IN_Q_OVERFLOW) != 0U) {
+				_updates.emplace(report_type::pipeline_error, "Too many files changed at once. Some changes have been missed.");
+				continue;
+			}
+			if ((event.mask & IN_IGNORED) != 0U) {
+				_directories.erase(event.wd);
+				continue;
+			}
+
+			const auto directory = _directories.find(event.wd);
+			if (directory == _directories.end() || event.len == 0U) { continue; }
+			// Copy the watched directory, since adding subdirectories may invalidate the iterator.
+			const watched_directory parent = directory->second;
+			const fs::path path = parent.path / name;
+			if ((event.mask & IN_ISDIR) != 0U) {
+				if (parent.depth < parent.max_depth) { add_directory({path, parent.depth + 1U, parent.max_depth}, &changes); }
+			} else if ((event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0U && is_png(path)) {
+				changes.push_back(path);
+			}
+		}
+	}
+#else
+	static_cast<void>(changes);
+#endif // BOOST_OS_LINUX
+}
+
+} // namespace todds
@@ -0,0 +1,86 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/report.hpp"
+#include "todds/vector.hpp"
+
+#include <boost/filesystem/path.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <unordered_map>
+
+namespace todds {
+
+/**
+ * Reports PNG files written inside of the input paths. Only supported on Linux, where it uses inotify.
+ * Editors usually write a file in several steps, so changes are only reported after a burst of writes has finished.
+ * The output directory is never watched, so files written by todds itself are not reported.
+ */
+class file_watcher final {
+public:
+	/** A burst of writes is considered finished after this time passes without any new write. */
+	static constexpr std::chrono::milliseconds debounce_time{50};
+
+	/** Maximum time spent waiting for changes before checking if the watcher should finish. */
+	static constexpr std::chrono::milliseconds poll_time{100};
+
+	/**
+	 * Starts watching the input paths.
+	 * @param input Input files and directories. Files are watched through their parent directory.
+	 * @param output Output directory. Ignored if it is one of the input directories.
+	 * @param depth Maximum subdirectory depth to watch inside of input directories.
+	 * @param updates Errors are reported using this queue.
+	 */
+	file_watcher(const vector<boost::filesystem::path>& input, std::optional<boost::filesystem::path> output,
+		std::size_t depth, report_queue& updates);
+	file_watcher(const file_watcher&) = delete;
+	file_watcher(file_watcher&&) noexcept = delete;
+	file_watcher& operator=(const file_watcher&) = delete;
+	file_watcher& operator=(file_watcher&&) noexcept = delete;
+	~file_watcher();
+
+	/**
+	 * Checks if the watcher has been started successfully.
+	 * @return False if file changes cannot be watched on this system.
+	 */
+	[[nodiscard]] bool valid() const noexcept;
+
+	/**
+	 * Waits until PNG files have been written and no other writes happen during debounce_time.
+	 * @param force_finish Stops waiting as soon as it is set to true.
+	 * @return PNG files that have been written, without duplicates. Empty if force_finish has been set.
+	 */
+	[[nodiscard]] vector<boost::filesystem::path> wait_for_changes(const std::atomic<bool>& force_finish);
+
+private:
+	struct watched_directory {
+		boost::filesystem::path path;
+		// Subdirectory depth of the directory inside of its input directory.
+		std::size_t depth;
+		// Subdirectories are only watched up to this depth.
+		std::size_t max_depth;
+	};
+
+	// Watches a directory and its subdirectories up to their maximum depth. If changes is not null, PNG files already in
+	// them are added to it, as they may have been written before the watch started.
+	void add_directory(const watched_directory& directory, vector<boost::filesystem::path>* changes);
+
+	// Checks if a directory is the output directory. It may not exist yet when the watcher starts.
+	[[nodiscard]] bool is_output(const boost::filesystem::path& directory) const;
+
+	// Reads every pending event, adding written PNG files to changes.
+	void read_events(vector<boost::filesystem::path>& changes);
+
+	report_queue& _updates;
+	std::optional<boost::filesystem::path> _output;
+	int _descriptor;
+	std::unordered_map<int, watched_directory> _directories;
+};
+
+} // namespace todds
@@ -11,6 +11,42 @@
 
 namespace todds {
 
+/**
+ * PNG files which must be encoded according to the arguments, and their destination paths.
+ * When sharding is enabled, files are split between shards before skipping those whose output is up-to-date. Every
+ * process obtains the same split even if other shards have already written some of their outputs.
+ * @param arguments Arguments provided by the user.
+ * @param updates Errors are reported using this queue.
+ * @return Files which must be encoded, and their destination paths.
+ */
 pipeline::paths_vector get_paths(const todds::args::data& arguments, todds::report_queue& updates);
 
+/**
+ * Input files and directories, including those listed in a TXT input file.
+ * @param arguments Arguments provided by the user.
+ * @return Input paths.
+ */
+todds::vector<boost::filesystem::path> get_input_paths(const todds::args::data& arguments);
+
+/**
+ * Applies the criteria of get_paths to PNG files which have been written after calling it.
+ * @param arguments Arguments provided by the user.
+ * @param changed PNG files which have changed.
+ * @param updates Errors are reported using this queue.
+ * @return Changed files which must be encoded, and their destination paths. Existing output files are overwritten.
+ */
+pipeline::paths_vector get_changed_paths(const todds::args::data& arguments,
+	const todds::vector<boost::filesystem::path>& changed, todds::report_queue& updates);
+
+/**
+ * Files processed by one of several processes splitting the same files between them.
+ * Files are balanced between shards using the size of each image, read from the header of its PNG file. Processes
+ * receiving the same files obtain the same shards, regardless of the order in which files were found.
+ * @param paths Files to split.
+ * @param shard Shard processed by the caller, from zero to shard_count - 1.
+ * @param shard_count Number of shards.
+ * @return Files of the shard, sorted by path.
+ */
+pipeline::paths_vector get_shard(const pipeline::paths_vector& paths, std::size_t shard, std::size_t shard_count);
+
 } // namespace todds
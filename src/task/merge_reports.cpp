@@ -0,0 +1,151 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "merge_reports.hpp"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Columns at the start of every report. The rest of the columns depend on the options used to create the report.
+constexpr std::string_view report_header{"File;Width;Height;Mipmaps;Format"};
+
+todds::vector<std::string_view> split_columns(std::string_view line) {
+	todds::vector<std::string_view> columns;
+	std::size_t start = 0U;
+	while (true) {
+		const std::size_t end = line.find(';', start);
+		columns.emplace_back(line.substr(start, end - start));
+		if (end == std::string_view::npos) { break; }
+		start = end + 1U;
+	}
+	return columns;
+}
+
+// Returns the number of columns if the column is missing.
+std::size_t column_index(const todds::vector<std::string_view>& columns, std::string_view name) {
+	return static_cast<std::size_t>(std::find(columns.cbegin(), columns.cend(), name) - columns.cbegin());
+}
+
+todds::vector<fs::path> report_files(const todds::vector<fs::path>& input) {
+	todds::vector<fs::path> files;
+	for (const fs::path& path : input) {
+		if (!fs::is_directory(path)) {
+			files.push_back(path);
+			continue;
+		}
+		for (fs::directory_iterator itr{path}; itr != fs::directory_iterator{}; ++itr) {
+			if (fs::is_regular_file(itr->status()) && boost::algorithm::iequals(itr->path().extension().string(), ".csv")) {
+				files.push_back(itr->path());
+			}
+		}
+	}
+	// Reports are merged in the same order on every system.
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+} // Anonymous namespace
+
+namespace todds {
+
+void merge_reports(const vector<fs::path>& input, report_queue& updates) {
+	const vector<fs::path> files = report_files(input);
+	std::string header;
+	std::size_t merged = 0U;
+	std::size_t duplicated = 0U;
+	// Rows of every report indexed by their DDS file, which sorts the merged report.
+	std::map<std::string, std::string> rows;
+
+	for (const fs::path& file : files) {
+		boost::nowide::ifstream stream{file};
+		std::string line;
+		std::size_t columns = 0U;
+		while (std::getline(stream, line)) {
+			if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+			if (line.starts_with(report_header)) {
+				if (!header.empty() && line != header) {
+					updates.emplace(report_type::pipeline_error,
+						fmt::format("{:s} has different columns than the previous reports. Skipping it.", file.string()));
+					break;
+				}
+				header = line;
+				columns = split_columns(line).size();
+				++merged;
+				continue;
+			}
+
+			const auto values = split_columns(line);
+			if (columns == 0U || values.size() != columns) { continue; }
+			if (!rows.emplace(std::string{values.front()}, line).second) { ++duplicated; }
+		}
+	}
+
+	if (header.empty()) {
+		updates.emplace(report_type::pipeline_error, "No reports have been found.");
+		return;
+	}
+
+	const auto header_columns = split_columns(header);
+	const std::size_t format_column = column_index(header_columns, "Format");
+	const std::size_t psnr_column = column_index(header_columns, "PSNR");
+	const std::size_t ssim_column = column_index(header_columns, "SSIM");
+	const std::size_t error_column = column_index(header_columns, "Error");
+	updates.emplace(report_type::file_report, string{header});
+
+	std::map<std::string, std::size_t> formats;
+	std::size_t failed = 0U;
+	std::size_t measured = 0U;
+	std::size_t lossy = 0U;
+	double psnr_sum = 0.0;
+	double ssim_sum = 0.0;
+	for (const auto& [_, row] : rows) {
+		updates.emplace(report_type::file_report, string{row});
+		const auto values = split_columns(row);
+		if (error_column < values.size() && !values[error_column].empty()) {
+			++failed;
+			continue;
+		}
+		++formats[std::string{values[format_column]}];
+		if (ssim_column >= values.size() || psnr_column >= values.size()) { continue; }
+		const double psnr = std::strtod(std::string{values[psnr_column]}.c_str(), nullptr);
+		const double ssim = std::strtod(std::string{values[ssim_column]}.c_str(), nullptr);
+		++measured;
+		ssim_sum += ssim;
+		if (std::isfinite(psnr)) {
+			++lossy;
+			psnr_sum += psnr;
+		}
+	}
+
+	string summary = fmt::format("Merged {:d} reports with {:d} files.", merged, rows.size());
+	for (const auto& [format, count] : formats) { summary += fmt::format(" {:s}: {:d}.", format, count); }
+	if (failed > 0U) { summary += fmt::format(" Failed: {:d}.", failed); }
+	if (measured > 0U) {
+		summary += fmt::format(" Mean PSNR {:.2f} dB, mean SSIM {:.4f}.",
+			lossy > 0U ? psnr_sum / static_cast<double>(lossy) : std::numeric_limits<double>::infinity(),
+			ssim_sum / static_cast<double>(measured));
+	}
+	updates.emplace(report_type::statistics, std::move(summary));
+	if (duplicated > 0U) {
+		updates.emplace(report_type::pipeline_error,
+			fmt::format("{:d} files appear in several reports. Only their first row has been kept.", duplicated));
+	}
+}
+
+} // namespace todds
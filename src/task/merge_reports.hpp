@@ -0,0 +1,23 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/report.hpp"
+#include "todds/vector.hpp"
+
+#include <boost/filesystem/path.hpp>
+
+namespace todds {
+
+/**
+ * Merges the reports printed by --report when encoding each shard, and sends the merged report followed by a summary.
+ * Lines printed before or after the report itself are ignored, so reports can be taken directly from the output.
+ * @param input Report files, or directories containing report files with the .csv extension.
+ * @param updates Rows of the merged report, errors and the summary are reported using this queue.
+ */
+void merge_reports(const vector<boost::filesystem::path>& input, report_queue& updates);
+
+} // namespace todds
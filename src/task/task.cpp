@@ -10,6 +10,11 @@
 
 #include <oneapi/tbb/tick_count.h>
 
+#include <memory>
+
+#include "file_watcher.hpp"
+#include "merge_reports.hpp"
+
 namespace fs = boost::filesystem;
 using todds::pipeline::paths_vector;
 
@@ -25,8 +30,37 @@ void clean_dds_files(const paths_vector& files) {
 	for (const auto& [_, dds_file] : files) { fs::remove(dds_file); }
 }
 
+// Encodes PNG files as soon as they are written, until force_finish is set.
+void watch_files(const todds::args::data& arguments, todds::file_watcher& watcher, todds::pipeline::input& input_data,
+	std::atomic<bool>& force_finish, todds::report_queue& updates) {
+	if (!watcher.valid()) { return; }
+	updates.emplace(todds::report_type::statistics, "Watching for changes. Press Ctrl+C to stop.");
+
+	while (!force_finish.load()) {
+		const auto changed = watcher.wait_for_changes(force_finish);
+		if (changed.empty()) { continue; }
+		input_data.paths = todds::get_changed_paths(arguments, changed, updates);
+		if (input_data.paths.empty()) { continue; }
+		if (arguments.verbose) { verbose_output(input_data.paths, false, updates); }
+		updates.emplace(todds::report_type::process_started, input_data.paths.size());
+		todds::pipeline::encode_as_dds(input_data, force_finish, updates);
+	}
+}
+
 void pipeline_execution(
 	const todds::args::data& arguments, std::atomic<bool>& force_finish, todds::report_queue& updates) {
+	if (arguments.merge_reports) {
+		todds::merge_reports(arguments.input, updates);
+		return;
+	}
+
+	// The watcher starts before retrieving files, so files written during the first run are encoded again after it.
+	std::unique_ptr<todds::file_watcher> watcher{};
+	if (arguments.watch) {
+		watcher = std::make_unique<todds::file_watcher>(
+			todds::get_input_paths(arguments), arguments.output, arguments.depth, updates);
+	}
+
 	todds::pipeline::input input_data;
 	updates.emplace(todds::report_type::retrieving_files_started);
 
@@ -45,7 +79,7 @@ void pipeline_execution(
 	if (arguments.verbose) { verbose_output(input_data.paths, arguments.clean, updates); }
 	if (arguments.dry_run) { return; }
 	updates.emplace(todds::report_type::process_started, input_data.paths.size());
-	if (input_data.paths.empty()) { return; }
+	if (input_data.paths.empty() && !arguments.watch) { return; }
 
 	if (arguments.clean) {
 		clean_dds_files(input_data.paths);
@@ -56,6 +90,7 @@ void pipeline_execution(
 	input_data.mipmaps = arguments.mipmaps;
 	input_data.format = arguments.format;
 	input_data.alpha_format = arguments.alpha_format;
+	input_data.grayscale_format = arguments.grayscale_format;
 	input_data.quality = arguments.quality;
 	input_data.fix_size = arguments.fix_size;
 	input_data.vflip = arguments.vflip;
@@ -67,9 +102,28 @@ void pipeline_execution(
 	input_data.progress = arguments.progress;
 	input_data.alpha_black = arguments.alpha_black;
 	input_data.report = arguments.report;
+	input_data.block_cache = arguments.block_cache;
+	input_data.block_cache_size = arguments.block_cache_size;
+	input_data.transparent_blocks = arguments.transparent_blocks;
+	if (arguments.adaptive_quality.has_value()) {
+		input_data.complexity_threshold = static_cast<float>(arguments.adaptive_threshold);
+		input_data.low_complexity_quality = *arguments.adaptive_quality;
+	}
+	input_data.rdo_lambda = static_cast<float>(arguments.rdo_lambda);
+	if (arguments.fast_pass.has_value()) {
+		input_data.refine_psnr = arguments.fast_pass_psnr;
+		input_data.fast_pass_quality = *arguments.fast_pass;
+	}
+	input_data.cpu_target = arguments.cpu_target;
+	input_data.quality_metrics = arguments.quality_metrics;
+	input_data.stats = arguments.stats;
+	input_data.watch = arguments.watch;
+	input_data.pack = arguments.pack;
+	input_data.skip_unchanged = arguments.skip_unchanged;
 
 	// Launch the parallel pipeline.
-	todds::pipeline::encode_as_dds(input_data, force_finish, updates);
+	if (!input_data.paths.empty()) { todds::pipeline::encode_as_dds(input_data, force_finish, updates); }
+	if (watcher != nullptr) { watch_files(arguments, *watcher, input_data, force_finish, updates); }
 }
 
 } // anonymous namespace
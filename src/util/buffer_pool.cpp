@@ -0,0 +1,177 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/buffer_pool.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <mutex>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using todds::buffer_pool::minimum_size;
+
+// Position of the highest bit set in a value larger than zero.
+// std::countl_zero always returns int, unlike std::bit_width, whose return type depends on the standard library.
+constexpr std::size_t highest_bit(std::size_t value) noexcept {
+	return static_cast<std::size_t>(std::numeric_limits<std::size_t>::digits - std::countl_zero(value)) - 1U;
+}
+
+// Each power of two is split into this number of size classes, limiting the wasted memory to 25%.
+constexpr std::size_t classes_per_power = 4U;
+constexpr std::size_t minimum_exponent = highest_bit(minimum_size - 1U);
+constexpr std::size_t class_count = (64U - minimum_exponent) * classes_per_power;
+
+// Buffers are kept separately for each NUMA node, since their pages stay in the node which touched them first.
+constexpr std::size_t max_numa_nodes = 8U;
+
+std::size_t current_numa_node() noexcept {
+#if defined(__linux__)
+	unsigned int cpu{};
+	unsigned int node{};
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) { return node % max_numa_nodes; }
+#endif
+	return 0U;
+}
+
+struct size_class {
+	std::size_t index;
+	std::size_t bytes;
+};
+
+size_class get_size_class(std::size_t bytes) noexcept {
+	assert(bytes >= minimum_size);
+	// 2^exponent < bytes <= 2^(exponent + 1).
+	const std::size_t exponent = highest_bit(bytes - 1U);
+	const std::size_t base = std::size_t{1U} << exponent;
+	const std::size_t step = base / classes_per_power;
+	const std::size_t sub_class = (bytes - base + step - 1U) / step;
+	return {(exponent - minimum_exponent) * classes_per_power + sub_class - 1U, base + sub_class * step};
+}
+
+struct bucket {
+	std::mutex mutex;
+	std::vector<void*> buffers;
+};
+
+class pool final {
+public:
+	pool() = default;
+	pool(const pool&) = delete;
+	pool(pool&&) noexcept = delete;
+	pool& operator=(const pool&) = delete;
+	pool& operator=(pool&&) noexcept = delete;
+	~pool() = default;
+
+	void* rent(std::size_t bytes) {
+		const size_class cls = get_size_class(bytes);
+		_rented.fetch_add(1U, std::memory_order_relaxed);
+		{
+			bucket& bkt = _buckets[current_numa_node()][cls.index];
+			const std::lock_guard lock{bkt.mutex};
+			if (!bkt.buffers.empty()) {
+				void* buffer = bkt.buffers.back();
+				bkt.buffers.pop_back();
+				_cached_bytes.fetch_sub(cls.bytes, std::memory_order_relaxed);
+				_reused.fetch_add(1U, std::memory_order_relaxed);
+				return buffer;
+			}
+		}
+		return todds::aligned_allocate(cls.bytes);
+	}
+
+	void release(void* buffer, std::size_t bytes) noexcept {
+		const size_class cls = get_size_class(bytes);
+		if (_cached_bytes.fetch_add(cls.bytes, std::memory_order_relaxed) + cls.bytes <= _capacity) {
+			bucket& bkt = _buckets[current_numa_node()][cls.index];
+			try {
+				const std::lock_guard lock{bkt.mutex};
+				bkt.buffers.push_back(buffer);
+				return;
+			} catch (...) {
+				// The buffer is freed below if it cannot be stored.
+			}
+		}
+		_cached_bytes.fetch_sub(cls.bytes, std::memory_order_relaxed);
+		_discarded.fetch_add(1U, std::memory_order_relaxed);
+		todds::aligned_deallocate(buffer, cls.bytes);
+	}
+
+	void set_capacity(std::size_t bytes) {
+		_capacity = bytes;
+		if (_cached_bytes.load(std::memory_order_relaxed) > _capacity) { trim(); }
+	}
+
+	void trim() {
+		for (auto& node_buckets : _buckets) {
+			for (std::size_t index = 0U; index < class_count; ++index) {
+				bucket& bkt = node_buckets[index];
+				const std::lock_guard lock{bkt.mutex};
+				if (bkt.buffers.empty()) { continue; }
+				// Every buffer of the bucket has the size of the class.
+				const std::size_t exponent = minimum_exponent + index / classes_per_power;
+				const std::size_t base = std::size_t{1U} << exponent;
+				const std::size_t bytes = base + (index % classes_per_power + 1U) * (base / classes_per_power);
+				for (void* buffer : bkt.buffers) {
+					todds::aligned_deallocate(buffer, bytes);
+					_cached_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+				}
+				bkt.buffers.clear();
+				bkt.buffers.shrink_to_fit();
+			}
+		}
+	}
+
+	todds::buffer_pool::statistics get_statistics() const noexcept {
+		return {_rented.load(std::memory_order_relaxed), _reused.load(std::memory_order_relaxed),
+			_discarded.load(std::memory_order_relaxed), _cached_bytes.load(std::memory_order_relaxed)};
+	}
+
+	void reset_statistics() noexcept {
+		_rented.store(0U, std::memory_order_relaxed);
+		_reused.store(0U, std::memory_order_relaxed);
+		_discarded.store(0U, std::memory_order_relaxed);
+	}
+
+private:
+	std::array<std::array<bucket, class_count>, max_numa_nodes> _buckets{};
+	std::atomic<std::size_t> _capacity{todds::buffer_pool::default_capacity};
+	std::atomic<std::size_t> _cached_bytes{};
+	std::atomic<std::size_t> _rented{};
+	std::atomic<std::size_t> _reused{};
+	std::atomic<std::size_t> _discarded{};
+};
+
+pool& global_pool() {
+	// Never destroyed, since static objects may still return buffers to the pool during shutdown.
+	static pool* instance = new pool{};
+	return *instance;
+}
+
+} // Anonymous namespace
+
+namespace todds::buffer_pool {
+
+void* rent(std::size_t bytes) { return global_pool().rent(bytes); }
+
+void release(void* buffer, std::size_t bytes) noexcept { global_pool().release(buffer, bytes); }
+
+void set_capacity(std::size_t bytes) { global_pool().set_capacity(bytes); }
+
+void trim() { global_pool().trim(); }
+
+statistics get_statistics() noexcept { return global_pool().get_statistics(); }
+
+void reset_statistics() noexcept { global_pool().reset_statistics(); }
+
+} // namespace todds::buffer_pool
@@ -0,0 +1,97 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "todds/memory.hpp"
+
+namespace todds::buffer_pool {
+
+/** Allocations smaller than this number of bytes do not use the pool. */
+constexpr std::size_t minimum_size = 64ULL * 1024ULL;
+
+/** Maximum number of bytes kept by the pool by default. */
+constexpr std::size_t default_capacity = 512ULL * 1024ULL * 1024ULL;
+
+/** Usage of the pool since the last call to reset_statistics. */
+struct statistics {
+	/** Allocations served by the pool. */
+	std::size_t rented{};
+	/** Allocations served with a buffer returned previously. */
+	std::size_t reused{};
+	/** Buffers freed because the pool was full. */
+	std::size_t discarded{};
+	/** Bytes currently kept by the pool. */
+	std::size_t cached_bytes{};
+};
+
+/**
+ * Obtains a buffer of at least the requested size.
+ * Buffers are grouped in size classes. A buffer returned to the pool can be rented again by any request of its class.
+ * @param bytes Size of the buffer. Must be at least minimum_size.
+ * @return Buffer aligned to buffer_alignment. Must be returned with release using the same size.
+ */
+[[nodiscard]] void* rent(std::size_t bytes);
+
+/**
+ * Returns a buffer to the pool. If the pool is full, its memory is freed instead.
+ * @param buffer Buffer obtained from rent.
+ * @param bytes Size used to rent the buffer.
+ */
+void release(void* buffer, std::size_t bytes) noexcept;
+
+/**
+ * Sets the maximum number of bytes kept by the pool. Buffers exceeding it are freed.
+ * @param bytes Capacity of the pool.
+ */
+void set_capacity(std::size_t bytes);
+
+/** Frees every buffer kept by the pool. */
+void trim();
+
+[[nodiscard]] statistics get_statistics() noexcept;
+
+void reset_statistics() noexcept;
+
+/**
+ * Buffer allocator serving large allocations from the buffer pool.
+ * Used by image buffers, which are allocated and freed for every file going through the pipeline.
+ */
+template<typename Type> class pooled_allocator : public buffer_allocator<Type> {
+public:
+	using value_type = Type;
+
+	constexpr pooled_allocator() noexcept = default;
+
+	template<typename Other> constexpr explicit pooled_allocator(const pooled_allocator<Other>& /*other*/) noexcept {}
+
+	[[nodiscard]] Type* allocate(std::size_t count) {
+		const std::size_t bytes = count * sizeof(Type);
+		if (bytes < minimum_size) { return static_cast<Type*>(aligned_allocate(bytes)); }
+		return static_cast<Type*>(rent(bytes));
+	}
+
+	void deallocate(Type* memory, std::size_t count) noexcept {
+		const std::size_t bytes = count * sizeof(Type);
+		if (bytes < minimum_size) {
+			aligned_deallocate(memory, bytes);
+			return;
+		}
+		release(memory, bytes);
+	}
+};
+
+template<typename Type, typename Other>
+[[nodiscard]] constexpr bool operator==(const pooled_allocator<Type>& /*lhs*/, const pooled_allocator<Other>& /*rhs*/) {
+	return true;
+}
+
+/** Buffer using the pool for large allocations. Its elements are not initialized when it is resized. */
+template<typename Type> using vector = std::vector<Type, pooled_allocator<Type>>;
+
+} // namespace todds::buffer_pool
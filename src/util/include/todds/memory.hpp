@@ -9,7 +9,12 @@
 #include <tracy/Tracy.hpp>
 #endif
 
+#include <cstddef>
+#include <cstdlib>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 #if defined(TODDS_TBB_ALLOCATOR)
 #include <oneapi/tbb/scalable_allocator.h>
@@ -90,4 +95,121 @@ template<typename T1, typename T2>
 template<typename Type> using allocator = std::allocator<Type>;
 #endif
 
+/** Alignment of image buffers. Matches the size of a cache line and of an AVX-512 register. */
+constexpr std::size_t buffer_alignment = 64U;
+
+#if defined(TODDS_HUGE_PAGES)
+/** Allocations of at least this size are backed by huge pages. */
+constexpr std::size_t huge_page_size = 2U * 1024U * 1024U;
+
+namespace impl {
+/**
+ * Maps memory backed by explicit huge pages if the system has reserved them, or by transparent huge pages otherwise.
+ * Pages are not touched, so the kernel places them in the NUMA node of the thread writing them first.
+ * @param bytes Size of the allocation.
+ * @return Memory aligned to huge_page_size, or nullptr if it could not be mapped.
+ */
+[[nodiscard]] void* huge_page_allocate(std::size_t bytes) noexcept;
+
+void huge_page_deallocate(void* memory, std::size_t bytes) noexcept;
+} // namespace impl
+#endif // defined(TODDS_HUGE_PAGES)
+
+/**
+ * Allocates memory aligned to buffer_alignment with the memory allocator used by todds.
+ * Terminates on allocation failure.
+ * @param bytes Size of the allocation.
+ * @return Allocated memory. Must be freed with aligned_deallocate.
+ */
+[[nodiscard]] inline void* aligned_allocate(std::size_t bytes) noexcept {
+#if defined(TODDS_HUGE_PAGES)
+	if (bytes >= huge_page_size) {
+		void* huge_memory = impl::huge_page_allocate(bytes);
+		if (huge_memory == nullptr) [[unlikely]] { std::abort(); }
+#if defined(TRACY_ENABLE)
+		TracyAlloc(huge_memory, bytes);
+#endif
+		return huge_memory;
+	}
+#endif // defined(TODDS_HUGE_PAGES)
+#if defined(TODDS_TBB_ALLOCATOR)
+	void* memory = scalable_aligned_malloc(bytes, buffer_alignment);
+#elif defined(TODDS_MIMALLOC_ALLOCATOR)
+	void* memory = mi_malloc_aligned(bytes, buffer_alignment);
+#else
+	void* memory = ::operator new(bytes, std::align_val_t{buffer_alignment}, std::nothrow);
+#endif
+	if (memory == nullptr) [[unlikely]] { std::abort(); }
+#if defined(TRACY_ENABLE)
+	TracyAlloc(memory, bytes);
+#endif
+	return memory;
+}
+
+/**
+ * Frees memory allocated with aligned_allocate.
+ * @param memory Memory to free.
+ * @param bytes Size used to allocate the memory.
+ */
+inline void aligned_deallocate(void* memory, [[maybe_unused]] std::size_t bytes) noexcept {
+#if defined(TRACY_ENABLE)
+	TracyFree(memory);
+#endif
+#if defined(TODDS_HUGE_PAGES)
+	if (bytes >= huge_page_size) {
+		impl::huge_page_deallocate(memory, bytes);
+		return;
+	}
+#endif // defined(TODDS_HUGE_PAGES)
+#if defined(TODDS_TBB_ALLOCATOR)
+	scalable_aligned_free(memory);
+#elif defined(TODDS_MIMALLOC_ALLOCATOR)
+	mi_free(memory);
+#else
+	::operator delete(memory, bytes, std::align_val_t{buffer_alignment});
+#endif
+}
+
+/** @brief Allocator for image buffers.
+ *
+ * Memory is aligned to buffer_alignment. Elements constructed without arguments are default-initialized instead of
+ * value-initialized, so resizing a vector of trivial types does not fill it with zeros. Users must write every element
+ * before reading it.
+ */
+template<typename Type> class buffer_allocator {
+public:
+	/** @brief Value type being allocated by this allocator. */
+	using value_type = Type;
+
+	/** @brief Default constructor. */
+	constexpr buffer_allocator() noexcept = default;
+
+	/** @brief Allow rebinding the allocator to other types. */
+	template<typename Other> constexpr explicit buffer_allocator(const buffer_allocator<Other>& /*other*/) noexcept {}
+
+	/** @brief Allocates aligned memory for count instances of Type. */
+	[[nodiscard]] Type* allocate(std::size_t count) noexcept {
+		return static_cast<Type*>(aligned_allocate(count * sizeof(Type)));
+	}
+
+	/** @brief Deallocates the memory of count instances of Type. */
+	void deallocate(Type* memory, std::size_t count) noexcept { aligned_deallocate(memory, count * sizeof(Type)); }
+
+	/** @brief Default-initializes an element. */
+	template<typename Other> void construct(Other* element) noexcept(std::is_nothrow_default_constructible_v<Other>) {
+		::new (static_cast<void*>(element)) Other;
+	}
+
+	/** @brief Constructs an element from the provided arguments. */
+	template<typename Other, typename... Args> void construct(Other* element, Args&&... args) {
+		::new (static_cast<void*>(element)) Other(std::forward<Args>(args)...);
+	}
+};
+
+/** @brief Equality comparison operator. */
+template<typename T1, typename T2>
+[[nodiscard]] constexpr bool operator==(const buffer_allocator<T1>& /* lh */, const buffer_allocator<T2>& /* rh */) {
+	return true;
+}
+
 } // namespace todds
@@ -0,0 +1,26 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/vector.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace todds::util {
+
+/**
+ * Splits items between shards, balancing the total cost of each shard.
+ * Items are assigned from the most to the least expensive one to the shard with the lowest total cost. Ties are
+ * broken using the position of items and shards, so every process receiving the same costs obtains the same shards.
+ * @param costs Predicted cost of each item.
+ * @param shard_count Number of shards. Must be larger than zero.
+ * @return Shard of each item, from zero to shard_count - 1.
+ */
+[[nodiscard]] vector<std::size_t> balance_shards(std::span<const std::uint64_t> costs, std::size_t shard_count);
+
+} // namespace todds::util
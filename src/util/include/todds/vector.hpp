@@ -14,4 +14,7 @@ namespace todds {
 /** Vector to use in todds types. */
 template<typename Type, typename Allocator = todds::allocator<Type>> using vector = std::vector<Type, Allocator>;
 
+/** Aligned vector which does not initialize its elements when resized. Used for image data. */
+template<typename Type> using buffer = std::vector<Type, buffer_allocator<Type>>;
+
 } // namespace todds
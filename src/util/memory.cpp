@@ -0,0 +1,51 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/memory.hpp"
+
+#if defined(TODDS_HUGE_PAGES)
+
+#include <sys/mman.h>
+
+#include <cstdint>
+
+namespace {
+
+constexpr std::size_t round_to_huge_pages(std::size_t bytes) noexcept {
+	return (bytes + todds::huge_page_size - 1U) / todds::huge_page_size * todds::huge_page_size;
+}
+
+void* map_memory(std::size_t bytes, int flags) noexcept {
+	void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+	return memory != MAP_FAILED ? memory : nullptr;
+}
+
+} // Anonymous namespace
+
+namespace todds::impl {
+
+void* huge_page_allocate(std::size_t bytes) noexcept {
+	const std::size_t size = round_to_huge_pages(bytes);
+	// Explicit huge pages are only available if the administrator has reserved them.
+	if (void* memory = map_memory(size, MAP_HUGETLB); memory != nullptr) { return memory; }
+
+	// Transparent huge pages can only back memory aligned to the huge page size. Map an extra huge page and unmap the
+	// unaligned memory at both ends.
+	auto* mapping = static_cast<std::uint8_t*>(map_memory(size + huge_page_size, 0));
+	if (mapping == nullptr) { return nullptr; }
+	const auto address = reinterpret_cast<std::uintptr_t>(mapping);
+	const std::size_t head = (huge_page_size - address % huge_page_size) % huge_page_size;
+	if (head > 0U) { munmap(mapping, head); }
+	std::uint8_t* memory = mapping + head;
+	munmap(memory + size, huge_page_size - head);
+	madvise(memory, size, MADV_HUGEPAGE);
+	return memory;
+}
+
+void huge_page_deallocate(void* memory, std::size_t bytes) noexcept { munmap(memory, round_to_huge_pages(bytes)); }
+
+} // namespace todds::impl
+
+#endif // defined(TODDS_HUGE_PAGES)
@@ -0,0 +1,39 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/shard.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <utility>
+
+namespace todds::util {
+
+vector<std::size_t> balance_shards(std::span<const std::uint64_t> costs, std::size_t shard_count) {
+	assert(shard_count > 0U);
+	vector<std::size_t> order(costs.size());
+	std::iota(order.begin(), order.end(), std::size_t{0U});
+	std::stable_sort(
+		order.begin(), order.end(), [costs](std::size_t lhs, std::size_t rhs) { return costs[lhs] > costs[rhs]; });
+
+	// Total cost and index of each shard. The shard with the lowest cost, and then the lowest index, is on top.
+	using shard_load = std::pair<std::uint64_t, std::size_t>;
+	std::priority_queue<shard_load, vector<shard_load>, std::greater<>> loads;
+	for (std::size_t shard = 0U; shard < shard_count; ++shard) { loads.emplace(0U, shard); }
+
+	vector<std::size_t> shards(costs.size());
+	for (const std::size_t item : order) {
+		auto [load, shard] = loads.top();
+		loads.pop();
+		shards[item] = shard;
+		loads.emplace(load + costs[item], shard);
+	}
+	return shards;
+}
+
+} // namespace todds::util
@@ -4,6 +4,8 @@
  */
 
 #include "todds/arguments.hpp"
+#include "todds/cache.hpp"
+#include "todds/cpu.hpp"
 #include "todds/format.hpp"
 #include "todds/project.hpp"
 
@@ -208,6 +210,50 @@ TEST_CASE("todds::arguments alpha_format", "[arguments]") {
 	}
 }
 
+TEST_CASE("todds::arguments BC4 and BC5 formats", "[arguments]") {
+	using todds::format::type;
+
+	SECTION("Parsing BC4 format.") {
+		const auto arguments = get({binary, "--format", "bc4", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.format == type::bc4);
+	}
+
+	SECTION("Parsing BC5 format.") {
+		const auto arguments = get({binary, "-f", "Bc5", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.format == type::bc5);
+	}
+
+	SECTION("BC4 and BC5 cannot be used as alpha formats.") {
+		REQUIRE(has_error(get({binary, "--alpha-format", "bc4", "."})));
+		REQUIRE(has_error(get({binary, "--alpha-format", "bc5", "."})));
+	}
+}
+
+TEST_CASE("todds::arguments grayscale_format", "[arguments]") {
+	using todds::format::type;
+
+	SECTION("The default value of grayscale_format is invalid.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.grayscale_format == type::invalid);
+	}
+
+	SECTION("Parsing a valid grayscale format.") {
+		const auto arguments = get({binary, "--grayscale-format", "bc4", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.grayscale_format == type::bc4);
+		const auto shorter = get({binary, "-gf", "BC1", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.grayscale_format == type::bc1);
+	}
+
+	SECTION("Parsing invalid grayscale formats results in an error.") {
+		REQUIRE(has_error(get({binary, "--grayscale-format", "png", "."})));
+		REQUIRE(has_error(get({binary, "--grayscale-format", "invalid", "."})));
+	}
+}
+
 TEST_CASE("todds::arguments PNG format", "[arguments]") {
 	using todds::format::type;
 
@@ -715,6 +761,35 @@ TEST_CASE("todds::arguments regex", "[arguments]") {
 #endif // defined(TODDS_REGULAR_EXPRESSIONS)
 }
 
+TEST_CASE("todds::arguments exclude", "[arguments]") {
+#if defined(TODDS_REGULAR_EXPRESSIONS)
+	SECTION("Several include and exclude patterns are compiled together.") {
+		const auto arguments =
+			get({binary, "--regex", "Textures", "-r", "UI", "--exclude", "Source", "-ex", "\\.git", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.regex.valid());
+		REQUIRE(arguments.regex.has_include());
+	}
+
+	SECTION("Exclude patterns do not require include patterns.") {
+		const auto arguments = get({binary, "--exclude", "Source", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.regex.valid());
+		REQUIRE(!arguments.regex.has_include());
+	}
+
+	SECTION("Compilation errors of exclude patterns are reported.") {
+		const auto arguments = get({binary, "--regex", "Textures", "--exclude", "(()", "."});
+		REQUIRE(has_error(arguments));
+		REQUIRE(!arguments.regex.error().empty());
+	}
+#else
+	SECTION("Exclude is not a valid argument without Hyperscan support") {
+		REQUIRE(has_error(get({binary, "--exclude", "Source", "."})));
+	}
+#endif // defined(TODDS_REGULAR_EXPRESSIONS)
+}
+
 TEST_CASE("todds::arguments substring", "[substring]") {
 	SECTION("The default value of substring is an empty string") {
 		const auto arguments = get({binary, "."});
@@ -763,3 +838,338 @@ TEST_CASE("todds::arguments report", "[arguments]") {
 		REQUIRE(shorter.report);
 	}
 }
+
+TEST_CASE("todds::arguments block_cache", "[arguments]") {
+	using todds::cache::scope;
+
+	SECTION("The default value of block_cache is none.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.block_cache == scope::none);
+	}
+
+	SECTION("Setting a valid block cache scope.") {
+		const auto arguments = get({binary, "--block-cache", "image", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.block_cache == scope::image);
+		const auto shorter = get({binary, "-bc", "BATCH", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.block_cache == scope::batch);
+	}
+
+	SECTION("Invalid block cache scopes trigger an error.") {
+		const auto arguments = get({binary, "--block-cache", "invalid", "."});
+		REQUIRE(has_error(arguments));
+	}
+}
+
+TEST_CASE("todds::arguments block_cache_size", "[arguments]") {
+	SECTION("The default value of block_cache_size is 256.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.block_cache_size == 256U);
+	}
+
+	SECTION("Setting a valid block cache size.") {
+		const auto arguments = get({binary, "--block-cache-size", "64", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.block_cache_size == 64U);
+		const auto shorter = get({binary, "-bcs", "1024", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.block_cache_size == 1024U);
+	}
+
+	SECTION("A block cache size of zero triggers an error.") {
+		const auto arguments = get({binary, "--block-cache-size", "0", "."});
+		REQUIRE(has_error(arguments));
+	}
+}
+
+TEST_CASE("todds::arguments transparent_blocks", "[arguments]") {
+	SECTION("The default value of transparent_blocks is false") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.transparent_blocks);
+	}
+
+	SECTION("Providing the transparent_blocks parameter sets its value to true") {
+		const auto arguments = get({binary, "--transparent-blocks", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.transparent_blocks);
+		const auto shorter = get({binary, "-tb", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.transparent_blocks);
+	}
+}
+
+TEST_CASE("todds::arguments adaptive_quality", "[arguments]") {
+	using todds::format::quality;
+
+	SECTION("Adaptive quality is disabled by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.adaptive_quality.has_value());
+	}
+
+	SECTION("Setting a valid adaptive quality level.") {
+		const auto arguments = get({binary, "--adaptive-quality", "2", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.adaptive_quality == quality::fast);
+		const auto shorter = get({binary, "-aq", "0", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.adaptive_quality == quality::ultra_fast);
+	}
+
+	SECTION("The adaptive quality level must be lower than the quality level.") {
+		const auto arguments = get({binary, "--quality", "3", "--adaptive-quality", "3", "."});
+		REQUIRE(has_error(arguments));
+	}
+}
+
+TEST_CASE("todds::arguments adaptive_threshold", "[arguments]") {
+	SECTION("The default value of adaptive_threshold is 16.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.adaptive_threshold == 16.0);
+	}
+
+	SECTION("Setting a valid adaptive threshold.") {
+		const auto arguments = get({binary, "--adaptive-threshold", "4.5", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.adaptive_threshold == 4.5);
+		const auto shorter = get({binary, "-at", "32", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.adaptive_threshold == 32.0);
+	}
+
+	SECTION("Adaptive thresholds must be larger than zero.") {
+		const auto arguments = get({binary, "--adaptive-threshold", "0", "."});
+		REQUIRE(has_error(arguments));
+	}
+}
+
+TEST_CASE("todds::arguments rdo_lambda", "[arguments]") {
+	SECTION("Rate-distortion optimization is disabled by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.rdo_lambda == 0.0);
+	}
+
+	SECTION("Setting a valid lambda.") {
+		const auto arguments = get({binary, "--rdo-lambda", "1.5", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.rdo_lambda == 1.5);
+		const auto shorter = get({binary, "-rl", "4", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.rdo_lambda == 4.0);
+	}
+
+	SECTION("Lambda values must be larger than zero.") {
+		REQUIRE(has_error(get({binary, "--rdo-lambda", "0", "."})));
+		REQUIRE(has_error(get({binary, "--rdo-lambda", "-1", "."})));
+	}
+}
+
+TEST_CASE("todds::arguments fast_pass", "[arguments]") {
+	using todds::format::quality;
+
+	SECTION("Two-tier encoding is disabled by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.fast_pass.has_value());
+		REQUIRE(arguments.fast_pass_psnr == 45.0);
+	}
+
+	SECTION("Setting a valid fast pass quality level.") {
+		const auto arguments = get({binary, "--fast-pass", "2", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.fast_pass == quality::fast);
+		const auto shorter = get({binary, "-fp", "0", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.fast_pass == quality::ultra_fast);
+	}
+
+	SECTION("The fast pass quality level must be lower than the quality level.") {
+		const auto arguments = get({binary, "--quality", "3", "--fast-pass", "3", "."});
+		REQUIRE(has_error(arguments));
+	}
+
+	SECTION("Setting a valid fast pass PSNR.") {
+		const auto arguments = get({binary, "--fast-pass-psnr", "40.5", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.fast_pass_psnr == 40.5);
+		const auto shorter = get({binary, "-fpp", "50", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.fast_pass_psnr == 50.0);
+	}
+
+	SECTION("Fast pass PSNR values must be larger than zero.") {
+		REQUIRE(has_error(get({binary, "--fast-pass-psnr", "0", "."})));
+	}
+}
+
+TEST_CASE("todds::arguments cpu_target", "[arguments]") {
+	using todds::cpu::target;
+
+	SECTION("The default value of cpu_target is automatic.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.cpu_target == target::automatic);
+	}
+
+	SECTION("Setting a valid CPU target.") {
+		const auto arguments = get({binary, "--cpu-target", "avx2", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.cpu_target == target::avx2);
+		const auto shorter = get({binary, "-ct", "SSE4", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.cpu_target == target::sse4);
+	}
+
+	SECTION("Invalid CPU targets trigger an error.") {
+		const auto arguments = get({binary, "--cpu-target", "neon", "."});
+		REQUIRE(has_error(arguments));
+	}
+}
+
+TEST_CASE("todds::arguments quality_metrics", "[arguments]") {
+	SECTION("Quality metrics are disabled by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.quality_metrics);
+	}
+
+	SECTION("Enabling quality metrics.") {
+		const auto arguments = get({binary, "--quality-metrics", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.quality_metrics);
+		const auto shorter = get({binary, "-qm", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.quality_metrics);
+	}
+}
+
+TEST_CASE("todds::arguments watch", "[arguments]") {
+	SECTION("Watch mode is disabled by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.watch);
+	}
+
+	SECTION("Enabling watch mode.") {
+		const auto arguments = get({binary, "--watch", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.watch);
+		const auto shorter = get({binary, "-w", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.watch);
+	}
+
+	SECTION("Watch mode cannot be combined with clean or dry run.") {
+		REQUIRE(has_error(get({binary, "--watch", "--clean", "."})));
+		REQUIRE(has_error(get({binary, "--watch", "--dry-run", "."})));
+	}
+}
+
+TEST_CASE("todds::arguments stats", "[arguments]") {
+	SECTION("Pipeline statistics are disabled by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.stats);
+	}
+
+	SECTION("Enabling pipeline statistics.") {
+		const auto arguments = get({binary, "--stats", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.stats);
+		const auto shorter = get({binary, "-st", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.stats);
+	}
+}
+
+TEST_CASE("todds::arguments pack", "[arguments]") {
+	SECTION("Pack files are not used by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.pack.has_value());
+	}
+
+	SECTION("Providing a pack file.") {
+		const auto arguments = get({binary, "--pack", "textures.pak", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.pack == boost::filesystem::absolute("textures.pak"));
+		const auto shorter = get({binary, "-pk", "textures.pak", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.pack == arguments.pack);
+	}
+
+	SECTION("Pack files require a path.") { REQUIRE(has_error(get({binary, "--pack"}))); }
+
+	SECTION("Pack files cannot be combined with PNG encoding, clean or watch.") {
+		REQUIRE(has_error(get({binary, "--pack", "textures.pak", "--format", "png", ".", "output"})));
+		REQUIRE(has_error(get({binary, "--pack", "textures.pak", "--clean", "."})));
+		REQUIRE(has_error(get({binary, "--pack", "textures.pak", "--watch", "."})));
+	}
+}
+
+TEST_CASE("todds::arguments shard", "[arguments]") {
+	SECTION("Files are not split by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.shard_count == 0U);
+	}
+
+	SECTION("Providing a shard.") {
+		const auto arguments = get({binary, "--shard", "2/4", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.shard == 2U);
+		REQUIRE(arguments.shard_count == 4U);
+		const auto shorter = get({binary, "-sh", "4/4", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.shard == 4U);
+		REQUIRE(shorter.shard_count == 4U);
+	}
+
+	SECTION("Invalid shards.") {
+		REQUIRE(has_error(get({binary, "--shard", "0/4", "."})));
+		REQUIRE(has_error(get({binary, "--shard", "5/4", "."})));
+		REQUIRE(has_error(get({binary, "--shard", "2", "."})));
+		REQUIRE(has_error(get({binary, "--shard", "a/b", "."})));
+		REQUIRE(has_error(get({binary, "--shard", "1/4x", "."})));
+		REQUIRE(has_error(get({binary, "--shard"})));
+	}
+
+	SECTION("Shards cannot be combined with watch.") {
+		REQUIRE(has_error(get({binary, "--shard", "1/2", "--watch", "."})));
+	}
+}
+
+TEST_CASE("todds::arguments merge_reports", "[arguments]") {
+	SECTION("Reports are not merged by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.merge_reports);
+	}
+
+	SECTION("Merging reports.") {
+		const auto arguments = get({binary, "--merge-reports", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.merge_reports);
+		const auto shorter = get({binary, "-mr", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.merge_reports);
+	}
+
+	SECTION("Merging reports cannot be combined with shard, watch or clean.") {
+		REQUIRE(has_error(get({binary, "--merge-reports", "--shard", "1/2", "."})));
+		REQUIRE(has_error(get({binary, "--merge-reports", "--watch", "."})));
+		REQUIRE(has_error(get({binary, "--merge-reports", "--clean", "."})));
+	}
+}
+
+TEST_CASE("todds::arguments skip_unchanged", "[arguments]") {
+	SECTION("Unchanged files are written by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.skip_unchanged);
+	}
+
+	SECTION("Skipping unchanged files.") {
+		const auto arguments = get({binary, "--skip-unchanged", "--overwrite", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.skip_unchanged);
+		const auto shorter = get({binary, "-su", "-on", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.skip_unchanged);
+	}
+
+	SECTION("Skipping unchanged files cannot be combined with pack files.") {
+		REQUIRE(has_error(get({binary, "--skip-unchanged", "--pack", "textures.pak", "."})));
+	}
+}
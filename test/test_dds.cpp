@@ -0,0 +1,636 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/dds.hpp"
+#include "todds/format.hpp"
+#include "todds/image_types.hpp"
+
+#include <oneapi/tbb/info.h>
+#include <oneapi/tbb/parallel_for.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include <utility>
+
+#include "dds_impl.hpp"
+#include "rgbcx_todds.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+constexpr std::size_t pixel_block_size = todds::pixel_block_side * todds::pixel_block_side;
+
+// Mixes solid blocks, blocks with a solid color but different alpha values, and random blocks.
+todds::pixel_block_image test_image(std::size_t num_blocks) {
+	std::mt19937 generator{num_blocks};
+	todds::pixel_block_image image(num_blocks * pixel_block_size);
+	for (std::size_t block = 0U; block < num_blocks; ++block) {
+		const auto color = static_cast<std::uint32_t>(generator());
+		for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+			std::uint32_t value{};
+			switch (block % 3U) {
+			case 0U: value = color; break;
+			case 1U: value = (color & 0x00FFFFFFU) | (static_cast<std::uint32_t>(generator()) & 0xFF000000U); break;
+			default: value = static_cast<std::uint32_t>(generator()); break;
+			}
+			image[block * pixel_block_size + pixel] = value;
+		}
+	}
+	return image;
+}
+
+// Mostly smooth image with some noisy blocks, similar to textures with large flat areas.
+todds::pixel_block_image smooth_image(std::size_t num_blocks) {
+	std::mt19937 generator{num_blocks};
+	todds::pixel_block_image image(num_blocks * pixel_block_size);
+	for (std::size_t block = 0U; block < num_blocks; ++block) {
+		const auto color = static_cast<std::uint32_t>(generator()) & 0xFCFCFCFCU;
+		for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+			// Gradients with a channel variance of about one.
+			const auto step = static_cast<std::uint32_t>(pixel / 4U);
+			const std::uint32_t value =
+				block % 8U == 0U ? static_cast<std::uint32_t>(generator()) : color + step * 0x01010101U;
+			image[block * pixel_block_size + pixel] = value;
+		}
+	}
+	return image;
+}
+
+// Blocks with a few flat or gradient regions, which BC7 encoders compress with different modes and partitions.
+todds::pixel_block_image structured_image(std::size_t num_blocks) {
+	// The scalar encoder has no modes with three subsets.
+#ifdef TODDS_ISPC
+	constexpr std::size_t block_types = 5U;
+#else
+	constexpr std::size_t block_types = 4U;
+#endif // TODDS_ISPC
+	constexpr std::uint32_t opaque = 0xFF000000U;
+	std::mt19937 generator{num_blocks};
+	todds::pixel_block_image image(num_blocks * pixel_block_size);
+	for (std::size_t block = 0U; block < num_blocks; ++block) {
+		std::array<std::uint32_t, 3U> colors{};
+		for (std::uint32_t& color : colors) { color = static_cast<std::uint32_t>(generator()) | opaque; }
+		const std::uint32_t alpha = static_cast<std::uint32_t>(generator()) & opaque;
+		for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+			const std::size_t column = pixel % todds::pixel_block_side;
+			const std::size_t row = pixel / todds::pixel_block_side;
+			const auto step = static_cast<std::uint32_t>(column + row);
+			std::uint32_t value{};
+			switch (block % block_types) {
+			// Two subsets with a different color ramp in each one.
+			case 0U: value = (column < 2U ? colors[0U] : colors[1U]) - (step % 2U) * 0x00080808U; break;
+			// Two subsets with different alpha values.
+			case 1U: value = row < 2U ? colors[0U] : (colors[1U] & ~opaque) | alpha; break;
+			// Color gradient.
+			case 2U: value = (colors[0U] & 0xFFC0C0C0U) + step * 0x00080808U; break;
+			// Color and alpha gradients in opposite directions.
+			case 3U: value = (colors[0U] & 0x00C0C0C0U) + step * 0x00080808U + (0xFFU - step * 16U) * 0x01000000U; break;
+			// Three flat subsets.
+			default: value = column < 2U ? colors[0U] : (row < 2U ? colors[1U] : colors[2U]); break;
+			}
+			image[block * pixel_block_size + pixel] = value;
+		}
+	}
+	return image;
+}
+
+// PSNR of every block of an encoded image.
+double image_psnr(
+	const todds::dds::impl::decode_format& format, const todds::pixel_block_image& image, const todds::dds_image& dds) {
+	const std::size_t num_blocks = image.size() / pixel_block_size;
+	const std::uint64_t error = todds::dds::impl::squared_error(format, image.data(), dds.data(), num_blocks);
+	return todds::dds::impl::psnr(error, num_blocks * pixel_block_size * format.channels);
+}
+
+// Fastest of several runs of a function, reducing the noise caused by other processes.
+template<typename Function> std::chrono::nanoseconds fastest_run(Function&& function) {
+	constexpr std::size_t runs = 5U;
+	auto fastest = std::chrono::nanoseconds::max();
+	for (std::size_t run = 0U; run < runs; ++run) {
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		fastest = std::min(fastest, std::chrono::duration_cast<std::chrono::nanoseconds>(
+																	std::chrono::steady_clock::now() - start));
+	}
+	return fastest;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("todds::dds BC1 and BC3 encoders match rgbcx", "[dds]") {
+	using todds::format::quality;
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc3);
+
+	// Grayscale blocks and blocks in which every pixel has the same selector take special paths in the encoders.
+	todds::pixel_block_image grayscale = smooth_image(150U);
+	for (std::uint32_t& pixel : grayscale) { pixel = (pixel & 0xFF0000FFU) | ((pixel & 0xFFU) * 0x00010100U); }
+
+	// The number of blocks of each image is not a multiple of the batches of the BC1 kernel.
+	const std::array<todds::pixel_block_image, 4U> images{
+		test_image(150U), smooth_image(150U), structured_image(150U), std::move(grayscale)};
+
+	for (const todds::pixel_block_image& image : images) {
+		const std::size_t num_blocks = image.size() / pixel_block_size;
+		for (unsigned int level = static_cast<unsigned int>(quality::minimum);
+				 level <= static_cast<unsigned int>(quality::maximum); ++level) {
+			const auto factors = todds::dds::impl::from_quality_level(level, true);
+			const todds::dds_image bc1 = todds::dds::bc1_encode(static_cast<quality>(level), true, image);
+			const todds::dds_image bc3 = todds::dds::bc3_encode(static_cast<quality>(level), image);
+			REQUIRE(bc1.size() == num_blocks);
+			REQUIRE(bc3.size() == num_blocks * 2U);
+
+			for (std::size_t block = 0U; block < num_blocks; ++block) {
+				const auto* pixels = reinterpret_cast<const std::uint8_t*>(&image[block * pixel_block_size]);
+				std::array<std::uint64_t, 2U> expected{};
+				rgbcx::encode_bc1(expected.data(), pixels, factors.flags, factors.total_orderings4, factors.total_orderings3);
+				REQUIRE(bc1[block] == expected[0U]);
+
+				const auto bc3_factors = todds::dds::impl::from_quality_level(level, false);
+				rgbcx::encode_bc3(expected.data(), pixels, bc3_factors.flags);
+				REQUIRE(bc3[block * 2U] == expected[0U]);
+				REQUIRE(bc3[block * 2U + 1U] == expected[1U]);
+			}
+		}
+	}
+}
+
+TEST_CASE("todds::dds BC4 and BC5 encoding", "[dds]") {
+	todds::dds::initialize_encoding(todds::format::type::bc4, todds::format::type::bc5);
+
+	SECTION("Solid blocks are decoded without any error") {
+		const todds::pixel_block_image image(pixel_block_size, 0x80402010U);
+		const todds::dds_image bc4 = todds::dds::bc4_encode(image);
+		const todds::dds_image bc5 = todds::dds::bc5_encode(image);
+		REQUIRE(bc4.size() == 1U);
+		REQUIRE(bc5.size() == 2U);
+
+		// BC4 only keeps the red channel, and BC5 the red and green channels.
+		std::array<std::uint32_t, pixel_block_size> decoded{};
+		todds::dds::impl::bcx_decode_format(todds::format::type::bc4).decode(bc4.data(), decoded.data());
+		REQUIRE(std::all_of(decoded.cbegin(), decoded.cend(), [](std::uint32_t pixel) { return pixel == 0x10U; }));
+		todds::dds::impl::bcx_decode_format(todds::format::type::bc5).decode(bc5.data(), decoded.data());
+		REQUIRE(std::all_of(decoded.cbegin(), decoded.cend(), [](std::uint32_t pixel) { return pixel == 0x2010U; }));
+	}
+
+	SECTION("Encoded blocks match rgbcx and preserve the channels of each format") {
+		const todds::pixel_block_image image = smooth_image(200U);
+		const std::size_t num_blocks = image.size() / pixel_block_size;
+		const todds::dds_image bc4 = todds::dds::bc4_encode(image);
+		const todds::dds_image bc5 = todds::dds::bc5_encode(image);
+		REQUIRE(bc4.size() == num_blocks);
+		REQUIRE(bc5.size() == num_blocks * 2U);
+
+		for (std::size_t block = 0U; block < num_blocks; ++block) {
+			const auto* pixels = reinterpret_cast<const std::uint8_t*>(&image[block * pixel_block_size]);
+			std::array<std::uint64_t, 2U> expected{};
+			rgbcx::encode_bc4(expected.data(), pixels);
+			REQUIRE(bc4[block] == expected[0U]);
+			rgbcx::encode_bc5(expected.data(), pixels);
+			REQUIRE(bc5[block * 2U] == expected[0U]);
+			REQUIRE(bc5[block * 2U + 1U] == expected[1U]);
+		}
+
+		REQUIRE(image_psnr(todds::dds::impl::bcx_decode_format(todds::format::type::bc4), image, bc4) > 35.0);
+		REQUIRE(image_psnr(todds::dds::impl::bcx_decode_format(todds::format::type::bc5), image, bc5) > 35.0);
+	}
+}
+
+TEST_CASE("todds::dds DX10 header extension", "[dds]") {
+	using todds::format::type;
+	REQUIRE(!todds::dds::has_header_extension(type::bc1));
+	REQUIRE(!todds::dds::has_header_extension(type::bc3));
+
+	// Little-endian 32-bit value stored in a header.
+	const auto read_u32 = [](const auto& header, std::size_t offset) {
+		std::uint32_t value = 0U;
+		for (std::size_t index = offset + 4U; index > offset; --index) {
+			value = (value << 8U) | static_cast<std::uint8_t>(header[index - 1U]);
+		}
+		return value;
+	};
+
+	// DXGI format of each format using the extension.
+	const std::array<std::pair<type, std::uint32_t>, 3U> dxgi_formats{
+		{{type::bc4, 80U}, {type::bc5, 83U}, {type::bc7, 98U}}};
+	for (const auto& [format, dxgi_format] : dxgi_formats) {
+		REQUIRE(todds::dds::has_header_extension(format));
+		// The four character code of the pixel format announces the extension.
+		const std::array<char, 124> header = todds::dds::dds_header(format, 64U, 64U, 7U);
+		REQUIRE(std::string_view{&header[80U], 4U} == "DX10");
+
+		const std::array<char, 20> extension = todds::dds::dds_header_extension(format);
+		REQUIRE(read_u32(extension, 0U) == dxgi_format);
+		// Two-dimensional texture, with a single element in the array.
+		REQUIRE(read_u32(extension, 4U) == 3U);
+		REQUIRE(read_u32(extension, 8U) == 0U);
+		REQUIRE(read_u32(extension, 12U) == 1U);
+		REQUIRE(read_u32(extension, 16U) == 0U);
+	}
+}
+
+TEST_CASE("todds::dds block cache does not change encoded data", "[dds]") {
+	todds::dds::initialize_encoding(todds::format::type::bc7, todds::format::type::bc3);
+	// Repeat every block twice to ensure that there are cache hits.
+	const todds::pixel_block_image blocks = test_image(48U);
+	todds::pixel_block_image image(blocks.size() * 2U);
+	std::copy(blocks.begin(), blocks.end(), image.begin());
+	std::copy(blocks.begin(), blocks.end(), image.begin() + static_cast<std::ptrdiff_t>(blocks.size()));
+
+	todds::dds::block_cache_statistics statistics;
+	todds::dds::block_cache cache{1024U * 1024U, statistics};
+	todds::dds::encode_options options{};
+	options.cache = &cache;
+
+	const auto params = todds::dds::bc7_encode_params(todds::format::quality::ultra_fast);
+	REQUIRE(todds::dds::bc7_encode(params, image) == todds::dds::bc7_encode(params, image, options));
+	REQUIRE(todds::dds::bc3_encode(todds::format::quality::fast, image) ==
+					todds::dds::bc3_encode(todds::format::quality::fast, image, options));
+	REQUIRE(statistics.hits > 0U);
+}
+
+TEST_CASE("todds::dds transparent blocks", "[dds]") {
+	todds::dds::initialize_encoding(todds::format::type::bc7, todds::format::type::bc3);
+	todds::pixel_block_image image(2U * pixel_block_size, 0x00FF00FFU);
+	std::fill_n(image.begin(), pixel_block_size, 0x80FF00FFU);
+
+	todds::dds::encode_options options{};
+	options.transparent_blocks = true;
+
+	const todds::dds_image bc3 = todds::dds::bc3_encode(todds::format::quality::fast, image, options);
+	REQUIRE(bc3[2U] == 0U);
+	REQUIRE(bc3[3U] == 0U);
+	std::array<std::uint8_t, pixel_block_size * 4U> decoded{};
+	rgbcx::unpack_bc3(&bc3[2U], decoded.data());
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) { REQUIRE(decoded[pixel * 4U + 3U] == 0U); }
+
+	const auto params = todds::dds::bc7_encode_params(todds::format::quality::ultra_fast);
+	const todds::dds_image bc7 = todds::dds::bc7_encode(params, image, options);
+	REQUIRE(bc7[0U] == todds::dds::bc7_encode(params, image)[0U]);
+	REQUIRE(bc7[2U] == 0x40U);
+	REQUIRE(bc7[3U] == 0U);
+}
+
+TEST_CASE("todds::dds encode_scheduler", "[dds]") {
+	using todds::dds::encode_scheduler;
+	constexpr std::size_t threads = 8U;
+	constexpr std::size_t huge_image_blocks = 1024U * 1024U;
+	encode_scheduler scheduler{threads};
+
+	SECTION("Small images are encoded serially") {
+		scheduler.begin_image();
+		REQUIRE_FALSE(scheduler.plan(encode_scheduler::min_grain_size).parallel);
+		scheduler.end_image();
+	}
+
+	SECTION("A single image uses every thread") {
+		scheduler.begin_image();
+		const auto plan = scheduler.plan(huge_image_blocks);
+		REQUIRE(plan.parallel);
+		REQUIRE(plan.grain_size == huge_image_blocks / (threads * encode_scheduler::tasks_per_thread));
+		scheduler.end_image();
+	}
+
+	SECTION("Grain sizes grow as the pipeline fills") {
+		scheduler.begin_image();
+		const auto draining = scheduler.plan(huge_image_blocks);
+		for (std::size_t index = 1U; index < threads / 2U; ++index) { scheduler.begin_image(); }
+		const auto half_full = scheduler.plan(huge_image_blocks);
+		REQUIRE(half_full.parallel);
+		REQUIRE(half_full.grain_size > draining.grain_size);
+		for (std::size_t index = threads / 2U; index < threads; ++index) { scheduler.begin_image(); }
+		REQUIRE_FALSE(scheduler.plan(huge_image_blocks).parallel);
+		for (std::size_t index = 0U; index < threads; ++index) { scheduler.end_image(); }
+	}
+
+	SECTION("Grain size has a lower bound") {
+		scheduler.begin_image();
+		const auto plan = scheduler.plan(encode_scheduler::min_grain_size * 2U);
+		REQUIRE(plan.parallel);
+		REQUIRE(plan.grain_size == encode_scheduler::min_grain_size);
+		scheduler.end_image();
+	}
+}
+
+TEST_CASE("todds::dds scheduled encoding does not change encoded data", "[dds]") {
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc3);
+	const todds::pixel_block_image image = test_image(300U);
+
+	todds::dds::encode_scheduler scheduler{4U};
+	todds::dds::encode_options options{};
+	options.scheduler = &scheduler;
+	REQUIRE(todds::dds::bc1_encode(todds::format::quality::fast, false, image) ==
+					todds::dds::bc1_encode(todds::format::quality::fast, false, image, options));
+
+	// Simulate a full pipeline, forcing serial encoding.
+	for (std::size_t index = 0U; index < 4U; ++index) { scheduler.begin_image(); }
+	REQUIRE(todds::dds::bc3_encode(todds::format::quality::fast, image) ==
+					todds::dds::bc3_encode(todds::format::quality::fast, image, options));
+	for (std::size_t index = 0U; index < 4U; ++index) { scheduler.end_image(); }
+}
+
+TEST_CASE("todds::dds BC7 decoding", "[dds]") {
+	todds::dds::initialize_encoding(todds::format::type::bc7, todds::format::type::bc7);
+	const todds::pixel_block_image image(pixel_block_size, 0x80402010U);
+	const auto params = todds::dds::bc7_encode_params(todds::format::quality::very_fast);
+	const todds::dds_image bc7 = todds::dds::bc7_encode(params, image);
+
+	std::array<std::uint32_t, pixel_block_size> decoded{};
+	todds::dds::impl::bc7_decode_block(bc7.data(), decoded.data());
+	for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		for (std::uint32_t shift = 0U; shift < 32U; shift += 8U) {
+			const auto expected = static_cast<int>((image[pixel] >> shift) & 0xFFU);
+			const auto value = static_cast<int>((decoded[pixel] >> shift) & 0xFFU);
+			REQUIRE(std::abs(expected - value) <= 1);
+		}
+	}
+}
+
+TEST_CASE("todds::dds BC7 decoding of every mode", "[dds]") {
+	todds::dds::initialize_encoding(todds::format::type::bc7, todds::format::type::bc7);
+	constexpr std::size_t num_blocks = 500U;
+	// Largest difference of a channel between the original and the decoded pixels.
+	constexpr int max_error = 8;
+	const todds::pixel_block_image image = structured_image(num_blocks);
+
+	for (const auto quality : {todds::format::quality::very_fast, todds::format::quality::slow}) {
+		const todds::dds_image bc7 = todds::dds::bc7_encode(todds::dds::bc7_encode_params(quality), image);
+		// The mode of a BC7 block is the position of the lowest bit set in its first byte.
+		std::array<std::size_t, 8U> modes{};
+		for (std::size_t block = 0U; block < num_blocks; ++block) {
+			const auto mode_bits = static_cast<std::uint8_t>(bc7[block * 2U] & 0xFFU);
+			REQUIRE(mode_bits != 0U);
+			++modes[static_cast<std::size_t>(std::countr_zero(mode_bits))];
+
+			std::array<std::uint32_t, pixel_block_size> decoded{};
+			todds::dds::impl::bc7_decode_block(&bc7[block * 2U], decoded.data());
+			for (std::size_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+				for (std::uint32_t shift = 0U; shift < 32U; shift += 8U) {
+					const auto expected = static_cast<int>((image[block * pixel_block_size + pixel] >> shift) & 0xFFU);
+					const auto value = static_cast<int>((decoded[pixel] >> shift) & 0xFFU);
+					REQUIRE(std::abs(expected - value) <= max_error);
+				}
+			}
+		}
+
+		REQUIRE(std::count_if(modes.cbegin(), modes.cend(), [](std::size_t count) { return count > 0U; }) >= 4);
+		// Modes with two subsets.
+		REQUIRE(modes[1U] + modes[3U] + modes[7U] > 0U);
+		// Modes with separate alpha.
+		REQUIRE(modes[4U] + modes[5U] > 0U);
+#ifdef TODDS_ISPC
+		// Modes with three subsets.
+		REQUIRE(modes[0U] + modes[2U] > 0U);
+#endif // TODDS_ISPC
+	}
+}
+
+TEST_CASE("todds::dds rate-distortion optimization", "[dds]") {
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc7);
+	// Repeated blocks with small variations.
+	todds::pixel_block_image image = test_image(512U);
+	for (std::size_t index = 0U; index < image.size(); ++index) {
+		image[index] = image[index % (pixel_block_size * 8U)] ^ static_cast<std::uint32_t>(index & 0x3U);
+	}
+
+	todds::dds::encode_scheduler scheduler{4U};
+	todds::dds::rdo_statistics statistics;
+	todds::dds::encode_options options{};
+	options.scheduler = &scheduler;
+	options.rdo_lambda = 2.0F;
+	options.rdo_stats = &statistics;
+	options.rdo_measure_size = true;
+
+	const auto params = todds::dds::bc7_encode_params(todds::format::quality::ultra_fast);
+	const todds::dds_image bc7 = todds::dds::bc7_encode(params, image, options);
+	REQUIRE(statistics.total_blocks == 512U);
+	REQUIRE(statistics.replaced_blocks > 0U);
+	REQUIRE(statistics.optimized_size < statistics.original_size);
+	REQUIRE(bc7 == todds::dds::bc7_encode(params, image, options));
+
+	const todds::dds_image bc1 = todds::dds::bc1_encode(todds::format::quality::fast, false, image, options);
+	REQUIRE(bc1 == todds::dds::bc1_encode(todds::format::quality::fast, false, image, options));
+	REQUIRE(statistics.total_blocks == 512U * 4U);
+}
+
+TEST_CASE("todds::dds two-tier encoding", "[dds]") {
+	using todds::format::quality;
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc7);
+	const todds::pixel_block_image image = test_image(100U);
+
+	todds::dds::refine_statistics statistics;
+	todds::dds::encode_options options{};
+	options.fast_pass_quality = quality::ultra_fast;
+	options.refine_stats = &statistics;
+
+	const todds::dds_image fast = todds::dds::bc1_encode(quality::ultra_fast, false, image);
+	const todds::dds_image slow = todds::dds::bc1_encode(quality::slow, false, image);
+
+	SECTION("Regions are not encoded again if their error is low enough") {
+		options.refine_psnr = 1.0;
+		REQUIRE(todds::dds::bc1_encode(quality::slow, false, image, options) == fast);
+		REQUIRE(statistics.regions == 7U);
+		REQUIRE(statistics.refined_regions == 0U);
+	}
+
+	SECTION("Regions with high errors are encoded again with the final quality") {
+		options.refine_psnr = 1000.0;
+		REQUIRE(todds::dds::bc1_encode(quality::slow, false, image, options) == slow);
+		REQUIRE(statistics.refined_regions == statistics.regions);
+	}
+
+	SECTION("BC7 two-tier encoding") {
+		options.refine_psnr = 1000.0;
+		const auto params = todds::dds::bc7_encode_params(quality::very_fast);
+		REQUIRE(todds::dds::bc7_encode(params, image, options) == todds::dds::bc7_encode(params, image));
+	}
+}
+
+TEST_CASE("todds::dds quality metrics", "[dds]") {
+	using todds::format::quality;
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc7);
+
+	SECTION("Lossless blocks have an infinite PSNR and an SSIM of one") {
+		// 8x8 image with mipmaps: 4 blocks for the main image and one block for each of the 4x4, 2x2 and 1x1 levels.
+		const todds::pixel_block_image image(7U * pixel_block_size, 0xFF204080U);
+		const todds::dds_image bc4 = todds::dds::bc4_encode(image);
+		const auto metrics = todds::dds::measure_quality(todds::format::type::bc4, 8U, 8U, 4U, image, bc4);
+		REQUIRE(metrics.levels.size() == 4U);
+		REQUIRE(std::isinf(metrics.image.psnr));
+		REQUIRE(metrics.image.ssim == 1.0);
+		for (const auto& level : metrics.levels) { REQUIRE(std::isinf(level.psnr)); }
+	}
+
+	SECTION("The PSNR of the image matches its squared error") {
+		const todds::pixel_block_image image = test_image(64U);
+		const todds::dds_image bc1 = todds::dds::bc1_encode(quality::fast, false, image);
+		const auto metrics = todds::dds::measure_quality(todds::format::type::bc1, 32U, 32U, 1U, image, bc1);
+		const std::uint64_t error = todds::dds::impl::squared_error(
+			todds::dds::impl::bcx_decode_format(todds::format::type::bc1), image.data(), bc1.data(), 64U);
+		REQUIRE(metrics.levels.size() == 1U);
+		REQUIRE(metrics.image.psnr == todds::dds::impl::psnr(error, 64U * pixel_block_size * 3U));
+		REQUIRE(metrics.image.ssim > 0.0);
+		REQUIRE(metrics.image.ssim < 1.0);
+
+		const todds::dds_image bc7 = todds::dds::bc7_encode(todds::dds::bc7_encode_params(quality::slow), image);
+		const auto bc7_metrics = todds::dds::measure_quality(todds::format::type::bc7, 32U, 32U, 1U, image, bc7);
+		REQUIRE(bc7_metrics.image.psnr > 0.0);
+		REQUIRE(bc7_metrics.image.ssim > 0.0);
+	}
+}
+
+TEST_CASE("todds::dds cancellation", "[dds]") {
+	using todds::format::quality;
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc7);
+	// Several chunks, the last one being incomplete.
+	const todds::pixel_block_image image = test_image(todds::dds::impl::cancellation_blocks * 3U + 44U);
+
+	std::atomic<bool> force_finish{};
+	todds::dds::encode_scheduler scheduler{4U};
+	todds::dds::adaptive_statistics statistics;
+	todds::dds::encode_options options{};
+	options.scheduler = &scheduler;
+	options.force_finish = &force_finish;
+	options.complexity_threshold = 1.0F;
+	options.adaptive_stats = &statistics;
+
+	SECTION("Encoding in cancellable chunks does not change encoded data") {
+		todds::dds::encode_options reference = options;
+		reference.force_finish = nullptr;
+		options.rdo_lambda = reference.rdo_lambda = 2.0F;
+		options.refine_psnr = reference.refine_psnr = 30.0;
+		options.fast_pass_quality = reference.fast_pass_quality = quality::ultra_fast;
+		REQUIRE(todds::dds::bc1_encode(quality::slow, false, image, options) ==
+						todds::dds::bc1_encode(quality::slow, false, image, reference));
+		const auto params = todds::dds::bc7_encode_params(quality::very_fast);
+		REQUIRE(todds::dds::bc7_encode(params, image, options) == todds::dds::bc7_encode(params, image, reference));
+	}
+
+	SECTION("No blocks are encoded after cancelling") {
+		force_finish = true;
+		static_cast<void>(todds::dds::bc7_encode(todds::dds::bc7_encode_params(quality::slowest), image, options));
+		static_cast<void>(todds::dds::bc1_encode(quality::slow, false, image, options));
+		REQUIRE(statistics.regular_blocks == 0U);
+		REQUIRE(statistics.low_complexity_blocks == 0U);
+	}
+}
+
+TEST_CASE("todds::dds adaptive quality", "[dds]") {
+	using todds::format::quality;
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc7);
+	const todds::pixel_block_image image = smooth_image(256U);
+
+	todds::dds::adaptive_statistics statistics;
+	todds::dds::encode_options options{};
+	options.complexity_threshold = 16.0F;
+	options.low_complexity_quality = quality::very_fast;
+	options.adaptive_stats = &statistics;
+
+	// Low complexity blocks are easy to encode, cheaper settings barely change their quality.
+	SECTION("BC1") {
+		const todds::dds_image uniform = todds::dds::bc1_encode(quality::slowest, false, image);
+		const todds::dds_image adaptive = todds::dds::bc1_encode(quality::slowest, false, image, options);
+		REQUIRE(statistics.low_complexity_blocks == 224U);
+		REQUIRE(statistics.regular_blocks == 32U);
+		const auto& format = todds::dds::impl::bcx_decode_format(todds::format::type::bc1);
+		REQUIRE(image_psnr(format, image, adaptive) > image_psnr(format, image, uniform) - 0.5);
+	}
+
+	SECTION("BC7") {
+		const auto params = todds::dds::bc7_encode_params(quality::slow);
+		const todds::dds_image uniform = todds::dds::bc7_encode(params, image);
+		const todds::dds_image adaptive = todds::dds::bc7_encode(params, image, options);
+		REQUIRE(statistics.low_complexity_blocks == 224U);
+		const auto& format = todds::dds::impl::bc7_decode_format();
+		REQUIRE(image_psnr(format, image, adaptive) > image_psnr(format, image, uniform) - 0.5);
+	}
+}
+
+// Benchmarks are hidden from the default test run. CTest runs them with the todds_benchmark test.
+TEST_CASE("todds::dds adaptive quality is faster than uniform quality", "[.][benchmark]") {
+	using todds::format::quality;
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc7);
+	const todds::pixel_block_image image = smooth_image(4096U);
+
+	todds::dds::encode_options options{};
+	options.complexity_threshold = 16.0F;
+	options.low_complexity_quality = quality::very_fast;
+
+	SECTION("BC1") {
+		const auto uniform =
+			fastest_run([&] { static_cast<void>(todds::dds::bc1_encode(quality::slowest, false, image)); });
+		const auto adaptive =
+			fastest_run([&] { static_cast<void>(todds::dds::bc1_encode(quality::slowest, false, image, options)); });
+		REQUIRE(adaptive < uniform);
+	}
+
+#ifdef TODDS_ISPC
+	// The quality levels of the scalar BC7 encoder only change its uber level, which barely affects its speed.
+	SECTION("BC7") {
+		const auto params = todds::dds::bc7_encode_params(quality::slowest);
+		const auto uniform = fastest_run([&] { static_cast<void>(todds::dds::bc7_encode(params, image)); });
+		const auto adaptive = fastest_run([&] { static_cast<void>(todds::dds::bc7_encode(params, image, options)); });
+		REQUIRE(adaptive < uniform);
+	}
+#endif // TODDS_ISPC
+}
+
+TEST_CASE("todds::dds batched BC1 kernel is faster than rgbcx", "[.][benchmark]") {
+	using todds::format::quality;
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc1);
+	const todds::pixel_block_image image = smooth_image(64U * 1024U);
+	const std::size_t num_blocks = image.size() / pixel_block_size;
+	const auto factors = todds::dds::impl::from_quality_level(static_cast<unsigned int>(quality::very_fast), false);
+
+	const auto batched =
+		fastest_run([&] { static_cast<void>(todds::dds::bc1_encode(quality::very_fast, false, image)); });
+	const auto per_block = fastest_run([&] {
+		todds::dds_image result(num_blocks);
+		oneapi::tbb::parallel_for(std::size_t{0U}, num_blocks, [&](std::size_t block) {
+			const auto* pixels = reinterpret_cast<const std::uint8_t*>(&image[block * pixel_block_size]);
+			rgbcx::encode_bc1(&result[block], pixels, factors.flags, factors.total_orderings4, factors.total_orderings3);
+		});
+	});
+	REQUIRE(batched < per_block);
+}
+
+TEST_CASE("todds::dds scheduled encoding is not slower than nested parallelism", "[.][benchmark]") {
+	using todds::format::quality;
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc1);
+	const auto threads = static_cast<std::size_t>(oneapi::tbb::info::default_concurrency());
+	todds::dds::encode_scheduler scheduler{threads};
+	todds::dds::encode_options scheduled{};
+	scheduled.scheduler = &scheduler;
+	// Measurements may differ slightly between runs.
+	constexpr double tolerance = 1.1;
+
+	SECTION("Many small files") {
+		constexpr std::size_t images = 512U;
+		const todds::pixel_block_image image = test_image(256U);
+		const auto encode_all = [&image](const todds::dds::encode_options& options) {
+			oneapi::tbb::parallel_for(std::size_t{0U}, images, [&image, &options](std::size_t /*index*/) {
+				static_cast<void>(todds::dds::bc1_encode(quality::fast, false, image, options));
+			});
+		};
+		const auto nested = fastest_run([&] { encode_all({}); });
+		const auto serial = fastest_run([&] { encode_all(scheduled); });
+		REQUIRE(static_cast<double>(serial.count()) <= static_cast<double>(nested.count()) * tolerance);
+	}
+
+	SECTION("A single huge file") {
+		const todds::pixel_block_image image = test_image(256U * 1024U);
+		const auto nested = fastest_run([&] { static_cast<void>(todds::dds::bc1_encode(quality::fast, false, image)); });
+		const auto planned =
+			fastest_run([&] { static_cast<void>(todds::dds::bc1_encode(quality::fast, false, image, scheduled)); });
+		REQUIRE(static_cast<double>(planned.count()) <= static_cast<double>(nested.count()) * tolerance);
+	}
+}
@@ -0,0 +1,132 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/encoder.hpp"
+
+#include "todds/format.hpp"
+#include "todds/image.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/png.hpp"
+#include "todds/string.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+constexpr std::size_t image_size = 64U;
+// Size of the DDS header, including its magic number. BC7 files also have the DX10 header extension.
+constexpr std::size_t bc1_header_size = 128U;
+constexpr std::size_t bc7_header_size = 148U;
+// Blocks of every mipmap level, from 64x64 to 1x1 pixels.
+constexpr std::size_t blocks = 256U + 64U + 16U + 4U + 1U + 1U + 1U;
+
+// RGBA pixels of a gradient, in rows from top to bottom.
+std::vector<std::uint8_t> gradient_pixels() {
+	std::vector<std::uint8_t> pixels(image_size * image_size * todds::image::bytes_per_pixel);
+	for (std::size_t row = 0U; row < image_size; ++row) {
+		for (std::size_t column = 0U; column < image_size; ++column) {
+			std::uint8_t* pixel = &pixels[(row * image_size + column) * todds::image::bytes_per_pixel];
+			pixel[0U] = static_cast<std::uint8_t>(row * 4U);
+			pixel[1U] = static_cast<std::uint8_t>(column * 4U);
+			pixel[2U] = static_cast<std::uint8_t>((row + column) * 2U);
+			pixel[3U] = 0xFFU;
+		}
+	}
+	return pixels;
+}
+
+todds::encoder_image rgba_image() { return {gradient_pixels(), image_size, image_size}; }
+
+// PNG file containing the same pixels as rgba_image.
+todds::encoder_image png_image() {
+	auto image = std::make_unique<todds::mipmap_image>(0U, image_size, image_size, false);
+	const std::vector<std::uint8_t> pixels = gradient_pixels();
+	std::copy(pixels.cbegin(), pixels.cend(), image->get_image(0U).data().begin());
+	const todds::string name = "test PNG file";
+	const auto buffer = todds::png::encode(name, std::move(image));
+	return {std::vector<std::uint8_t>(buffer.begin(), buffer.end()), 0U, 0U};
+}
+
+todds::encoder_settings settings_for(todds::format::type format) {
+	todds::encoder_settings settings{};
+	settings.format = format;
+	settings.quality = todds::format::quality::very_fast;
+	return settings;
+}
+
+bool is_dds_file(const std::vector<std::uint8_t>& file, std::size_t expected_size) {
+	constexpr std::string_view magic{"DDS "};
+	return file.size() == expected_size && std::equal(magic.cbegin(), magic.cend(), file.cbegin());
+}
+
+} // Anonymous namespace
+
+TEST_CASE("todds::encoder submissions", "[encoder]") {
+	todds::encoder encoder{2U};
+	const todds::encoder_settings bc1 = settings_for(todds::format::type::bc1);
+
+	SECTION("PNG files and RGBA pixels with the same contents produce the same DDS file") {
+		auto from_png = encoder.submit(png_image(), bc1);
+		auto from_rgba = encoder.submit(rgba_image(), bc1);
+		const std::vector<std::uint8_t> png_result = from_png.get();
+		REQUIRE(is_dds_file(png_result, bc1_header_size + blocks * 8U));
+		REQUIRE(png_result == from_rgba.get());
+	}
+
+	SECTION("Images with different settings can be submitted at the same time") {
+		const todds::encoder_settings bc7 = settings_for(todds::format::type::bc7);
+		std::vector<std::future<std::vector<std::uint8_t>>> bc1_results;
+		std::vector<std::future<std::vector<std::uint8_t>>> bc7_results;
+		for (std::size_t index = 0U; index < 4U; ++index) {
+			bc1_results.emplace_back(encoder.submit(rgba_image(), bc1));
+			bc7_results.emplace_back(encoder.submit(png_image(), bc7));
+		}
+		for (auto& result : bc1_results) { REQUIRE(is_dds_file(result.get(), bc1_header_size + blocks * 8U)); }
+		for (auto& result : bc7_results) { REQUIRE(is_dds_file(result.get(), bc7_header_size + blocks * 16U)); }
+	}
+
+	SECTION("Invalid images are reported through their futures without affecting the rest of the batch") {
+		todds::encoder_image truncated = rgba_image();
+		truncated.data.resize(truncated.data.size() - 1U);
+		todds::encoder_image not_png{{'n', 'o', 't', ' ', 'p', 'n', 'g'}, 0U, 0U};
+
+		auto truncated_result = encoder.submit(std::move(truncated), bc1);
+		auto not_png_result = encoder.submit(std::move(not_png), bc1);
+		auto valid_result = encoder.submit(rgba_image(), bc1);
+		auto png_format_result = encoder.submit(rgba_image(), settings_for(todds::format::type::png));
+
+		REQUIRE_THROWS_AS(truncated_result.get(), std::runtime_error);
+		REQUIRE_THROWS_AS(not_png_result.get(), std::runtime_error);
+		REQUIRE_THROWS_AS(png_format_result.get(), std::runtime_error);
+		REQUIRE(is_dds_file(valid_result.get(), bc1_header_size + blocks * 8U));
+	}
+}
+
+TEST_CASE("todds::encoder shutdown", "[encoder]") {
+	using namespace std::chrono_literals;
+	std::vector<std::future<std::vector<std::uint8_t>>> results;
+	{
+		todds::encoder encoder{1U};
+		for (std::size_t index = 0U; index < 16U; ++index) {
+			const auto format = index % 2U == 0U ? todds::format::type::bc1 : todds::format::type::bc7;
+			results.emplace_back(encoder.submit(rgba_image(), settings_for(format)));
+		}
+	}
+
+	// Destroying the encoder waits for every pending image.
+	for (auto& result : results) {
+		REQUIRE(result.wait_for(0s) == std::future_status::ready);
+		REQUIRE(!result.get().empty());
+	}
+}
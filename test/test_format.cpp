@@ -13,6 +13,8 @@ using todds::format::type;
 
 TEST_CASE("todds::format::name", "[format]") {
 	STATIC_REQUIRE(!name(type::bc1).empty());
+	STATIC_REQUIRE(!name(type::bc4).empty());
+	STATIC_REQUIRE(!name(type::bc5).empty());
 	STATIC_REQUIRE(!name(type::bc7).empty());
 	STATIC_REQUIRE(!name(type::png).empty());
 	STATIC_REQUIRE(name(type::invalid).empty());
@@ -20,6 +22,8 @@ TEST_CASE("todds::format::name", "[format]") {
 
 TEST_CASE("todds::format::has_alpha", "[format]") {
 	STATIC_REQUIRE(!has_alpha(type::bc1));
+	STATIC_REQUIRE(!has_alpha(type::bc4));
+	STATIC_REQUIRE(!has_alpha(type::bc5));
 	STATIC_REQUIRE(has_alpha(type::bc7));
 	STATIC_REQUIRE(has_alpha(type::png));
 	STATIC_REQUIRE(!has_alpha(type::invalid));
@@ -0,0 +1,454 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/format.hpp"
+#include "todds/input.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/pipeline.hpp"
+#include "todds/png.hpp"
+#include "todds/report.hpp"
+#include "todds/string.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <boost/predef.h>
+#include <oneapi/tbb/task_arena.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iterator>
+#include <memory>
+#include <regex>
+#include <span>
+#include <string>
+#include <thread>
+
+#if !BOOST_OS_WINDOWS
+#include <csignal>
+#endif
+
+#include "file_report.hpp"
+#include "output_file.hpp"
+#include "pack_writer.hpp"
+#include "stage_statistics.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+// Writes a PNG file filled with a single byte value.
+void write_png(const fs::path& path, std::size_t width, std::size_t height, std::uint8_t value) {
+	auto image = std::make_unique<todds::mipmap_image>(0U, width, height, false);
+	const std::span<std::uint8_t> data = image->get_image(0U).data();
+	std::fill(data.begin(), data.end(), value);
+	const todds::string name = "test PNG file";
+	const auto buffer = todds::png::encode(name, std::move(image));
+	boost::nowide::ofstream ofs{path, std::ios::out | std::ios::binary};
+	ofs.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+}
+
+// Writes a file which cannot be decoded as a PNG file.
+void write_broken_png(const fs::path& path) {
+	boost::nowide::ofstream ofs{path, std::ios::out | std::ios::binary};
+	ofs << "This is not a PNG file.";
+}
+
+// Reads the whole contents of a file.
+std::string read_file(const fs::path& path) {
+	boost::nowide::ifstream ifs{path, std::ios::in | std::ios::binary};
+	return {std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{}};
+}
+
+// Records tokens of the load PNG stage which took a given time to be processed.
+void record_tokens(todds::pipeline::impl::pipeline_statistics& stats, std::size_t tokens,
+	std::chrono::microseconds latency, std::size_t bytes_in) {
+	using todds::pipeline::impl::pipeline_statistics;
+	for (std::size_t index = 0U; index < tokens; ++index) {
+		static_cast<void>(
+			stats.record(todds::pipeline::impl::stage::load_png, pipeline_statistics::clock::now() - latency, bytes_in, 0U));
+	}
+}
+
+// CRC-32 checksum calculated bit by bit, independently from the implementation used by pack files.
+std::uint32_t reference_crc32(std::span<const char> data) {
+	std::uint32_t crc = 0xFFFFFFFFU;
+	for (const char byte : data) {
+		crc ^= static_cast<std::uint8_t>(byte);
+		for (std::size_t bit = 0U; bit < 8U; ++bit) { crc = (crc >> 1U) ^ ((crc & 1U) != 0U ? 0xEDB88320U : 0U); }
+	}
+	return ~crc;
+}
+
+// Reads a little-endian integer from a pack file.
+template<typename Integer> Integer read_integer(const std::string& pack, std::size_t offset) {
+	Integer value{};
+	for (std::size_t index = sizeof(Integer); index > 0U; --index) {
+		value = static_cast<Integer>((value << 8U) | static_cast<std::uint8_t>(pack[offset + index - 1U]));
+	}
+	return value;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("todds::pipeline small textures", "[pipeline]") {
+	const fs::path directory = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(directory);
+
+	todds::pipeline::input input_data{};
+	input_data.parallelism = 2U;
+	input_data.format = todds::format::type::bc1;
+	input_data.alpha_format = todds::format::type::invalid;
+	input_data.grayscale_format = todds::format::type::invalid;
+	input_data.quality = todds::format::quality::fast;
+	input_data.scale = 100U;
+
+	// Small textures stay in the lane until the input is exhausted, mixed with a large texture and a broken file.
+	constexpr std::size_t small_textures = 8U;
+	for (std::size_t index = 0U; index < small_textures; ++index) {
+		const fs::path png = directory / ("small_" + std::to_string(index) + ".png");
+		write_png(png, 16U, 16U, static_cast<std::uint8_t>(index * 16U));
+		input_data.paths.emplace_back(png, fs::path{png}.replace_extension(".dds"));
+	}
+	const fs::path broken = directory / "broken.png";
+	write_broken_png(broken);
+	input_data.paths.emplace_back(broken, fs::path{broken}.replace_extension(".dds"));
+	const fs::path large = directory / "large.png";
+	write_png(large, 256U, 256U, 0x80U);
+	input_data.paths.emplace_back(large, fs::path{large}.replace_extension(".dds"));
+
+	std::atomic<bool> force_finish{};
+	todds::report_queue updates;
+	todds::pipeline::encode_as_dds(input_data, force_finish, updates);
+
+	for (const auto& [png, dds] : input_data.paths) {
+		if (png == broken) {
+			REQUIRE(!fs::exists(dds));
+		} else {
+			REQUIRE(fs::exists(dds));
+			REQUIRE(fs::file_size(dds) > 0U);
+		}
+	}
+
+	fs::remove_all(directory);
+}
+
+TEST_CASE("todds::pipeline unchanged files", "[pipeline]") {
+	const fs::path directory = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(directory);
+
+	todds::pipeline::input input_data{};
+	input_data.parallelism = 2U;
+	input_data.format = todds::format::type::bc1;
+	input_data.alpha_format = todds::format::type::invalid;
+	input_data.grayscale_format = todds::format::type::invalid;
+	input_data.quality = todds::format::quality::fast;
+	input_data.scale = 100U;
+	input_data.skip_unchanged = true;
+	const fs::path png = directory / "image.png";
+	const fs::path dds = directory / "image.dds";
+	write_png(png, 64U, 64U, 0x40U);
+	input_data.paths.emplace_back(png, dds);
+
+	std::atomic<bool> force_finish{};
+	todds::report_queue updates;
+	todds::pipeline::encode_as_dds(input_data, force_finish, updates);
+	const std::string encoded = read_file(dds);
+	REQUIRE(!encoded.empty());
+	// Older than any write performed by the test.
+	const std::time_t previous_time = fs::last_write_time(dds) - 3600;
+
+	SECTION("Identical files are not written again, keeping their modification time") {
+		fs::last_write_time(dds, previous_time);
+		todds::pipeline::encode_as_dds(input_data, force_finish, updates);
+		REQUIRE(fs::last_write_time(dds) == previous_time);
+	}
+
+	SECTION("Files with the same size and different contents are written again") {
+		{
+			boost::nowide::ofstream ofs{dds, std::ios::out | std::ios::binary | std::ios::trunc};
+			ofs << std::string(encoded.size(), 'x');
+		}
+		fs::last_write_time(dds, previous_time);
+		todds::pipeline::encode_as_dds(input_data, force_finish, updates);
+		REQUIRE(read_file(dds) == encoded);
+		REQUIRE(fs::last_write_time(dds) != previous_time);
+	}
+
+	fs::remove_all(directory);
+}
+
+TEST_CASE("todds::pipeline output files", "[pipeline]") {
+	using todds::pipeline::impl::has_contents;
+	using todds::pipeline::impl::output_file;
+	const fs::path directory = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(directory);
+	const fs::path path = directory / "file.dds";
+
+	// The body is larger than the chunks used to compare files.
+	const std::string header{"header"};
+	const std::string body(40000U, 'x');
+	const std::span<const char> header_part{header.data(), header.size()};
+	const std::span<const char> body_part{body.data(), body.size()};
+	{
+		output_file file{path};
+		file.write(header_part);
+		file.write(body_part);
+		REQUIRE(file.commit());
+	}
+
+	SECTION("Committed files replace the file and remove their temporary file") {
+		REQUIRE(read_file(path) == header + body);
+		REQUIRE(!fs::exists(directory / "file.dds.tmp"));
+	}
+
+	SECTION("Files containing the same data are found") { REQUIRE(has_contents(path, {header_part, body_part})); }
+
+	SECTION("Files with a different size are rejected") {
+		REQUIRE(!has_contents(path, {header_part}));
+		REQUIRE(!has_contents(path, {header_part, body_part, header_part}));
+		REQUIRE(!has_contents(directory / "missing.dds", {header_part, body_part}));
+	}
+
+	SECTION("Files with the same size and different bytes are rejected") {
+		std::string changed = body;
+		changed[30000U] = 'y';
+		REQUIRE(!has_contents(path, {header_part, std::span<const char>{changed.data(), changed.size()}}));
+	}
+
+	SECTION("Files which are not committed keep their previous contents") {
+		{
+			output_file file{path};
+			file.write(header_part);
+		}
+		REQUIRE(has_contents(path, {header_part, body_part}));
+		REQUIRE(!fs::exists(directory / "file.dds.tmp"));
+	}
+
+	SECTION("Files which cannot be committed remove their temporary file") {
+		// Files cannot replace a directory.
+		const fs::path blocked = directory / "blocked.dds";
+		fs::create_directories(blocked / "child");
+		{
+			output_file file{blocked};
+			file.write(header_part);
+			REQUIRE(!file.commit());
+		}
+		REQUIRE(!fs::exists(directory / "blocked.dds.tmp"));
+		REQUIRE(fs::is_directory(blocked));
+	}
+
+	fs::remove_all(directory);
+}
+
+TEST_CASE("todds::pipeline pack file", "[pipeline]") {
+	using todds::pipeline::impl::pack_writer;
+	const fs::path path = fs::temp_directory_path() / fs::unique_path("%%%%-%%%%.pak");
+
+	// Files are added in a different order than their file indexes, as when they are encoded by different tokens.
+	const std::array<std::string, 3U> contents{"first file", std::string(5000U, 'x'), "third file"};
+	const std::array<std::size_t, 3U> add_order{2U, 0U, 1U};
+	{
+		pack_writer pack{path};
+		for (const std::size_t file_index : add_order) {
+			const std::string& data = contents[file_index];
+			const std::span<const char> header{data.data(), 4U};
+			const std::span<const char> body{data.data() + 4U, data.size() - 4U};
+			const std::uint32_t checksum = pack_writer::checksum({header, body});
+			REQUIRE(pack.add(file_index, "file_" + std::to_string(file_index) + ".dds", checksum, {header, body}));
+		}
+		REQUIRE(pack.finish());
+	}
+
+	boost::nowide::ifstream ifs{path, std::ios::in | std::ios::binary};
+	const std::string pack{std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{}};
+	ifs.close();
+	const std::string_view magic = pack_writer::magic;
+	REQUIRE(pack.starts_with(magic));
+	REQUIRE(read_integer<std::uint32_t>(pack, magic.size()) == pack_writer::version);
+	REQUIRE(pack.ends_with(magic));
+
+	const std::size_t footer = pack.size() - magic.size() - 16U;
+	std::size_t offset = read_integer<std::uint64_t>(pack, footer);
+	REQUIRE(read_integer<std::uint64_t>(pack, footer + 8U) == contents.size());
+
+	// The index follows the order of the input, and the checksum of each entry matches its contents.
+	for (std::size_t file_index = 0U; file_index < contents.size(); ++file_index) {
+		const auto file_offset = read_integer<std::uint64_t>(pack, offset);
+		const auto file_size = read_integer<std::uint64_t>(pack, offset + 8U);
+		const auto checksum = read_integer<std::uint32_t>(pack, offset + 16U);
+		const auto path_size = read_integer<std::uint32_t>(pack, offset + 20U);
+		REQUIRE(pack.substr(offset + 24U, path_size) == "file_" + std::to_string(file_index) + ".dds");
+		const std::string data = pack.substr(file_offset, file_size);
+		REQUIRE(data == contents[file_index]);
+		REQUIRE(checksum == reference_crc32(data));
+		offset += 24U + path_size;
+	}
+	REQUIRE(offset == footer);
+
+	fs::remove(path);
+}
+
+#if BOOST_OS_LINUX
+TEST_CASE("todds::pipeline pack file write errors", "[pipeline]") {
+	// Every write to /dev/full fails once its data leaves the buffer of the stream.
+	todds::pipeline::impl::pack_writer pack{"/dev/full"};
+	const std::string data(1024U * 1024U, 'x');
+	REQUIRE(!pack.add(0U, "file.dds", 0U, {std::span<const char>{data.data(), data.size()}}));
+	REQUIRE(!pack.finish());
+}
+#endif
+
+TEST_CASE("todds::pipeline file report", "[pipeline]") {
+	using todds::pipeline::impl::stage;
+	todds::pipeline::input input_data{};
+	input_data.format = todds::format::type::bc7;
+	input_data.paths = {{"first.png", "first.dds"}, {"second.png", "second.dds"}};
+	todds::vector<todds::pipeline::impl::file_data> files_data(input_data.paths.size());
+	todds::report_queue updates;
+
+	// The first file is written after several stages have processed it, while the second one fails to load.
+	const auto process_files = [&input_data, &files_data, &updates] {
+		todds::pipeline::impl::file_report report{input_data, files_data, updates};
+		auto& written = files_data[0U];
+		written.width = 64U;
+		written.height = 32U;
+		written.mipmaps = 7U;
+		written.format = todds::format::type::bc1;
+		written.alpha = todds::pipeline::impl::alpha_type::opaque;
+		written.input_bytes = 1234U;
+		written.quality.image = {40.5, 0.98766};
+		written.quality.levels = {{40.5, 0.98766}, {38.25, 0.9}};
+		report.record_time(stage::load_png, 0U, 1500000U);
+		// Time spent by several tokens on the same stage is added up.
+		report.record_time(stage::encode_dds, 0U, 250000U);
+		report.record_time(stage::encode_dds, 0U, 250000U);
+		written.output_bytes = 2176U;
+		report.record_time(stage::save_dds, 0U, 2000U);
+
+		report.record_time(stage::load_png, 1U, 1000000U);
+		todds::pipeline::impl::report_file_error(updates, &report, 1U, "Invalid PNG file; bad\nheader");
+		report.record_time(stage::load_png, todds::pipeline::impl::error_file_index, 1U);
+
+		todds::vector<todds::string> rows;
+		todds::report update;
+		while (updates.try_pop(update)) {
+			if (update.type() == todds::report_type::file_report) { rows.push_back(update.data()); }
+		}
+		return rows;
+	};
+
+	const todds::string times{"Load PNG ms;Decode PNG ms;Scale image ms;Mipmaps ms;Pixel blocks ms;Encode DDS ms;"
+														"Quality metrics ms;Save DDS ms;Encode PNG ms;Save PNG ms"};
+
+	SECTION("The header is followed by one row per file, including files which failed") {
+		const todds::vector<todds::string> expected{
+			"File;Width;Height;Mipmaps;Format;Alpha;Input bytes;Output bytes;" + times + ";Error",
+			"first.dds;64;32;7;BC1;Opaque;1234;2176;1.500;0.000;0.000;0.000;0.000;0.500;0.000;0.002;0.000;0.000;",
+			"second.dds;0;0;0;;;0;0;1.000;0.000;0.000;0.000;0.000;0.000;0.000;0.000;0.000;0.000;"
+			"Invalid PNG file  bad header"};
+		REQUIRE(process_files() == expected);
+	}
+
+	SECTION("Quality metrics follow the format, and are empty for files which failed") {
+		input_data.quality_metrics = true;
+		const todds::vector<todds::string> expected{
+			"File;Width;Height;Mipmaps;Format;PSNR;SSIM;Mipmap PSNR;Alpha;Input bytes;Output bytes;" + times + ";Error",
+			"first.dds;64;32;7;BC1;40.50;0.9877;40.50,38.25;Opaque;1234;2176;1.500;0.000;0.000;0.000;0.000;0.500;0.000;"
+			"0.002;0.000;0.000;",
+			"second.dds;0;0;0;;;;;;0;0;1.000;0.000;0.000;0.000;0.000;0.000;0.000;0.000;0.000;0.000;"
+			"Invalid PNG file  bad header"};
+		REQUIRE(process_files() == expected);
+	}
+}
+
+TEST_CASE("todds::pipeline statistics summary", "[pipeline]") {
+	using namespace std::chrono_literals;
+	todds::report_queue updates;
+	todds::pipeline::impl::pipeline_statistics stats{1U, updates, nullptr};
+
+	// Each latency falls in a different bucket of the histogram. Bucket N contains latencies below 2^N microseconds.
+	constexpr std::size_t megabyte = 1024U * 1024U;
+	record_tokens(stats, 50U, 90us, megabyte);
+	record_tokens(stats, 40U, 700us, megabyte);
+	record_tokens(stats, 10U, 12000us, megabyte);
+	const std::string summary{stats.summary()};
+
+	SECTION("Only stages which processed tokens are included") {
+		REQUIRE(summary.find("Load PNG") != std::string::npos);
+		REQUIRE(summary.find("    100 tokens") != std::string::npos);
+		REQUIRE(summary.find("Decode PNG") == std::string::npos);
+	}
+
+	SECTION("Percentiles are the upper bounds of their buckets") {
+		REQUIRE(summary.find("p50 <= 0.128 ms") != std::string::npos);
+		REQUIRE(summary.find("p90 <= 1.024 ms") != std::string::npos);
+		REQUIRE(summary.find("p99 <= 16.384 ms") != std::string::npos);
+	}
+
+	SECTION("Throughput is measured while the stage is running") {
+		// 100 MB in 152.5 ms, plus the time spent recording each token.
+		const std::regex input_throughput{R"(in 100\.0 MB \(([0-9.]+) MB/s\))"};
+		std::smatch match;
+		REQUIRE(std::regex_search(summary, match, input_throughput));
+		const double throughput = std::stod(match[1U].str());
+		REQUIRE(throughput <= 655.8);
+		REQUIRE(throughput > 600.0);
+		REQUIRE(summary.find("out 0.0 MB (0.0 MB/s)") != std::string::npos);
+	}
+}
+
+TEST_CASE("todds::pipeline statistics threads of different arenas", "[pipeline]") {
+	using namespace std::chrono_literals;
+	todds::report_queue updates;
+	todds::pipeline::impl::pipeline_statistics stats{2U, updates, nullptr};
+
+	// Both threads have the same index in their own arena. The time between their tokens must not be counted as waiting
+	// time, as it would be if they shared their counters.
+	const auto record_in_arena = [&stats] {
+		oneapi::tbb::task_arena arena{1};
+		arena.execute([&stats] { record_tokens(stats, 1U, 10us, 0U); });
+	};
+	std::thread{record_in_arena}.join();
+	std::this_thread::sleep_for(50ms);
+	std::thread{record_in_arena}.join();
+
+	const std::string summary{stats.summary()};
+	REQUIRE(summary.find("      2 tokens") != std::string::npos);
+	REQUIRE(summary.find("waiting 0.000 s") != std::string::npos);
+}
+
+#if !BOOST_OS_WINDOWS
+TEST_CASE("todds::pipeline statistics SIGUSR1 handler", "[pipeline]") {
+	struct sigaction original {};
+	struct sigaction ignore {};
+	ignore.sa_handler = SIG_IGN;
+	sigemptyset(&ignore.sa_mask);
+	sigaction(SIGUSR1, &ignore, &original);
+
+	todds::report_queue updates;
+	{
+		todds::pipeline::impl::pipeline_statistics first{1U, updates, nullptr};
+		{ todds::pipeline::impl::pipeline_statistics second{1U, updates, nullptr}; }
+
+		// The handler stays installed while any instance is alive.
+		REQUIRE(std::raise(SIGUSR1) == 0);
+		first.report_if_requested();
+		todds::report update{};
+		REQUIRE(updates.try_pop(update));
+		REQUIRE(update.type() == todds::report_type::statistics);
+	}
+
+	// The last instance restores the previous handler.
+	struct sigaction current {};
+	sigaction(SIGUSR1, nullptr, &current);
+	REQUIRE(current.sa_handler == SIG_IGN);
+	sigaction(SIGUSR1, &original, nullptr);
+}
+#endif
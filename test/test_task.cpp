@@ -0,0 +1,314 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/arguments.hpp"
+#include "todds/file_retrieval.hpp"
+#include "todds/project.hpp"
+#include "todds/report.hpp"
+#include "todds/string.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <boost/predef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "file_watcher.hpp"
+#include "merge_reports.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+constexpr auto binary = todds::project::name();
+
+// Appends data to a file, creating it if it does not exist. Each call is a separate write for the file watcher.
+void append(const fs::path& path, std::string_view data) {
+	boost::nowide::ofstream ofs{path, std::ios::out | std::ios::binary | std::ios::app};
+	ofs << data;
+}
+
+// Writes the beginning of a PNG file, up to the width and height stored in its header.
+void write_png_header(const fs::path& path, std::uint32_t width, std::uint32_t height) {
+	std::string header{"\x89PNG\r\n\x1a\n\0\0\0\x0dIHDR", 16U};
+	for (const std::uint32_t value : {width, height}) {
+		for (int shift = 24; shift >= 0; shift -= 8) { header += static_cast<char>((value >> shift) & 0xFFU); }
+	}
+	append(path, header);
+}
+
+// Takes every report of the queue.
+todds::vector<todds::report> take_reports(todds::report_queue& updates) {
+	todds::vector<todds::report> reports;
+	todds::report update;
+	while (updates.try_pop(update)) { reports.push_back(std::move(update)); }
+	return reports;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("todds::get_shard", "[task]") {
+	const fs::path input = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(input);
+	// A large image followed by several small ones.
+	todds::pipeline::paths_vector paths;
+	for (const auto* name : {"large", "a", "b", "c", "d"}) {
+		const fs::path png = (input / name) += ".png";
+		const std::uint32_t size = paths.empty() ? 2048U : 64U;
+		write_png_header(png, size, size);
+		paths.emplace_back(png, (input / name) += ".dds");
+	}
+
+	const auto first = todds::get_shard(paths, 0U, 2U);
+	const auto second = todds::get_shard(paths, 1U, 2U);
+
+	SECTION("Shards are balanced using the size of each image") {
+		REQUIRE(first == todds::pipeline::paths_vector{paths[0]});
+		REQUIRE(second == todds::pipeline::paths_vector{paths[1], paths[2], paths[3], paths[4]});
+	}
+
+	SECTION("Shards do not depend on the order in which files were found") {
+		std::reverse(paths.begin(), paths.end());
+		REQUIRE(todds::get_shard(paths, 0U, 2U) == first);
+		REQUIRE(todds::get_shard(paths, 1U, 2U) == second);
+	}
+
+	fs::remove_all(input);
+}
+
+TEST_CASE("todds::get_paths with shards", "[task]") {
+	const fs::path root = fs::temp_directory_path() / fs::unique_path();
+	const fs::path input = root / "input";
+	const fs::path output = root / "output";
+	fs::create_directories(input);
+	for (const auto* name : {"a", "b", "c", "d", "e", "f"}) { write_png_header((input / name) += ".png", 64U, 64U); }
+
+	const auto shard_paths = [&input, &output](std::string_view shard) {
+		const auto arguments = todds::args::get({binary, "--shard", shard, input.string(), output.string()});
+		REQUIRE(arguments.stop_message.empty());
+		todds::report_queue updates;
+		return todds::get_paths(arguments, updates);
+	};
+	const auto first = shard_paths("1/2");
+	const auto second = shard_paths("2/2");
+
+	SECTION("Every file is assigned to a single shard") {
+		REQUIRE(first.size() + second.size() == 6U);
+		for (const auto& paths : first) { REQUIRE(std::find(second.cbegin(), second.cend(), paths) == second.cend()); }
+	}
+
+	SECTION("Outputs written by one shard do not move files between shards") {
+		for (const auto& paths : first) { append(paths.second, "data"); }
+		REQUIRE(shard_paths("1/2").empty());
+		REQUIRE(shard_paths("2/2") == second);
+	}
+
+	fs::remove_all(root);
+}
+
+TEST_CASE("todds::get_paths with excluded directories", "[task]") {
+	const fs::path root = fs::temp_directory_path() / fs::unique_path();
+	const fs::path input = root / "input";
+	const fs::path output = root / "output";
+	fs::create_directories(input / "Source" / "deep");
+	fs::create_directories(input / "Textures" / "Source");
+	fs::create_directories(input / "Textures" / "UI");
+	for (const fs::path& png : {input / "a.png", input / "Source" / "b.png", input / "Source" / "deep" / "c.png",
+				 input / "Textures" / "d.png", input / "Textures" / "old_Source.png", input / "Textures" / "Source" / "e.png",
+				 input / "Textures" / "UI" / "f.png"}) {
+		append(png, "data");
+	}
+	append(input / "notes.txt", "data");
+
+	const std::string input_string = input.string();
+	const std::string output_string = output.string();
+	const auto retrieve = [&input_string, &output_string](todds::vector<std::string_view> arguments) {
+		arguments.insert(arguments.begin(), binary);
+		arguments.insert(arguments.end(), {input_string, output_string});
+		const auto parsed = todds::args::get(arguments);
+		REQUIRE(parsed.stop_message.empty());
+		todds::report_queue updates;
+		auto paths = todds::get_paths(parsed, updates);
+		std::sort(paths.begin(), paths.end());
+		todds::vector<todds::string> statistics;
+		for (const auto& update : take_reports(updates)) {
+			if (update.type() == todds::report_type::statistics) { statistics.push_back(update.data()); }
+		}
+		return std::make_pair(paths, statistics);
+	};
+#if defined(TODDS_REGULAR_EXPRESSIONS)
+	const auto mirrored = [&input, &output](const fs::path& relative) {
+		return std::make_pair(input / relative, (output / relative).replace_extension(".dds"));
+	};
+	// Files inside of excluded directories are not counted, as those directories are never searched.
+	const todds::vector<todds::string> pruned{"Skipped 3 excluded files and directories while retrieving files."};
+
+	SECTION("Excluded directories and files are skipped") {
+		const auto [paths, statistics] = retrieve({"--exclude", "Source"});
+		const todds::pipeline::paths_vector expected{
+			mirrored("Textures/UI/f.png"), mirrored("Textures/d.png"), mirrored("a.png")};
+		REQUIRE(paths == expected);
+		REQUIRE(statistics == pruned);
+	}
+
+	SECTION("Exclude patterns are checked inside of included directories") {
+		const auto [paths, statistics] = retrieve({"--regex", "Textures", "--exclude", "Source"});
+		const todds::pipeline::paths_vector expected{mirrored("Textures/UI/f.png"), mirrored("Textures/d.png")};
+		REQUIRE(paths == expected);
+		REQUIRE(statistics == pruned);
+	}
+#endif // defined(TODDS_REGULAR_EXPRESSIONS)
+
+	SECTION("Nothing is reported when no path is excluded") {
+		const auto [paths, statistics] = retrieve({});
+		REQUIRE(paths.size() == 7U);
+		REQUIRE(statistics.empty());
+	}
+
+	fs::remove_all(root);
+}
+
+TEST_CASE("todds::get_paths with nested input directories", "[task]") {
+	const fs::path root = fs::temp_directory_path() / fs::unique_path();
+	const fs::path shared = root / "shared";
+	fs::create_directories(shared);
+	append(root / "top.png", "data");
+	append(shared / "shared.png", "data");
+
+	// The shared folder is reached through both input directories. Outputs cannot be mirrored for several inputs, so
+	// every file must keep its output next to it whichever input found it first.
+	auto arguments = todds::args::get({binary, root.string(), (root / "output").string()});
+	REQUIRE(arguments.stop_message.empty());
+	arguments.input.push_back(shared);
+	todds::report_queue updates;
+	const auto paths = todds::get_paths(arguments, updates);
+
+	SECTION("The output argument is rejected") {
+		const auto reports = take_reports(updates);
+		REQUIRE(std::any_of(reports.cbegin(), reports.cend(),
+			[](const todds::report& update) { return update.type() == todds::report_type::pipeline_error; }));
+		REQUIRE(!fs::exists(root / "output"));
+	}
+
+	SECTION("Files of the shared folder are written next to them") {
+		const auto contains = [&paths](const fs::path& png, const fs::path& dds) {
+			return std::find(paths.cbegin(), paths.cend(), std::make_pair(png, dds)) != paths.cend();
+		};
+		REQUIRE(contains(root / "top.png", root / "top.dds"));
+		REQUIRE(contains(shared / "shared.png", shared / "shared.dds"));
+		REQUIRE(std::all_of(paths.cbegin(), paths.cend(),
+			[](const auto& files) { return files.first.parent_path() == files.second.parent_path(); }));
+	}
+
+	fs::remove_all(root);
+}
+
+TEST_CASE("todds::merge_reports", "[task]") {
+	const fs::path input = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(input);
+	constexpr std::string_view header{"File;Width;Height;Mipmaps;Format;PSNR;SSIM;Mipmap PSNR;Error"};
+	// Reports may contain other lines printed by todds. Files without the CSV extension are ignored.
+	append(input / "shard1.csv", "Encoding 2 files.\n" + todds::string{header} + "\n");
+	append(input / "shard1.csv", "b.dds;64;64;7;BC7;40.00;0.9900;41.00;\nd.dds;64;64;7;BC1;inf;1.0000;inf;\n");
+	append(input / "shard2.csv", todds::string{header} + "\r\n");
+	append(input / "shard2.csv", "a.dds;32;32;6;BC7;30.00;0.9700;31.00;\r\nc.dds;0;0;0;;;;;Invalid PNG file.\r\n");
+	append(input / "shard2.csv", "b.dds;64;64;7;BC1;20.00;0.9000;21.00;\r\n");
+	append(input / "notes.txt", todds::string{header} + "\ne.dds;64;64;7;BC7;40.00;0.9900;41.00;\n");
+
+	todds::report_queue updates;
+	todds::merge_reports({input}, updates);
+	const auto reports = take_reports(updates);
+	const auto data_of = [&reports](todds::report_type type) {
+		todds::vector<todds::string> data;
+		for (const auto& update : reports) {
+			if (update.type() == type) { data.emplace_back(update.data()); }
+		}
+		return data;
+	};
+
+	SECTION("Rows are sorted by file, keeping the first row of duplicated files") {
+		const todds::vector<todds::string> expected{todds::string{header}, "a.dds;32;32;6;BC7;30.00;0.9700;31.00;",
+			"b.dds;64;64;7;BC7;40.00;0.9900;41.00;", "c.dds;0;0;0;;;;;Invalid PNG file.",
+			"d.dds;64;64;7;BC1;inf;1.0000;inf;"};
+		REQUIRE(data_of(todds::report_type::file_report) == expected);
+	}
+
+	SECTION("The summary counts formats and failures, and averages metrics of lossy files") {
+		const todds::vector<todds::string> expected{
+			"Merged 2 reports with 4 files. BC1: 1. BC7: 2. Failed: 1. Mean PSNR 35.00 dB, mean SSIM 0.9867."};
+		REQUIRE(data_of(todds::report_type::statistics) == expected);
+	}
+
+	SECTION("Duplicated files are reported") {
+		REQUIRE(data_of(todds::report_type::pipeline_error).size() == 1U);
+	}
+
+	fs::remove_all(input);
+}
+
+#if BOOST_OS_LINUX
+TEST_CASE("todds::file_watcher", "[task]") {
+	using clock = std::chrono::steady_clock;
+	const fs::path input = fs::temp_directory_path() / fs::unique_path();
+	const fs::path output = input / "output";
+	fs::create_directories(input / "existing");
+
+	const auto arguments = todds::args::get({binary, "--watch", input.string(), output.string()});
+	REQUIRE(arguments.stop_message.empty());
+	todds::report_queue updates;
+	todds::file_watcher watcher{todds::get_input_paths(arguments), arguments.output, arguments.depth, updates};
+	REQUIRE(watcher.valid());
+
+	// PNG files written in several steps, new subdirectories and files which must be ignored.
+	append(input / "first.png", "first write");
+	append(input / "first.png", "second write");
+	append(input / "existing" / "second.png", "data");
+	append(input / "notes.txt", "data");
+	fs::create_directories(input / "created");
+	append(input / "created" / "third.png", "data");
+	// The output directory does not exist when the watcher starts, and it is inside of the input directory.
+	fs::create_directories(output);
+	append(output / "first.png", "data");
+	const auto last_write = clock::now();
+
+	std::atomic<bool> force_finish{};
+	const auto changed = watcher.wait_for_changes(force_finish);
+
+	SECTION("Changes are reported after the debounce time has passed without new writes") {
+		REQUIRE(clock::now() - last_write >= todds::file_watcher::debounce_time);
+	}
+
+	SECTION("Each written PNG file is reported once, except those in the output directory") {
+		const todds::vector<fs::path> expected{
+			input / "created" / "third.png", input / "existing" / "second.png", input / "first.png"};
+		REQUIRE(changed == expected);
+	}
+
+	SECTION("Changed files are encoded into the mirrored output directory") {
+		const auto paths = todds::get_changed_paths(arguments, changed, updates);
+		REQUIRE(paths.size() == 3U);
+		const auto contains = [&paths](const fs::path& png, const fs::path& dds) {
+			return std::find(paths.cbegin(), paths.cend(), std::make_pair(png, dds)) != paths.cend();
+		};
+		REQUIRE(contains(input / "first.png", output / "first.dds"));
+		REQUIRE(contains(input / "existing" / "second.png", output / "existing" / "second.dds"));
+		REQUIRE(contains(input / "created" / "third.png", output / "created" / "third.dds"));
+	}
+
+	SECTION("Waiting stops when the watcher is asked to finish") {
+		force_finish.store(true);
+		REQUIRE(watcher.wait_for_changes(force_finish).empty());
+	}
+
+	fs::remove_all(input);
+}
+#endif // BOOST_OS_LINUX
@@ -3,11 +3,19 @@
  * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 
+#include "todds/buffer_pool.hpp"
+#include "todds/report.hpp"
+#include "todds/shard.hpp"
 #include "todds/string.hpp"
 #include "todds/util.hpp"
+#include "todds/vector.hpp"
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <array>
+#include <chrono>
+#include <thread>
+
 TEST_CASE("todds::util::next_divisible_by_4", "[util]") {
 	using todds::util::next_divisible_by_4;
 	STATIC_REQUIRE(next_divisible_by_4(1UL) == 4UL);
@@ -24,3 +32,111 @@ TEST_CASE("todds::string", "[string]") {
 	const string upper = "SOME STRING DATA";
 	REQUIRE(to_upper_copy(lower) == upper);
 }
+
+TEST_CASE("todds::report_queue", "[report]") {
+	using namespace std::chrono_literals;
+	using clock = std::chrono::steady_clock;
+	todds::report_queue updates;
+
+	SECTION("Waiting stops after the timeout if no report is sent") {
+		const auto start = clock::now();
+		REQUIRE(!updates.wait_for(20ms));
+		REQUIRE(clock::now() - start >= 20ms);
+	}
+
+	SECTION("Reports already in the queue do not need to wait") {
+		updates.emplace(todds::report_type::statistics, todds::string{"data"});
+		REQUIRE(updates.wait_for(0ms));
+	}
+
+	SECTION("Waiting consumers wake up when a report is sent") {
+		std::thread producer{[&updates] {
+			std::this_thread::sleep_for(20ms);
+			updates.emplace(todds::report_type::encoding_progress);
+		}};
+		const auto start = clock::now();
+		const bool available = updates.wait_for(60s);
+		const auto elapsed = clock::now() - start;
+		producer.join();
+		REQUIRE(available);
+		REQUIRE(elapsed < 30s);
+
+		todds::report update;
+		REQUIRE(updates.try_pop(update));
+		REQUIRE(update.type() == todds::report_type::encoding_progress);
+		REQUIRE(updates.empty());
+	}
+}
+
+TEST_CASE("todds::buffer", "[util]") {
+	const auto is_aligned = [](const void* memory) {
+		return reinterpret_cast<std::uintptr_t>(memory) % todds::buffer_alignment == 0U;
+	};
+	const todds::buffer<std::uint8_t> small(3U);
+	REQUIRE(is_aligned(small.data()));
+	const todds::buffer<std::uint64_t> values(5U, 7U);
+	REQUIRE(is_aligned(values.data()));
+	REQUIRE(values.back() == 7U);
+	const todds::buffer_pool::vector<std::uint32_t> pooled(todds::buffer_pool::minimum_size);
+	REQUIRE(is_aligned(pooled.data()));
+}
+
+TEST_CASE("todds::buffer_pool", "[util]") {
+	namespace pool = todds::buffer_pool;
+	pool::trim();
+	pool::reset_statistics();
+
+	SECTION("Small allocations do not use the pool.") {
+		const pool::vector<std::uint8_t> small(pool::minimum_size - 1U);
+		REQUIRE(pool::get_statistics().rented == 0U);
+	}
+
+	SECTION("Buffers are reused by allocations of the same size class.") {
+		const std::uint8_t* first_data{};
+		{
+			pool::vector<std::uint8_t> first(pool::minimum_size * 3U);
+			first_data = first.data();
+		}
+		REQUIRE(pool::get_statistics().cached_bytes >= pool::minimum_size * 3U);
+		const pool::vector<std::uint8_t> second(pool::minimum_size * 3U - 1U);
+		REQUIRE(second.data() == first_data);
+		REQUIRE(pool::get_statistics().rented == 2U);
+		REQUIRE(pool::get_statistics().reused == 1U);
+		REQUIRE(pool::get_statistics().cached_bytes == 0U);
+	}
+
+	SECTION("Buffers exceeding the capacity are freed.") {
+		pool::set_capacity(pool::minimum_size);
+		{ const pool::vector<std::uint8_t> large(pool::minimum_size * 2U); }
+		REQUIRE(pool::get_statistics().discarded == 1U);
+		REQUIRE(pool::get_statistics().cached_bytes == 0U);
+		pool::set_capacity(pool::default_capacity);
+	}
+
+	pool::trim();
+	REQUIRE(pool::get_statistics().cached_bytes == 0U);
+}
+
+TEST_CASE("todds::util::balance_shards", "[util]") {
+	constexpr std::array<std::uint64_t, 6U> costs{10U, 3U, 7U, 4U, 6U, 2U};
+
+	SECTION("Every item is assigned to a shard with a balanced cost.") {
+		const auto shards = todds::util::balance_shards(costs, 2U);
+		REQUIRE(shards.size() == costs.size());
+		std::array<std::uint64_t, 2U> totals{};
+		for (std::size_t index = 0U; index < costs.size(); ++index) {
+			REQUIRE(shards[index] < totals.size());
+			totals[shards[index]] += costs[index];
+		}
+		REQUIRE(totals[0U] == 16U);
+		REQUIRE(totals[1U] == 16U);
+	}
+
+	SECTION("Shards are deterministic.") {
+		REQUIRE(todds::util::balance_shards(costs, 3U) == todds::util::balance_shards(costs, 3U));
+	}
+
+	SECTION("A single shard contains every item.") {
+		for (const std::size_t shard : todds::util::balance_shards(costs, 1U)) { REQUIRE(shard == 0U); }
+	}
+}
@@ -21,6 +21,7 @@ import winreg
 bc7enc_tool = 'bc7enc'
 nvtt_tool = 'nvtt'
 todds_tool = 'todds'
+todds_adaptive_tool = 'todds_adaptive'
 texconv_tool = 'texconv'
 nvdecompress_executable = 'nvdecompress'
 # Currently the flip executable fails in at least one texture of every dataset. The code has been commented out.
@@ -35,6 +36,9 @@ encoder_data = {
     nvtt_tool: EncoderData('nvbatchcompress', True, True, ('-highest', '-bc7', '-mipfilter', 'kaiser', '-silent')),
     # todds encodes with BC7 and uses Lanczos interpolation to generate mipmaps by default.
     todds_tool: EncoderData('todds', True, False, ('-o',)),
+    # Same settings as todds, encoding low complexity blocks with a cheaper quality level. Compare both tools to measure
+    # the PSNR loss and time saved by adaptive quality.
+    todds_adaptive_tool: EncoderData('todds', True, False, ('-o', '--adaptive-quality', '2')),
     # Texconv should use WIC to generate mipmaps with this setup.
     texconv_tool: EncoderData('texconv', True, False, ('-y', '-f', 'BC7_UNORM')),
 }
@@ -99,6 +103,10 @@ def todds_version():
     return output.strip()
 
 
+def todds_adaptive_version():
+    return todds_version()
+
+
 def texconv_version():
     output = subprocess.check_output([encoder_data[texconv_tool].executable, ]).decode('utf-8')
     _, output = output.split('Version ', 1)
@@ -180,6 +188,15 @@ def todds_execute(input_path, output_path):
     return subprocess.Popen(arguments, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
 
 
+def todds_adaptive_execute(input_path, output_path):
+    todds_data = encoder_data[todds_adaptive_tool]
+    arguments = [todds_data.executable, ]
+    arguments.extend(todds_data.params)
+    arguments.append(input_path)
+    arguments.append(output_path)
+    return subprocess.Popen(arguments, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+
 def texconv_execute(input_path, output_path):
     texconv_data = encoder_data[texconv_tool]
     arguments = [texconv_data.executable, ]
@@ -0,0 +1,109 @@
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+import argparse
+import os
+import pathlib
+import struct
+import sys
+import zlib
+
+MAGIC = b'TODDSPAK'
+VERSION = 1
+HEADER_SIZE = len(MAGIC) + 8
+FOOTER_SIZE = 16 + len(MAGIC)
+
+
+def get_parsed_args():
+    parser = argparse.ArgumentParser(description='List, verify or extract the DDS files of a pack file created by todds')
+    parser.add_argument('pack', metavar='pack', type=str, help='Pack file created using the --pack argument of todds.')
+    parser.add_argument('output', metavar='output', type=str, nargs='?',
+                        help='Directory in which DDS files will be extracted. Defaults to the directory of the pack.')
+    parser.add_argument('--list', action='store_true', help='List the contents of the pack instead of extracting it.')
+    parser.add_argument('--verify', action='store_true',
+                        help='Verify the checksum of every file in the pack instead of extracting it.')
+    return parser.parse_args()
+
+
+def validate_args(arguments):
+    if not os.path.isfile(arguments.pack):
+        return f'Pack file {arguments.pack} is not valid'
+
+    if arguments.output is not None and os.path.exists(arguments.output) and not os.path.isdir(arguments.output):
+        return f'{arguments.output} is not a directory'
+
+    return ''
+
+
+def read_index(pack):
+    pack.seek(0)
+    magic, version, _ = struct.unpack('<8sII', pack.read(HEADER_SIZE))
+    if magic != MAGIC or version != VERSION:
+        raise ValueError('Not a todds pack file, or created by an unsupported version of todds')
+
+    pack.seek(-FOOTER_SIZE, os.SEEK_END)
+    index_offset, count, magic = struct.unpack('<QQ8s', pack.read(FOOTER_SIZE))
+    if magic != MAGIC:
+        raise ValueError('The pack file is incomplete')
+
+    pack.seek(index_offset)
+    entries = []
+    for _ in range(count):
+        offset, size, checksum, path_size = struct.unpack('<QQII', pack.read(24))
+        entries.append((pack.read(path_size).decode('utf-8'), offset, size, checksum))
+    return entries
+
+
+def extraction_path(output, path):
+    # Absolute paths are extracted inside of the output directory as well.
+    relative = pathlib.PurePosixPath(path)
+    if relative.is_absolute():
+        relative = relative.relative_to(relative.anchor)
+    relative = pathlib.PurePath(*(part.rstrip(':') for part in relative.parts))
+    if '..' in relative.parts:
+        raise ValueError(f'Refusing to extract {path} outside of the output directory')
+    return os.path.join(output, relative)
+
+
+if __name__ == '__main__':
+    # Argument parsing and validation.
+    args = get_parsed_args()
+    args_error = validate_args(args)
+    if len(args_error) > 0:
+        sys.exit(args_error)
+
+    output_dir = args.output if args.output is not None else os.path.dirname(os.path.abspath(args.pack))
+    failures = 0
+    with open(args.pack, 'rb') as pack_file:
+        try:
+            index = read_index(pack_file)
+        except (ValueError, struct.error) as error:
+            sys.exit(f'Could not read {args.pack}: {error}')
+
+        for entry_path, entry_offset, entry_size, entry_checksum in index:
+            if args.list:
+                print(f'{entry_size:>12} {entry_path}')
+                continue
+
+            pack_file.seek(entry_offset)
+            contents = pack_file.read(entry_size)
+            if zlib.crc32(contents) != entry_checksum:
+                print(f'Checksum mismatch: {entry_path}', file=sys.stderr)
+                failures += 1
+                continue
+            if args.verify:
+                continue
+
+            try:
+                target = extraction_path(output_dir, entry_path)
+            except ValueError as error:
+                print(error, file=sys.stderr)
+                failures += 1
+                continue
+            pathlib.Path(target).parent.mkdir(parents=True, exist_ok=True)
+            with open(target, 'wb') as target_file:
+                target_file.write(contents)
+
+    if failures > 0:
+        sys.exit(f'{failures} files are corrupted or could not be extracted')